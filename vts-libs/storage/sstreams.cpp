@@ -24,6 +24,8 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <iostream>
+#include <sstream>
+#include <ctime>
 #include <functional>
 
 #include <boost/filesystem.hpp>
@@ -111,8 +113,61 @@ IStream::pointer memStream(Type type, Data &&indata
         (type, std::move(indata), lastModified, path);
 }
 
+class MemOStream : public storage::OStream {
+public:
+    template <typename Type>
+    MemOStream(Type type, const MemOnClose &onClose
+               , const boost::filesystem::path &path)
+        : OStream(type), path_(path), onClose_(onClose), closed_(false)
+    {
+        stream_.exceptions(std::ios::badbit | std::ios::failbit);
+    }
+
+    virtual ~MemOStream() {
+        if (!std::uncaught_exception() && !closed_) {
+            LOG(warn3) << "File was not closed!";
+        }
+    }
+
+    virtual std::ostream& get() UTILITY_OVERRIDE { return stream_; }
+
+    virtual void close() UTILITY_OVERRIDE {
+        if (closed_) { return; }
+        closed_ = true;
+        if (onClose_) { onClose_(stream_.str()); }
+    }
+
+    virtual std::string name() const UTILITY_OVERRIDE {
+        return path_.string();
+    };
+
+    virtual FileStat stat_impl() const UTILITY_OVERRIDE {
+        // tellp is non-const
+        return FileStat(const_cast<std::ostringstream&>(stream_).tellp()
+                        , std::time(nullptr));
+    }
+
+private:
+    boost::filesystem::path path_;
+    std::ostringstream stream_;
+    MemOnClose onClose_;
+    bool closed_;
+};
+
 } // namespace detail
 
+OStream::pointer memOStream(File type, const MemOnClose &onClose
+                            , const boost::filesystem::path &path)
+{
+    return std::make_shared<detail::MemOStream>(type, onClose, path);
+}
+
+OStream::pointer memOStream(TileFile type, const MemOnClose &onClose
+                            , const boost::filesystem::path &path)
+{
+    return std::make_shared<detail::MemOStream>(type, onClose, path);
+}
+
 IStream::pointer memIStream(const char *contentType, std::string &&data
                             , std::time_t lastModified
                             , const boost::filesystem::path &path)
@@ -78,6 +78,15 @@ IStream::pointer memIStream(TileFile type, MemBlock &&data
                             , std::time_t lastModified = 0
                             , const boost::filesystem::path &path = "unknown");
 
+/** Receives all data written to in-memory output stream when it is closed.
+ */
+typedef std::function<void(std::string &&data)> MemOnClose;
+
+OStream::pointer memOStream(File type, const MemOnClose &onClose
+                            , const boost::filesystem::path &path = "unknown");
+OStream::pointer memOStream(TileFile type, const MemOnClose &onClose
+                            , const boost::filesystem::path &path = "unknown");
+
 } } // namespace vtslibs::storage
 
 #endif // vtslibs_storage_driver_sstreams_hpp_included_
@@ -62,6 +62,8 @@ dump(std::basic_ostream<CharT, Traits> &os
     os << prefix << "binaryOrder = " << o.binaryOrder << '\n'
        << prefix << "filesPerTile = " << o.filesPerTile << '\n'
        << prefix << "uuid = " << o.uuid << '\n'
+       << prefix << "checksums = " << std::boolalpha << o.checksums
+       << std::noboolalpha << '\n'
         ;
 
     return os;
@@ -30,13 +30,21 @@
 #include <algorithm>
 #include <sstream>
 #include <array>
+#include <cstring>
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
 #include <unistd.h>
 
+#ifdef __linux__
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+
 #include <boost/noncopyable.hpp>
+#include <boost/optional.hpp>
 #include <boost/crc.hpp>
 #include <boost/uuid/nil_generator.hpp>
 
@@ -72,6 +80,9 @@ namespace header_constants {
     const std::size_t size(28);
     const std::array<std::uint8_t, 5> magic({{ 'T', 'I', 'L', 'A', 'R' }});
     const Version version(0);
+    /** Version with per-file CRC32 checksums stored in the index.
+     */
+    const Version checksumVersion(1);
 
     namespace index {
         const int version(5);
@@ -200,6 +211,109 @@ off_t truncate(const Filedes &fd, off_t size)
     return seekFromStart(fd, size);
 }
 
+/** Flushes file data and metadata needed to read them back to disk.
+ */
+void syncData(const Filedes &fd)
+{
+#ifdef __linux__
+    const auto res(::fdatasync(fd));
+#else
+    const auto res(::fsync(fd));
+#endif
+    if (-1 == res) {
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError
+             ("Failed to sync tilar file %s.", fd.path()));
+        LOG(err2) << e.what();
+        throw e;
+    }
+}
+
+/** Releases disk space occupied by given range (punches a hole into the
+ *  file). Returns false if not supported by the filesystem.
+ */
+bool punchHole(const Filedes &fd, off_t start, off_t size)
+{
+    if (size <= 0) { return true; }
+
+#ifdef __linux__
+    if (-1 == ::fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE
+                          , start, size))
+    {
+        if ((EOPNOTSUPP == errno) || (ENOSYS == errno)) {
+            LOG(info1)
+                << "Cannot release space in tilar file " << fd.path()
+                << ": not supported by filesystem.";
+            return false;
+        }
+
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError
+             ("Failed to release space in tilar file %s.", fd.path()));
+        LOG(err2) << e.what();
+        throw e;
+    }
+    return true;
+#else
+    (void) start;
+    LOG(info1) << "Cannot release space in tilar file " << fd.path()
+               << ": not supported on this platform.";
+    return false;
+#endif
+}
+
+/** Preallocates disk space for given range without changing file size.
+ *  Returns false if not supported by the filesystem.
+ */
+bool preallocate(const Filedes &fd, off_t start, off_t size)
+{
+#ifdef __linux__
+    if (-1 == ::fallocate(fd, FALLOC_FL_KEEP_SIZE, start, size)) {
+        if ((EOPNOTSUPP == errno) || (ENOSYS == errno)) {
+            LOG(info1)
+                << "Cannot preallocate space in tilar file " << fd.path()
+                << ": not supported by filesystem.";
+            return false;
+        }
+
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError
+             ("Failed to preallocate space in tilar file %s.", fd.path()));
+        LOG(err2) << e.what();
+        throw e;
+    }
+    return true;
+#else
+    (void) start; (void) size;
+    LOG(info1) << "Cannot preallocate space in tilar file " << fd.path()
+               << ": not supported on this platform.";
+    return false;
+#endif
+}
+
+/** Returns number of physical extents of the file or -1 if unknown.
+ */
+int extentCount(const Filedes &fd)
+{
+#ifdef __linux__
+    struct ::fiemap fm;
+    std::memset(&fm, 0, sizeof(fm));
+    fm.fm_start = 0;
+    fm.fm_length = FIEMAP_MAX_OFFSET;
+    // no extent buffer -> just count extents
+    fm.fm_extent_count = 0;
+
+    if (-1 == ::ioctl(fd, FS_IOC_FIEMAP, &fm)) { return -1; }
+    return fm.fm_mapped_extents;
+#else
+    (void) fd;
+    return -1;
+#endif
+}
+
 template <typename Block>
 void write(const Filedes &fd, const Block &block)
 {
@@ -272,6 +386,36 @@ Filedes openFile(const fs::path &path, int flags, bool noSuchFile = true)
     return fd;
 }
 
+/** Computes CRC32 of given range of a file by sequential reading. Returns
+ *  nothing if file ends before end of range.
+ */
+boost::optional<std::uint32_t>
+checksum(const Filedes &fd, off_t start, off_t end, bool ignoreInterrupts)
+{
+    boost::crc_32_type crc;
+    std::vector<char> buffer(IOBufferSize);
+
+    while (start < end) {
+        const auto size(std::min(off_t(buffer.size()), end - start));
+        auto bytes(::pread(fd, buffer.data(), size, start));
+        if (-1 == bytes) {
+            if ((EINTR == errno) && ignoreInterrupts) { continue; }
+            std::system_error e
+                (errno, std::system_category()
+                 , utility::formatError
+                 ("Unable to read from tilar file %s.", fd.path()));
+            LOG(err2) << e.what();
+            throw e;
+        }
+        if (!bytes) { return boost::none; }
+
+        crc.process_bytes(buffer.data(), bytes);
+        start += bytes;
+    }
+
+    return crc.checksum();
+}
+
 std::uint32_t crc(std::uint8_t version, const Tilar::Options &options)
 {
     boost::crc_32_type crc;
@@ -299,7 +443,7 @@ std::tuple<Tilar::Options, std::uint8_t> loadHeader(const Filedes &fd)
     }
 
     auto version(header[header_constants::index::version]);
-    if (version != header_constants::version) {
+    if (version > header_constants::checksumVersion) {
         LOGTHROW(err1, std::runtime_error)
             << "Invalid version in header of tilar file "
             << fd.path() << ": " << int(version) << ".";
@@ -307,6 +451,7 @@ std::tuple<Tilar::Options, std::uint8_t> loadHeader(const Filedes &fd)
 
     Tilar::Options options(header[header_constants::index::binaryOrder]
                            , header[header_constants::index::filesPerTile]);
+    options.checksums = (version >= header_constants::checksumVersion);
 
     std::copy(header.begin() + header_constants::index::uuid
               , header.begin()
@@ -330,7 +475,8 @@ Version saveHeader(const Filedes &fd, const Tilar::Options &options)
 {
     LOG(info1) << "Saving archive header.";
 
-    auto version(header_constants::version);
+    auto version(options.checksums ? header_constants::checksumVersion
+                 : header_constants::version);
 
     std::array<std::uint8_t, header_constants::size> header;
     std::copy(header_constants::magic.begin(), header_constants::magic.end()
@@ -349,6 +495,13 @@ Version saveHeader(const Filedes &fd, const Tilar::Options &options)
     return version;
 }
 
+/** Returns options with checksum flag matching given archive version.
+ */
+inline Tilar::Options versioned(Tilar::Options options, Version version) {
+    options.checksums = (version >= header_constants::checksumVersion);
+    return options;
+}
+
 inline unsigned int edge(const Tilar::Options &o) {
     return 1u << o.binaryOrder;
 }
@@ -371,6 +524,8 @@ public:
         bool valid() const { return start > 0; }
 
         std::uint32_t end() const { return start + size; }
+
+        typedef std::vector<Slot> list;
     };
 
     ArchiveIndex(const Tilar::Options &options)
@@ -379,6 +534,7 @@ public:
         , rowSkip_(edge_)
         , typeSkip_(tiles(options))
         , grid_(files(options), Slot())
+        , checksums_(options.checksums ? files(options) : 0, 0)
         , previous_(0), overhead_(0), timestamp_(0)
         , changed_(false), loadedFrom_(0)
     {}
@@ -398,18 +554,32 @@ public:
      */
     void clear();
 
-    void set(const FileIndex &index, off_t start, off_t end);
+    void set(const FileIndex &index, off_t start, off_t end
+             , std::uint32_t checksum = 0);
 
     void unset(const FileIndex &index);
 
     const Slot& get(const FileIndex &index) const { return slot(index); }
 
+    /** Returns stored checksum of given file (0 if not stored).
+     */
+    std::uint32_t checksum(const FileIndex &index) const {
+        if (checksums_.empty()) { return 0; }
+        return checksums_[position(index)];
+    }
+
     std::uint32_t crc(std::uint32_t overhead) const;
     bool changed() const { return changed_; }
-    void freshen() { changed_ = false; }
+    void freshen() { changed_ = false; freed_.clear(); }
+
+    /** Data ranges no longer referenced by this index since last
+     *  load/save.
+     */
+    const Slot::list& freed() const { return freed_; }
 
     int savedSize() const {
-        return index_constants::size + (grid_.size() * sizeof(Slot));
+        return (index_constants::size + (grid_.size() * sizeof(Slot))
+                + (checksums_.size() * sizeof(Checksums::value_type)));
     }
 
     Tilar::Entry::list list() const;
@@ -441,34 +611,40 @@ public:
     }
 
 private:
-    inline Slot& slot(const FileIndex &index) {
+    inline std::size_t position(const FileIndex &index) const {
         check(index);
-        return grid_[index.col
-                     + (rowSkip_ * index.row)
-                     + (typeSkip_ * index.type)];
+        return (index.col + (rowSkip_ * index.row)
+                + (typeSkip_ * index.type));
+    }
+
+    inline Slot& slot(const FileIndex &index) {
+        return grid_[position(index)];
     }
 
     inline const Slot& slot(const FileIndex &index) const {
-        check(index);
-        return grid_[index.col
-                     + (rowSkip_ * index.row)
-                     + (typeSkip_ * index.type)];
+        return grid_[position(index)];
     }
 
     typedef std::vector<Slot> Grid;
 
+    /** CRC32 of every file, parallel to grid. Empty if not stored.
+     */
+    typedef std::vector<std::uint32_t> Checksums;
+
     const Tilar::Options options_;
     const unsigned int edge_;
     const unsigned int rowSkip_;
     const unsigned int typeSkip_;
 
     Grid grid_;
+    Checksums checksums_;
     std::uint32_t previous_;
     std::uint32_t overhead_;
     std::uint64_t timestamp_;
 
     bool changed_;
     std::uint32_t loadedFrom_;
+    Slot::list freed_;
 };
 
 std::uint32_t ArchiveIndex::crc(std::uint32_t overhead) const
@@ -477,6 +653,11 @@ std::uint32_t ArchiveIndex::crc(std::uint32_t overhead) const
     crc.process_bytes(&overhead, sizeof(overhead));
     crc.process_bytes(&timestamp_, sizeof(timestamp_));
     crc.process_bytes(grid_.data(), grid_.size());
+    if (!checksums_.empty()) {
+        crc.process_bytes(checksums_.data()
+                          , checksums_.size()
+                          * sizeof(Checksums::value_type));
+    }
     return crc.checksum();
 }
 
@@ -505,6 +686,7 @@ off_t ArchiveIndex::save(const Filedes &fd, off_t end)
 
     write(fd, header);
     write(fd, grid_);
+    if (!checksums_.empty()) { write(fd, checksums_); }
 
     // update overhead
     overhead_ = overhead;
@@ -540,6 +722,7 @@ void ArchiveIndex::load(const Filedes &fd, off_t pos, bool checkCrc)
     deserialize(header, index_constants::index::crc32, savedCrc);
 
     read(fd, grid_);
+    if (!checksums_.empty()) { read(fd, checksums_); }
 
     if (checkCrc) {
         auto computedCrc(crc(overhead_));
@@ -554,35 +737,45 @@ void ArchiveIndex::load(const Filedes &fd, off_t pos, bool checkCrc)
 
     loadedFrom_ = start;
     changed_ = false;
+    freed_.clear();
 }
 
 void ArchiveIndex::clear()
 {
     grid_.assign(grid_.size(), Slot());
+    checksums_.assign(checksums_.size(), 0);
     changed_ = false;
+    freed_.clear();
 }
 
-void ArchiveIndex::set(const FileIndex &index, off_t start, off_t end)
+void ArchiveIndex::set(const FileIndex &index, off_t start, off_t end
+                       , std::uint32_t checksum)
 {
     const auto size(end - start);
-    auto &s(slot(index));
+    const auto pos(position(index));
+    auto &s(grid_[pos]);
 
     if (s.valid()) {
         overhead_ += size;
+        freed_.push_back(s);
     }
 
     changed_ = (s.start != start);
     s.start = start;
     s.size = size;
+    if (!checksums_.empty()) { checksums_[pos] = checksum; }
 }
 
 void ArchiveIndex::unset(const FileIndex &index)
 {
-    auto &s(slot(index));
+    const auto pos(position(index));
+    auto &s(grid_[pos]);
 
     if (s.valid()) {
         overhead_ += s.size;
+        freed_.push_back(s);
         s.start = s.size = 0;
+        if (!checksums_.empty()) { checksums_[pos] = 0; }
         changed_ = true;
     }
 }
@@ -597,7 +790,10 @@ Tilar::Entry::list ArchiveIndex::list() const
         for (index.row = 0; index.row < edge_; ++index.row) {
             for (index.col = 0; index.col < edge_; ++index.col, ++fgrid) {
                 if (!fgrid->valid()) { continue; }
-                list.emplace_back(index, fgrid->start, fgrid->size);
+                list.emplace_back
+                    (index, fgrid->start, fgrid->size
+                     , (checksums_.empty()
+                        ? 0 : checksums_[fgrid - grid_.begin()]));
             }
         }
     }
@@ -607,7 +803,8 @@ Tilar::Entry::list ArchiveIndex::list() const
 
 Tilar::Info ArchiveIndex::info() const
 {
-    return { loadedFrom_, previous_, overhead_, std::time_t(timestamp_) };
+    return { loadedFrom_, previous_, overhead_, std::time_t(timestamp_)
+            , 0, 0 };
 }
 
 FileStat ArchiveIndex::stat(const FileIndex &index) const
@@ -631,10 +828,11 @@ struct Tilar::Detail
     Detail(std::uint8_t version, const Options &options
            , Filedes &&srcFd, bool readOnly
            , std::uint32_t indexOffset)
-        : version(version), options(options), fd(std::move(srcFd))
-        , readOnly(readOnly), index(options)
+        : version(version), options(versioned(options, version))
+        , fd(std::move(srcFd)), readOnly(readOnly), index(this->options)
         , checkpoint(fileSize(fd)), currentEnd(checkpoint), tx(0)
-        , ignoreInterrupts(false)
+        , ignoreInterrupts(false), reclaimSpace(false)
+        , preallocate(0), allocatedEnd(0)
         , indexOffset(indexOffset)
         , shareCount_(0), pendingDetachment_(false)
     {
@@ -702,10 +900,11 @@ struct Tilar::Detail
                 "in archive " << fd.path() << ".";
         }
         truncate(getFd(), tx);
+        allocatedEnd = 0;
         tx = 0;
     }
 
-    void commit(off_t end) {
+    void commit(off_t end, std::uint32_t checksum) {
         wannaWrite("commit a transaction (tx=%d)", tx);
         if (!tx) {
             LOGTHROW(err2, PendingTransaction)
@@ -714,13 +913,31 @@ struct Tilar::Detail
         }
 
         // update index slot and forget transaction
-        index.set(txIndex, tx, end);
+        index.set(txIndex, tx, end, checksum);
         currentEnd = end;
         tx = 0;
     }
 
     void setCurrentEnd(off_t end) { currentEnd = end; }
 
+    /** Makes sure space up to given end is preallocated (if enabled).
+     */
+    void reserve(off_t end);
+
+    /** Releases unused preallocated space past the end of file.
+     */
+    void releasePreallocated();
+
+    /** Punches holes in place of data no longer referenced by the index.
+     */
+    void releaseFreed();
+
+    std::uint64_t reclaim();
+
+    Tilar::Info info();
+
+    Tilar::Verification verify(unsigned int sampling, unsigned int phase);
+
     bool changed() const {
         return (!readOnly && (index.changed() || (currentEnd > checkpoint)));
     }
@@ -791,6 +1008,16 @@ struct Tilar::Detail
     off_t tx;
 
     bool ignoreInterrupts;
+    bool reclaimSpace;
+
+    /** Preallocation chunk size.
+     */
+    std::size_t preallocate;
+
+    /** End of preallocated space.
+     */
+    off_t allocatedEnd;
+
     std::uint32_t indexOffset;
 
     ContentTypes contentTypes;
@@ -819,10 +1046,181 @@ void Tilar::Detail::commitChanges()
     if (changed()) {
         // save index and remember new checkpoint/file end
         checkpoint = currentEnd = index.save(getFd(), currentEnd);
+
+        // drop data unreferenced by new index (synced first)
+        if (reclaimSpace) { releaseFreed(); }
+        releasePreallocated();
+
         index.freshen();
     }
 }
 
+void Tilar::Detail::reserve(off_t end)
+{
+    if (!preallocate || (end <= allocatedEnd)) { return; }
+
+    // preallocate whole chunks from current end
+    const off_t start(std::max(allocatedEnd, currentEnd));
+    const off_t chunk(preallocate);
+    const off_t size(((end - start + chunk - 1) / chunk) * chunk);
+
+    if (!storage::preallocate(getFd(), start, size)) {
+        // not supported, do not try again
+        preallocate = 0;
+        return;
+    }
+    allocatedEnd = start + size;
+}
+
+void Tilar::Detail::releasePreallocated()
+{
+    if (allocatedEnd > currentEnd) {
+        punchHole(getFd(), currentEnd, allocatedEnd - currentEnd);
+    }
+    allocatedEnd = 0;
+}
+
+void Tilar::Detail::releaseFreed()
+{
+    if (index.freed().empty()) { return; }
+
+    // new index must be on disk before any hole is punched: hole punching
+    // can become durable sooner and old index would point to zeroed data
+    syncData(getFd());
+
+    std::uint64_t released(0);
+    for (const auto &slot : index.freed()) {
+        if (!punchHole(getFd(), slot.start, slot.size)) {
+            // not supported, do not try again
+            reclaimSpace = false;
+            return;
+        }
+        released += slot.size;
+    }
+
+    if (released) {
+        LOG(info1) << "Released " << released << " bytes in tilar file "
+                   << fd.path() << ".";
+    }
+}
+
+std::uint64_t Tilar::Detail::reclaim()
+{
+    wannaWrite("reclaim space");
+    if (tx || changed()) {
+        LOGTHROW(err2, PendingTransaction)
+            << "Cannot reclaim space: uncommitted changes in archive "
+            << fd.path() << ".";
+    }
+
+    const off_t indexStart(index.info().offset);
+    if (!indexStart) { return 0; }
+
+    auto entries(index.list());
+    std::sort(entries.begin(), entries.end()
+              , [](const Tilar::Entry &l, const Tilar::Entry &r)
+    {
+        return l.start < r.start;
+    });
+
+    // current index must be on disk before any hole is punched, see
+    // releaseFreed()
+    syncData(getFd());
+
+    std::uint64_t released(0);
+    auto release([&](off_t start, off_t end) -> bool
+    {
+        if (end <= start) { return true; }
+        if (!punchHole(getFd(), start, end - start)) { return false; }
+        released += (end - start);
+        return true;
+    });
+
+    // walk through gaps between used ranges
+    off_t pos(header_constants::size);
+    for (const auto &entry : entries) {
+        if (!release(pos, entry.start)) { return 0; }
+        pos = std::max(pos, off_t(entry.start + entry.size));
+    }
+    if (!release(pos, indexStart)) { return 0; }
+
+    LOG(info2) << "Released " << released << " bytes in tilar file "
+               << fd.path() << ".";
+    return released;
+}
+
+Tilar::Info Tilar::Detail::info()
+{
+    auto info(index.info());
+
+    const auto &fd(getFd());
+    struct ::stat buf;
+    if (-1 == ::fstat(fd, &buf)) {
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError
+             ("Failed to stat tilar file %s.", fd.path()));
+        LOG(err2) << e.what();
+        throw e;
+    }
+
+    info.fileSize = buf.st_size;
+    info.allocated = std::uint64_t(buf.st_blocks) * 512;
+    return info;
+}
+
+Tilar::Verification Tilar::Detail::verify(unsigned int sampling
+                                          , unsigned int phase)
+{
+    if (!sampling) { sampling = 1; }
+
+    Tilar::Verification v;
+    v.checksums = options.checksums;
+
+    // stream files in order of their position in the file
+    auto entries(index.list());
+    std::sort(entries.begin(), entries.end()
+              , [](const Tilar::Entry &l, const Tilar::Entry &r)
+    {
+        return l.start < r.start;
+    });
+
+    const auto &fd(getFd());
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    std::size_t i(0);
+    for (const auto &entry : entries) {
+        if ((i++ % sampling) != (phase % sampling)) {
+            ++v.skipped;
+            continue;
+        }
+
+        const auto computed(checksum(fd, entry.start
+                                     , entry.start + entry.size
+                                     , ignoreInterrupts));
+        ++v.verified;
+
+        if (!computed) {
+            LOG(warn2)
+                << "File " << entry.index << " in tilar file " << fd.path()
+                << " is truncated.";
+            v.corrupted.push_back(entry);
+            continue;
+        }
+
+        v.bytes += entry.size;
+        if (v.checksums && (*computed != entry.checksum)) {
+            LOG(warn2)
+                << "File " << entry.index << " in tilar file " << fd.path()
+                << " is corrupted; expected CRC32 0x" << std::hex
+                << entry.checksum << ", computed 0x" << *computed << ".";
+            v.corrupted.push_back(entry);
+        }
+    }
+
+    return v;
+}
+
 void Tilar::Detail::discardChanges()
 {
     if (tx) {
@@ -832,7 +1230,9 @@ void Tilar::Detail::discardChanges()
     }
 
     if (changed()) {
+        // NB: truncation drops any preallocated space as well
         currentEnd = truncate(getFd(), checkpoint);
+        allocatedEnd = 0;
         loadIndex();
     }
 }
@@ -1014,7 +1414,7 @@ public:
     Device(const Tilar::Detail::pointer &owner, const FileIndex &index, Append)
         : owner(owner), path(owner->getFd().path()), index(index)
         , start(seekFromEnd(owner->getFd())), pos(start)
-        , end(0), writeEnd(0)
+        , end(0), writeEnd(0), crcEnd(start)
     {
         owner->begin(index, start);
         owner->share();
@@ -1023,7 +1423,7 @@ public:
     // read constructor
     Device(const Tilar::Detail::pointer &owner, const FileIndex &index)
         : owner(owner), path(owner->getFd().path()), index(index)
-        , start(0), pos(0), end(0), writeEnd(0)
+        , start(0), pos(0), end(0), writeEnd(0), crcEnd(0)
     {
         const auto &slot(owner->index.get(index));
         if (!slot.valid()) {
@@ -1061,7 +1461,7 @@ public:
     void commit() {
         if (pos) {
             // commit transaction
-            owner->commit(pos);
+            owner->commit(pos, checksum());
             // mark as commited
             pos = 0;
         }
@@ -1074,7 +1474,18 @@ public:
         return os.str();
     }
 
-    void written(off_t bytes) {
+    void written(const char *data, off_t bytes) {
+        if (owner->options.checksums) {
+            // update running checksum only when appending sequentially;
+            // rewritten data is checksummed at commit time
+            if (pos == crcEnd) {
+                crc.process_bytes(data, bytes);
+                crcEnd += bytes;
+            } else {
+                crcEnd = -1;
+            }
+        }
+
         owner->setCurrentEnd(pos += bytes);
 
         // move write end if beyond current
@@ -1091,6 +1502,22 @@ public:
      */
     Filedes& fd() { return owner->getFd(); }
 
+    /** Checksum of written data.
+     */
+    std::uint32_t checksum() {
+        if (!owner->options.checksums) { return 0; }
+        if (crcEnd == pos) { return crc.checksum(); }
+
+        // data were rewritten or stream was rewound, read them back
+        const auto value(storage::checksum(fd(), start, pos
+                                           , ignoreInterrupts()));
+        if (!value) {
+            LOGTHROW(err2, std::runtime_error)
+                << "Unable to compute checksum of file " << name() << ".";
+        }
+        return *value;
+    }
+
     Tilar::Detail::pointer owner;
     boost::filesystem::path path;
 
@@ -1100,6 +1527,12 @@ public:
     off_t pos;
     off_t end;
     off_t writeEnd;
+
+    /** Running checksum of data in range [start, crcEnd), crcEnd is -1 if
+     *  sequential write was broken.
+     */
+    boost::crc_32_type crc;
+    off_t crcEnd;
 };
 
 class Tilar::Sink {
@@ -1258,6 +1691,8 @@ private:
 
 std::streamsize Tilar::Sink::write(const char *data, std::streamsize size)
 {
+    device_->owner->reserve(device_->pos + size);
+
     const auto &fd(device_->fd());
     for (;;) {
         auto bytes(::pwrite(fd, data, size, device_->pos));
@@ -1272,7 +1707,7 @@ std::streamsize Tilar::Sink::write(const char *data, std::streamsize size)
             LOG(err2) << e.what();
             throw e;
         }
-        device_->written(bytes);
+        device_->written(data, bytes);
         return bytes;
     }
 }
@@ -1435,6 +1870,14 @@ FileStat Tilar::stat(const FileIndex &index)
     return detail().index.stat(index);
 }
 
+Tilar::Entry Tilar::entry(const FileIndex &index) const
+{
+    if (!detail().index.exists(index)) { return Entry(index, 0, 0); }
+    const auto &slot(detail().index.get(index));
+    return Entry(index, slot.start, slot.size
+                 , detail().index.checksum(index));
+}
+
 void Tilar::remove(const FileIndex &index)
 {
     detail().index.unset(index);
@@ -1447,7 +1890,18 @@ Tilar::Entry::list Tilar::list() const
 
 Tilar::Info Tilar::info() const
 {
-    return detail().index.info();
+    return detail_->info();
+}
+
+int Tilar::extents() const
+{
+    return extentCount(detail_->getFd());
+}
+
+Tilar::Verification Tilar::verify(unsigned int sampling, unsigned int phase)
+    const
+{
+    return detail_->verify(sampling, phase);
 }
 
 const Tilar::Options& Tilar::options() const
@@ -1465,6 +1919,31 @@ void Tilar::ignoreInterrupts(bool value)
     detail().ignoreInterrupts = value;
 }
 
+bool Tilar::reclaimSpace() const
+{
+    return detail().reclaimSpace;
+}
+
+void Tilar::reclaimSpace(bool value)
+{
+    detail().reclaimSpace = value;
+}
+
+std::size_t Tilar::preallocate() const
+{
+    return detail().preallocate;
+}
+
+void Tilar::preallocate(std::size_t chunk)
+{
+    detail().preallocate = chunk;
+}
+
+std::uint64_t Tilar::reclaim()
+{
+    return detail().reclaim();
+}
+
 void Tilar::expect(const Options &options)
 {
     if (options != detail().options) {
@@ -1490,7 +1969,7 @@ fs::path Tilar::path() const { return detail().path(); }
 
 Tilar::Options::Options(unsigned int binaryOrder, unsigned int filesPerTile)
     : binaryOrder(binaryOrder), filesPerTile(filesPerTile)
-    , uuid(boost::uuids::nil_uuid())
+    , uuid(boost::uuids::nil_uuid()), checksums(false)
 {}
 
 bool Tilar::Options::operator==(const Options &o) const
@@ -75,6 +75,12 @@ public:
          */
         boost::uuids::uuid uuid;
 
+        /** Store CRC32 checksum of every file in the index. Honored only when
+         *  new file is created, appended file keeps its own format. Not
+         *  compared by operator==.
+         */
+        bool checksums;
+
         bool operator==(const Options &o) const;
 
         bool operator!=(const Options &o) const {
@@ -84,8 +90,9 @@ public:
         Options(unsigned int binaryOrder = 0, unsigned int filesPerTile = 0);
 
         Options(unsigned int binaryOrder, unsigned int filesPerTile
-                , const boost::uuids::uuid &uuid)
+                , const boost::uuids::uuid &uuid, bool checksums = false)
             : binaryOrder(binaryOrder), filesPerTile(filesPerTile), uuid(uuid)
+            , checksums(checksums)
         {}
     };
 
@@ -179,9 +186,13 @@ public:
         std::uint32_t start;
         std::uint32_t size;
 
+        /** CRC32 of file content. Valid only if archive stores checksums.
+         */
+        std::uint32_t checksum;
+
         Entry(const FileIndex &index, std::uint32_t start
-              , std::uint32_t size)
-            : index(index), start(start), size(size) {}
+              , std::uint32_t size, std::uint32_t checksum = 0)
+            : index(index), start(start), size(size), checksum(checksum) {}
 
         typedef std::vector<Entry> list;
     };
@@ -204,6 +215,42 @@ public:
         /** Timestamp when this index has been saved.
          */
         std::time_t modified;
+
+        /** Logical size of the file.
+         */
+        std::uint64_t fileSize;
+
+        /** Disk space really occupied by the file.
+         */
+        std::uint64_t allocated;
+    };
+
+    /** Result of archive verification.
+     */
+    struct Verification {
+        /** True if archive stores checksums. Otherwise only readability of
+         *  files is checked.
+         */
+        bool checksums;
+
+        /** Number of verified files.
+         */
+        std::size_t verified;
+
+        /** Number of files skipped due to sampling.
+         */
+        std::size_t skipped;
+
+        /** Number of bytes read.
+         */
+        std::uint64_t bytes;
+
+        /** Files with checksum mismatch or truncated content.
+         */
+        Entry::list corrupted;
+
+        Verification()
+            : checksums(false), verified(), skipped(), bytes() {}
     };
 
     /** Flushes file to the disk (writes new index if needed).
@@ -244,6 +291,11 @@ public:
      */
     FileStat stat(const FileIndex &index);
 
+    /** Get file's location in the archive. Returns entry with zero start and
+     *  size if file doesn't exist.
+     */
+    Entry entry(const FileIndex &index) const;
+
     /** Removes file at given index.
      */
     void remove(const FileIndex &index);
@@ -254,6 +306,27 @@ public:
 
     Info info() const;
 
+    /** Returns number of physical extents the file is stored in (i.e.
+     *  measure of read locality). Negative if unknown. Asks the filesystem,
+     *  not for frequent use.
+     */
+    int extents() const;
+
+    /** Verifies content of stored files. Files are streamed sequentially in
+     *  order of their position in the archive and their CRC32 is compared
+     *  with the checksum stored in the index.
+     *
+     *  Only every sampling-th file (in archive order, starting at phase) is
+     *  verified when sampling > 1; rotating phase between runs spreads a
+     *  scrub over time.
+     *
+     *  \param sampling verify every sampling-th file (0 or 1 = all files)
+     *  \param phase index of first verified file
+     *  \return verification summary
+     */
+    Verification verify(unsigned int sampling = 1, unsigned int phase = 0)
+        const;
+
     /** Returns true if low-level I/O ignores interrupts.
      */
     bool ignoreInterrupts() const;
@@ -262,6 +335,41 @@ public:
      */
     void ignoreInterrupts(bool value);
 
+    /** Returns true if disk space of replaced/removed files is released on
+     *  commit.
+     */
+    bool reclaimSpace() const;
+
+    /** Sets space reclamation flag. When set, data of files replaced or
+     *  removed since last commit are released from the disk (hole is punched
+     *  into the file) once the new index is written. Older revisions of the
+     *  index may reference released data and thus they must not be used
+     *  after reclamation.
+     *
+     *  Silently ignored when not supported by the underlying filesystem.
+     */
+    void reclaimSpace(bool value);
+
+    /** Returns preallocation chunk size (0 = no preallocation).
+     */
+    std::size_t preallocate() const;
+
+    /** Sets preallocation chunk size. When non-zero, disk space is
+     *  preallocated in chunks of given size while writing to keep the file
+     *  contiguous. Unused preallocated space is released on commit.
+     */
+    void preallocate(std::size_t chunk);
+
+    /** Releases all disk space not used by any current file or current
+     *  index (i.e. space of all replaced or removed files and all older
+     *  indices). Archive must have no uncommitted changes. Older revisions of
+     *  the index must not be used afterwards.
+     *
+     *  \return number of bytes released (upper bound, filesystem works with
+     *          whole blocks)
+     */
+    std::uint64_t reclaim();
+
     /** Detaches open archive from the file (i.e. closes file).
      *
      *  Once file access is needed archive attaches itself to the file again.
@@ -320,7 +428,9 @@ operator<<(std::basic_ostream<CharT, Traits> &os, const Tilar::Options &o)
 {
     os << "{binaryOrder=" << o.binaryOrder
        << ", filesPerTile=" << o.filesPerTile
-       << ", uuid=" << o.uuid << "}";
+       << ", uuid=" << o.uuid;
+    if (o.checksums) { os << ", checksums"; }
+    os << "}";
     return os;
 }
 
@@ -283,9 +283,10 @@ class Saver {
 public:
     Saver(long baseTileSize, const LodLevels &metaLevels
           , const unsigned int version
-          , const MetaNodeSaver &saver)
+          , const MetaNodeSaver &saver
+          , bool recursive = true)
         : baseTileSize(baseTileSize), metaLevels(metaLevels)
-        , version(version), saver(saver)
+        , version(version), saver(saver), recursive(recursive)
     {}
 
     void operator()(const TileId &foat);
@@ -299,6 +300,7 @@ private:
     LodLevels metaLevels;
     const unsigned int version;
     const MetaNodeSaver &saver;
+    bool recursive;
 
     std::queue<MetatileDef> subtrees;
 };
@@ -357,8 +359,10 @@ void Saver::saveMetatileTree(std::ostream &f, const MetatileDef &tile)
         if ((childFlags & mask)) {
             if (bottom) {
                 // we are at the bottom of the metatile; remember subtree
-                subtrees.emplace
-                    (childId, deltaDown(metaLevels, childId.lod));
+                if (recursive) {
+                    subtrees.emplace
+                        (childId, deltaDown(metaLevels, childId.lod));
+                }
             } else {
                 // save subtree in this tile
                 saveMetatileTree
@@ -388,4 +392,12 @@ void saveMetatile(long baseTileSize, const TileId &foat
     Saver(baseTileSize, metaLevels, METATILE_IO_VERSION, saver)(foat);
 }
 
+void saveSingleMetatile(long baseTileSize, const TileId &metaId
+                        , const LodLevels &metaLevels
+                        , const MetaNodeSaver &saver)
+{
+    Saver(baseTileSize, metaLevels, METATILE_IO_VERSION, saver, false)
+        (metaId);
+}
+
 } } // namespace vtslibs::tilestorage
@@ -128,6 +128,14 @@ void saveMetatile(long baseTileSize, const TileId &foat
                   , const LodLevels &metaLevels
                   , const MetaNodeSaver &saver);
 
+/** Saves only metatile rooted at given tile. Metatiles below are not
+ *  touched. Metatile root must be aligned to metatile grid (i.e. it is either
+ *  foat or a tile as returned by findMetatile).
+ */
+void saveSingleMetatile(long baseTileSize, const TileId &metaId
+                        , const LodLevels &metaLevels
+                        , const MetaNodeSaver &saver);
+
 
 // inline method implementation
 
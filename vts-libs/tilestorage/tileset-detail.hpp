@@ -59,6 +59,8 @@ struct TileSet::Detail {
     mutable Metadata metadata;    // all metadata as in-memory structure
     mutable TileIdSet loadedMetatiles; // marks that given tiles are loaded
     bool metadataChanged;         // marks whether metadata have been changed
+    TileIdSet dirtyMetatiles;     // metatiles touched since last save
+    bool metadataRewrite;         // forces full metadata rewrite on save
 
     bool tx; // pending transaction?
 
@@ -79,6 +81,16 @@ struct TileSet::Detail {
 
     void saveMetadata();
 
+    /** Returns true if only dirty metatiles need to be written on save.
+     */
+    bool incrementalSave() const;
+
+    void saveDirtyMetadata();
+
+    /** Marks metanode (and its metatile) as changed.
+     */
+    void markDirty(const TileId &tileId);
+
     void loadTileIndex();
 
     Tile getTile(const TileId &tileId) const;
@@ -124,7 +136,8 @@ struct TileSet::Detail {
 
     void dropRemovedMetatiles(const TileIndex &before, const TileIndex &after);
 
-    void saveMetatiles(TileIndex &tileIndex, TileIndex &metaIndex) const;
+    void saveMetatiles(TileIndex &tileIndex, TileIndex &metaIndex
+                       , const TileIdSet *metatiles = nullptr) const;
 
     void begin(utility::Runnable *runnable);
 
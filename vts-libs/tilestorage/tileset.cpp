@@ -216,7 +216,7 @@ TileSet::pointer cloneTileSet(const TileSet::pointer &dst
 
 TileSet::Detail::Detail(const Driver::pointer &driver)
     : driver(driver), propertiesChanged(false)
-    , metadataChanged(false)
+    , metadataChanged(false), metadataRewrite(false)
     , tx(false)
 {
     loadConfig();
@@ -231,7 +231,7 @@ TileSet::Detail::Detail(const Driver::pointer &driver)
 TileSet::Detail::Detail(const Driver::pointer &driver
                         , const CreateProperties &properties)
     : driver(driver), propertiesChanged(false)
-    , metadataChanged(false)
+    , metadataChanged(false), metadataRewrite(false)
     , tx(false)
 {
     const auto &sp(properties.staticProperties);
@@ -335,6 +335,12 @@ void TileSet::Detail::saveMetadata()
 {
     driver->wannaWrite("save metadata");
 
+    if (incrementalSave()) {
+        // only few metatiles were touched, no need to rebuild everything
+        saveDirtyMetadata();
+        return;
+    }
+
     // purge out nonexistent leaves from metadata tree (recalculates extents)
     purgeMetadata();
 
@@ -377,6 +383,68 @@ void TileSet::Detail::saveMetadata()
 
     // saved => no change
     metadataChanged = false;
+    metadataRewrite = false;
+    dirtyMetatiles.clear();
+}
+
+bool TileSet::Detail::incrementalSave() const
+{
+    // metatile layout is derived from foat and meta levels; any change there
+    // (or anything not tracked by markDirty) means full rewrite
+    return (!metadataRewrite
+            && savedProperties.foatSize
+            && !metaIndex.empty()
+            && (properties.foat == savedProperties.foat)
+            && (properties.foatSize == savedProperties.foatSize)
+            && (properties.metaLevels == savedProperties.metaLevels));
+}
+
+void TileSet::Detail::saveDirtyMetadata()
+{
+    LOG(info2) << "Tile set <" << properties.id << ">: saving "
+               << dirtyMetatiles.size() << " changed metatile(s).";
+
+    // Nothing was removed since last save therefore extents and lod range
+    // can only grow; new indices are old ones extended to current extents
+    // (yielding the same layout as full rebuild) with touched regions
+    // updated by the saver below.
+    TileIndex ti(properties.alignment, properties.baseTileSize
+                 , extents, lodRange, &tileIndex);
+    TileIndex mi(properties.alignment, properties.baseTileSize
+                 , extents, {properties.foat.lod, lodRange.max}
+                 , &metaIndex);
+
+    // dump changed metatiles
+    saveMetatiles(ti, mi, &dirtyMetatiles);
+
+    // save index
+    try {
+        auto f(driver->output(File::tileIndex));
+        ti.save(*f);
+        mi.save(*f);
+        f->close();
+    } catch (const std::exception &e) {
+        LOGTHROW(err2, storage::Error)
+            << "Unable to write tile index: " << e.what() << ".";
+    }
+
+    tileIndex = ti;
+    metaIndex = mi;
+
+    // saved => no change
+    metadataChanged = false;
+    dirtyMetatiles.clear();
+}
+
+void TileSet::Detail::markDirty(const TileId &tileId)
+{
+    metadataChanged = true;
+
+    // metatile is computed against on-disk foat; tiles outside of it move
+    // the foat and force full rewrite anyway
+    if (savedProperties.foatSize) {
+        dirtyMetatiles.insert(findMetatile(savedProperties, tileId));
+    }
 }
 
 void TileSet::Detail::loadTileIndex()
@@ -424,6 +492,12 @@ MetaNode TileSet::Detail::setMetaNode(const TileId &tileId
     
     // invalid node = node removal -> no metadata update
     if (!valid(metanode)) {
+        if (old) {
+            // removal can shrink extents, lod range and foat; tree must be
+            // purged and fully rewritten
+            metadataRewrite = true;
+            metadataChanged = true;
+        }
         return metanode;
     }
 
@@ -434,6 +508,7 @@ MetaNode TileSet::Detail::setMetaNode(const TileId &tileId
     
     // now there surely is one
     auto newNode(*findMetaNode(tileId));
+    markDirty(tileId);
 
     // update extents/lod-range
     if (math::empty(extents)) {
@@ -486,7 +561,7 @@ TileSet::Detail::createVirtualMetaNode(const TileId &tileId)
                    << "): Created virtual tile " << tileId << ".";
     }
 
-    metadataChanged = true;
+    markDirty(tileId);
 
     // ok
     return *md;
@@ -590,7 +665,7 @@ void TileSet::Detail::setMetadata(const TileId &tileId
     // assign new metadata
     static_cast<TileMetadata&>(*metanode) = metadata;
 
-    metadataChanged = true;
+    markDirty(tileId);
 }
 
 void TileSet::Detail::check(const TileId &tileId) const
@@ -622,6 +697,8 @@ void TileSet::Detail::updateTreeMetadata(const TileId &tileId)
 void TileSet::Detail::updateTreeMetadata(const TileId &tileId
                                  , MetaNode &metanode)
 {
+    markDirty(tileId);
+
     // process all 4 children
     for (const auto &childId : children(properties.baseTileSize, tileId)) {
         if (auto *node = findMetaNode(childId)) {
@@ -646,6 +723,8 @@ void TileSet::Detail::updateTree(const TileId &tileId)
 void TileSet::Detail::updateTree(const TileId &tileId
                                  , MetaNode &metanode)
 {
+    markDirty(tileId);
+
     float minGsd = std::numeric_limits<float>::max();
     bool minGsdSet = false;
 
@@ -849,7 +928,8 @@ void TileSet::Detail::purgeMetadata()
     removeOverFoat();
 }
 
-void TileSet::Detail::saveMetatiles(TileIndex &tileIndex, TileIndex &metaIndex)
+void TileSet::Detail::saveMetatiles(TileIndex &tileIndex, TileIndex &metaIndex
+                                    , const TileIdSet *metatiles)
     const
 {
     if (!properties.foatSize) {
@@ -885,9 +965,20 @@ void TileSet::Detail::saveMetatiles(TileIndex &tileIndex, TileIndex &metaIndex)
         }
     };
 
-    tilestorage::saveMetatile(properties.baseTileSize, properties.foat
-                              , properties.metaLevels
-                              , Saver(*this, tileIndex, metaIndex));
+    Saver saver(*this, tileIndex, metaIndex);
+
+    if (!metatiles) {
+        // whole tree
+        tilestorage::saveMetatile(properties.baseTileSize, properties.foat
+                                  , properties.metaLevels, saver);
+        return;
+    }
+
+    // only given metatiles
+    for (const auto &metaId : *metatiles) {
+        tilestorage::saveSingleMetatile(properties.baseTileSize, metaId
+                                        , properties.metaLevels, saver);
+    }
 }
 
 Tile TileSet::Detail::getTile(const TileId &tileId) const
@@ -1041,6 +1132,8 @@ void TileSet::Detail::rollback()
     metadata = {};
     loadedMetatiles = {};
     metadataChanged = false;
+    metadataRewrite = false;
+    dirtyMetatiles = {};
     propertiesChanged = false;
 
     if (savedProperties.foatSize) {
@@ -1242,6 +1335,7 @@ void TileSet::Detail::clone(const Detail &src)
     if (!canCopy) {
         // tell flush we have to dump metadata to storage
         metadataChanged = true;
+        metadataRewrite = true;
     }
 
     flush();
@@ -1467,6 +1561,7 @@ void TileSet::AdvancedApi::changeMetaLevels(const LodLevels &metaLevels)
     detail.propertiesChanged = true;
     // force flush -> metatiles are about to be regenerated
     detail.metadataChanged = true;
+    detail.metadataRewrite = true;
 }
 
 void TileSet::AdvancedApi::changeSrs(const std::string& srs) 
@@ -1497,6 +1592,7 @@ void TileSet::AdvancedApi::changeSrs(const std::string& srs)
     detail.propertiesChanged = true;
     // force flush -> mapConfig is about to be regenerated
     detail.metadataChanged = true;
+    detail.metadataRewrite = true;
 }
 
 void TileSet::AdvancedApi::rename(const std::string &newId)
@@ -1540,6 +1636,7 @@ void TileSet::AdvancedApi::removeOutOfLodRange( const LodRange & lodRange )
     removeOutOfLodRange( detail.properties.foat, lodRange );
 
     detail.metadataChanged = true;
+    detail.metadataRewrite = true;
 }
 
 void TileSet::AdvancedApi::removeOutOfExtents( const TileId &tileId
@@ -1567,6 +1664,7 @@ void TileSet::AdvancedApi::removeOutOfExtents( const math::Extents2 & extents )
     removeOutOfExtents( detail.properties.foat, extents );
 
     detail.metadataChanged = true;
+    detail.metadataRewrite = true;
 }
 
 
@@ -1601,6 +1699,7 @@ void TileSet::AdvancedApi::forceMetadata( const TileMetadata &metadata
     forceMetadata( detail.properties.foat, metadata, mask );
 
     detail.metadataChanged = true;
+    detail.metadataRewrite = true;
 }
 
 bool TileSet::compatible(const TileSet &other)
@@ -472,7 +472,8 @@ Frontier::Tile::list createFrontier(const char *dumpDir
 
 class Node {
 public:
-    Node(TileMetadata *node) : node_(node) {}
+    Node(const TileId &tileId, TileMetadata *node)
+        : tileId(tileId), node_(node) {}
     void flush() const {
         std::copy
             (&heightmap[0][0]
@@ -480,6 +481,7 @@ public:
              , &node_->heightmap[0][0]);
     }
 
+    TileId tileId;
     TileMetadata::Heightmap heightmap;
 
     typedef std::vector<Node> list;
@@ -567,7 +569,7 @@ public:
             }
         }
 
-        updated_.emplace_back(tile);
+        updated_.emplace_back(center, tile);
         auto &hm(updated_.back().heightmap);
 
         auto applyDistance(calculateDistance(ftile.vicinity));
@@ -593,7 +595,10 @@ public:
     bool calculateDistance(const Vicinity &vicinity);
 
     void flush() {
-        for (auto &node : updated_) { node.flush(); }
+        for (auto &node : updated_) {
+            node.flush();
+            ts_.markDirty(node.tileId);
+        }
     }
 
     // reconstruction interface follows
@@ -23,8 +23,14 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <mutex>
+#include <atomic>
+#include <exception>
+
 #include <boost/format.hpp>
 
+#include "utility/openmp.hpp"
+
 #include "../tileset-detail.hpp"
 #include "../merge.hpp"
 #include "./dump.hpp"
@@ -159,6 +165,15 @@ struct Merger {
                       , int quadrant = -1
                       , bool parentGenerated = false);
 
+    /** Merges all subtrees rooted at generate set's minimum LOD.
+     *
+     *  Subtrees are disjoint and are therefore processed in parallel. Any
+     *  access to tile sets (metadata, driver I/O) and to shared merger state
+     *  is serialized by mutex, merging itself runs concurrently. Result is
+     *  the same as of serial processing.
+     */
+    void mergeSubtrees(const char *prefix);
+
     /** Generates new tile as a merge of tiles from other tilesets.
      */
     Tile generateTile(const TileId &tileId
@@ -190,6 +205,10 @@ struct Merger {
     };
 
     AffectedArea::map affectedTiles;
+
+    /** Guards tile set details, affectedTiles and progress.
+     */
+    std::mutex mutex;
 };
 
 } // namespace
@@ -262,15 +281,7 @@ void TileSet::mergeIn(const list &kept, const list &update)
         << "(merge-in) Generate set calculated. "
         << "About to process " << merger.progress.total() << " tiles.";
 
-    auto lod(generate.minLod());
-    auto s(generate.rasterSize(lod));
-    for (long j(0); j < s.height; ++j) {
-        for (long i(0); i < s.width; ++i) {
-            LOG(info2) << "(merge-in) Processing subtree "
-                       << lod << "/(" << i << ", " << j << ").";
-            merger.mergeSubtree({lod, i, j});
-        }
-    }
+    merger.mergeSubtrees("merge-in");
 
     LOG(info3) << "(merge-in) Tile sets merged in.";
 
@@ -349,15 +360,7 @@ void TileSet::mergeOut(const list &kept, const list &update)
     LOG(info3) << "(merge-out) Generate and remove sets calculated. "
                << "About to process " << merger.progress.total() << " tiles.";
 
-    auto lod(generate.minLod());
-    auto s(generate.rasterSize(lod));
-    for (long j(0); j < s.height; ++j) {
-        for (long i(0); i < s.width; ++i) {
-            LOG(info2) << "(merge-out) Processing subtree "
-                       << lod << "/(" << i << ", " << j << ").";
-            merger.mergeSubtree({lod, i, j});
-        }
-    }
+    merger.mergeSubtrees("merge-out");
 
     LOG(info3) << "(merge-in) Tile sets merged out.";
 
@@ -369,6 +372,38 @@ void TileSet::mergeOut(const list &kept, const list &update)
 
 namespace {
 
+void Merger::mergeSubtrees(const char *prefix)
+{
+    const auto lod(generate.minLod());
+    const auto s(generate.rasterSize(lod));
+    const long count(long(s.width) * s.height);
+
+    std::exception_ptr error;
+    std::atomic<bool> failed(false);
+
+    UTILITY_OMP(parallel for schedule(dynamic))
+    for (long k = 0; k < count; ++k) {
+        if (failed) { continue; }
+
+        const long i(k % s.width);
+        const long j(k / s.width);
+        LOG(info2) << "(" << prefix << ") Processing subtree "
+                   << lod << "/(" << i << ", " << j << ").";
+
+        try {
+            mergeSubtree({lod, i, j});
+        } catch (...) {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!failed) {
+                error = std::current_exception();
+                failed = true;
+            }
+        }
+    }
+
+    if (error) { std::rethrow_exception(error); }
+}
+
 Tile Merger::generateTile(const TileId &tileId
                           , const MergeInput::list &parentIncidentTiles
                           , MergeInput::list &incidentTiles
@@ -378,9 +413,12 @@ Tile Merger::generateTile(const TileId &tileId
 
     // Fetch tiles from other source.
     MergeInput::list tiles;
-    for (const auto &ts : src) {
-        if (auto t = self.other(ts).getTile(tileId, std::nothrow)) {
-            tiles.push_back(MergeInput(t.get(), ts.get(), tileId ));
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (const auto &ts : src) {
+            if (auto t = self.other(ts).getTile(tileId, std::nothrow)) {
+                tiles.push_back(MergeInput(t.get(), ts.get(), tileId ));
+            }
         }
     }
 
@@ -389,6 +427,7 @@ Tile Merger::generateTile(const TileId &tileId
         // no parent data
         if (tiles.empty()) {
             // no data -> remove tile and return empty tile
+            std::unique_lock<std::mutex> lock(mutex);
             self.removeTile(tileId);
             return {};
         } else if ((tiles.size() == 1)) {
@@ -396,6 +435,7 @@ Tile Merger::generateTile(const TileId &tileId
             // NB: copy pixelSize
             auto tile(tiles.front().tile());
             //auto tile(tiles2.front());
+            std::unique_lock<std::mutex> lock(mutex);
             tile.metanode
                 = self.setTile(tileId, tile.mesh, tile.atlas, &tile.metanode
                                , tile.metanode.pixelSize[0][0]);
@@ -406,10 +446,11 @@ Tile Merger::generateTile(const TileId &tileId
         // more tiles => must merge
     }
 
-    // we have to merge tiles
+    // we have to merge tiles (outside lock)
     auto tile(merge(tileId, ts, tiles, quadrant
                     , parentIncidentTiles, incidentTiles));
 
+    std::unique_lock<std::mutex> lock(mutex);
     if (tile.singleSource()) {
         affectedTiles[tile.sources.front()]->continuous.set(tileId);
     } else if (tile.multiSource()) {
@@ -447,7 +488,13 @@ void Merger::mergeSubtree(const Index &index
 
         bool thisGenerated(false);
         if (!parentGenerated) {
-            if (auto t = self.getTile(self.parent(tileId), std::nothrow)) {
+            auto t([&]() -> boost::optional<Tile>
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                return self.getTile(self.parent(tileId), std::nothrow);
+            }());
+
+            if (t) {
                 // no parent was generated and we have sucessfully loaded parent
                 // tile from existing content as a fallback tile!
 
@@ -469,11 +516,15 @@ void Merger::mergeSubtree(const Index &index
             tile = generateTile(tileId, parentIncidentTiles
                                 , incidentTiles, quadrant);
         }
+
+        std::unique_lock<std::mutex> lock(mutex);
         (++progress).report(utility::Progress::ratio_t(5, 1000), "(merge) ");
     } else if (r) {
         auto tileId(generate.tileId(index));
         LOG(info2) << "(merge-out) Processing tile "
                    << index << ", " << tileId << ".";
+
+        std::unique_lock<std::mutex> lock(mutex);
         self.removeTile(tileId);
         (++progress).report(utility::Progress::ratio_t(5, 1000), "(merge) ");
     }
@@ -53,7 +53,7 @@ public:
                   , service::DISABLE_EXCESSIVE_LOGGING)
         , size_(256, 256)
         , type_(vts::NodeInfo::CoverageType::pixel)
-        , dilation_(0)
+        , dilation_(0), compare_(false), depth_(0)
     {}
 
 private:
@@ -70,12 +70,21 @@ private:
 
     virtual int run() UTILITY_OVERRIDE;
 
+    /** Compares generated coverage masks of given node and its descendants
+     *  with reference (fully sampled) masks.
+     *
+     * \return number of nodes with different masks
+     */
+    std::size_t compare(const vts::NodeInfo &ni, int depth) const;
+
     std::string referenceFrame_;
     vts::TileId tileId_;
     math::Size2 size_;
     vts::NodeInfo::CoverageType type_;
     int dilation_;
     fs::path output_;
+    bool compare_;
+    int depth_;
 };
 
 void NodeMask::configuration(po::options_description &cmdline
@@ -98,6 +107,11 @@ void NodeMask::configuration(po::options_description &cmdline
          , "Mask dilation in pixels.")
         ("output", po::value(&output_)->required()
          , "Path to output file.")
+        ("compare", "Compare generated coverage mask with reference "
+         "implementation sampling every grid point. Fails if masks differ.")
+        ("depth", po::value(&depth_)->default_value(depth_)->required()
+         , "Compare masks of all descendants down to given number of LODs "
+         "below tileId as well (used only with --compare).")
     ;
 
     pd.add("referenceFrame", 1)
@@ -111,6 +125,12 @@ void NodeMask::configure(const po::variables_map &vars)
 {
     vr::registryConfigure(vars);
 
+    compare_ = vars.count("compare");
+    if (depth_ < 0) {
+        throw po::validation_error
+            (po::validation_error::invalid_option_value, "depth");
+    }
+
     if (output_.filename() == ".") {
         output_ /= str(boost::format("%s.png") % tileId_);
     }
@@ -135,9 +155,45 @@ int NodeMask::run()
          , asCvMat(ni.coverageMask(type_, size_, dilation_))
          , { CV_IMWRITE_JPEG_QUALITY, 100, CV_IMWRITE_PNG_COMPRESSION, 9 });
 
+    if (compare_ && compare(ni, depth_)) { return EXIT_FAILURE; }
+
     return EXIT_SUCCESS;
 }
 
+std::size_t NodeMask::compare(const vts::NodeInfo &ni, int depth) const
+{
+    if (!ni.valid()) { return 0; }
+
+    std::size_t failed(0);
+
+    if (ni.partial()) {
+        const auto mask(ni.coverageMask(type_, size_, dilation_));
+        const auto reference(ni.sampledCoverageMask(type_, size_, dilation_));
+
+        std::size_t differs(0);
+        for (int j(0); j < size_.height; ++j) {
+            for (int i(0); i < size_.width; ++i) {
+                if (mask.get(i, j) != reference.get(i, j)) { ++differs; }
+            }
+        }
+
+        if (differs) {
+            std::cout << ni.nodeId() << ": " << differs
+                      << " pixels differ from reference" << std::endl;
+            ++failed;
+        }
+    }
+
+    if (!depth) { return failed; }
+
+    for (const auto &childId : vts::children(ni.nodeId())) {
+        const auto child(ni.child(childId));
+        failed += compare(child, depth - 1);
+    }
+
+    return failed;
+}
+
 int main(int argc, char *argv[])
 {
     return NodeMask()(argc, argv);
@@ -47,6 +47,8 @@ UTILITY_GENERATE_ENUM(Command,
                       ((append))
                       ((remove))
                       ((extract))
+                      ((reclaim))
+                      ((verify))
                       )
 
 
@@ -98,6 +100,7 @@ public:
                               | service::ENABLE_UNRECOGNIZED_OPTIONS))
         , command_(Command::list)
         , createOptions_{ 5, 1 }
+        , sampling_(1), phase_(0)
     {
     }
 
@@ -158,6 +161,10 @@ private:
 
     int extract();
 
+    int reclaim();
+
+    int verify();
+
     fs::path file_;
     Command command_;
 
@@ -165,6 +172,8 @@ private:
     File::list files_;
     FileIndex::list indices_;
     boost::optional<std::uint32_t> indexOffset_;
+    unsigned int sampling_;
+    unsigned int phase_;
 
     std::map<Command, std::shared_ptr<UP> >
     commandParsers_;
@@ -238,6 +247,30 @@ void Tilar::configuration(po::options_description &cmdline
             ;
         p.positional.add("files", -1);
     });
+
+    createParser(cmdline, Command::reclaim
+                 , "--command=reclaim: releases disk space not used by "
+                 "any file or current index; older indices become unusable"
+                 , [&](UP&)
+    {
+    });
+
+    createParser(cmdline, Command::verify
+                 , "--command=verify: verifies content of stored files "
+                 "against checksums in the index by sequential reading"
+                 , [&](UP &p)
+    {
+        offsetConfiguration(p.options);
+        p.options.add_options()
+            ("sampling", po::value(&sampling_)
+             ->default_value(sampling_)->required()
+             , "Verify only every sampling-th file (in archive order).")
+            ("phase", po::value(&phase_)
+             ->default_value(phase_)->required()
+             , "Index of first verified file when sampling; rotate "
+             "to cover whole archive by multiple runs.")
+            ;
+    });
 }
 
 po::ext_parser Tilar::extraParser()
@@ -330,6 +363,9 @@ void Tilar::optionsConfiguration(po::options_description &options)
         ("uuid", po::value(&createOptions_.uuid)
          ->default_value(createOptions_.uuid)->required()
          , "File's UUID.")
+        ("checksums", po::value(&createOptions_.checksums)
+         ->default_value(false)->implicit_value(true)
+         , "Store checksum of every file in the index.")
         ;
 }
 
@@ -351,6 +387,8 @@ int Tilar::run()
         case Command::append: return append();
         case Command::remove: return remove();
         case Command::extract: return extract();
+        case Command::reclaim: return reclaim();
+        case Command::verify: return verify();
         }
     // } catch (const std::exception &e) {
     //     std::cerr << "tilar: " << e.what() << std::endl;
@@ -397,16 +435,25 @@ int Tilar::list()
               << "\nBinary order: " << options.binaryOrder
               << "\nFiles per tile: " << options.filesPerTile
               << "\nUUID: " << options.uuid
+              << "\nChecksums: " << (options.checksums ? "yes" : "no")
               << "\nOverhead: " << info.overhead << " bytes"
               << "\nModified at: " << utility::formatDateTime(info.modified)
               << "\nIndex offset: " << info.offset
               << "\nPrevious index offset: " << info.previousOffset
+              << "\nFile size: " << info.fileSize << " bytes"
+              << "\nAllocated: " << info.allocated << " bytes"
+              << "\nExtents: " << arch.extents()
               << "\n\n";
 
     for (const auto &entry : arch.list()) {
         std::cout << '[' << entry.index.col << ',' << entry.index.row
                   << ',' << entry.index.type << "]: "
-                  << entry.size << " bytes at " << entry.start << ".\n";
+                  << entry.size << " bytes at " << entry.start;
+        if (options.checksums) {
+            std::cout << ", crc32 0x" << std::hex << entry.checksum
+                      << std::dec;
+        }
+        std::cout << ".\n";
     }
     std::cout.flush();
 
@@ -453,6 +500,51 @@ int Tilar::extract()
     return EXIT_SUCCESS;
 }
 
+int Tilar::reclaim()
+{
+    auto arch(vs::Tilar::open(file_, vs::Tilar::OpenMode::readWrite));
+
+    const auto before(arch.info());
+    const auto beforeExtents(arch.extents());
+    const auto released(arch.reclaim());
+    const auto after(arch.info());
+
+    std::cout << "File: " << file_.string()
+              << "\nReleased: " << released << " bytes"
+              << "\nAllocated: " << before.allocated << " -> "
+              << after.allocated << " bytes"
+              << "\nExtents: " << beforeExtents << " -> " << arch.extents()
+              << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+int Tilar::verify()
+{
+    auto arch(indexOffset_
+              ? vs::Tilar::open(file_, *indexOffset_)
+              : vs::Tilar::open(file_, vs::Tilar::OpenMode::readOnly));
+
+    const auto v(arch.verify(sampling_, phase_));
+
+    std::cout << "File: " << file_.string()
+              << "\nChecksums: " << (v.checksums ? "yes" : "no")
+              << "\nVerified: " << v.verified << " files, "
+              << v.bytes << " bytes"
+              << "\nSkipped: " << v.skipped << " files"
+              << "\nCorrupted: " << v.corrupted.size() << " files"
+              << "\n";
+
+    for (const auto &entry : v.corrupted) {
+        std::cout << '[' << entry.index.col << ',' << entry.index.row
+                  << ',' << entry.index.type << "]: "
+                  << entry.size << " bytes at " << entry.start << ".\n";
+    }
+    std::cout.flush();
+
+    return v.corrupted.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 int main(int argc, char *argv[])
 {
     return Tilar()(argc, argv);
@@ -26,6 +26,9 @@
 #include <unistd.h>
 
 #include <cerrno>
+#include <set>
+#include <map>
+#include <sstream>
 
 #include <boost/format.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -64,6 +67,9 @@
 #include "../vts/2d.hpp"
 #include "../vts/visit.hpp"
 #include "../vts/csconvertor.hpp"
+#include "../vts/coarsen.hpp"
+#include "../vts/tileset/driver.hpp"
+#include "../vts/tileset/driver/contentstore.hpp"
 
 #include "./locker.hpp"
 
@@ -79,9 +85,11 @@ UTILITY_GENERATE_ENUM(Command,
                       ((create))
                       ((add))
                       ((remove))
+                      ((reorder))
                       ((generateGlues)("glue-generate-pending"))
                       ((generateGlue)("glue-generate"))
                       ((listPendingGlues)("list-pending-glues"))
+                      ((dedupStat)("dedup-stat"))
 
                       ((dumpMetatile)("dump-metatile"))
                       ((metatileVersion)("metatile-version"))
@@ -91,6 +99,7 @@ UTILITY_GENERATE_ENUM(Command,
                       ((tileInfo)("tile-info"))
                       ((dumpMesh)("dump-mesh"))
                       ((dumpMeshMask)("dump-mesh-mask"))
+                      ((checkMeshCopy)("check-mesh-copy"))
                       ((tileIndexInfo)("tileindex-info"))
                       ((tileIndexRanges)("tileindex-ranges"))
                       ((convertTileIndex)("convert-tileindex"))
@@ -98,11 +107,18 @@ UTILITY_GENERATE_ENUM(Command,
                       ((aggregate)("aggregate"))
                       ((remote)("remote"))
                       ((local)("local"))
+                      ((bundle)("bundle"))
                       ((clone)("clone"))
+                      ((coarsen)("coarsen"))
                       ((relocate)("relocate"))
                       ((reencode)("reencode"))
                       ((reencodeCleanup)("reencode-cleanup"))
+                      ((recoverIndex)("recover-index"))
                       ((tilePick)("tile-pick"))
+                      ((tileBatch)("tile-batch"))
+                      ((removeTile)("remove-tile"))
+                      ((removeSubtree)("remove-subtree"))
+                      ((replaceSubtree)("replace-subtree"))
                       ((file)("file"))
                       ((tags)("tags"))
                       ((glueRulesSyntax)("glue-rules-syntax"))
@@ -162,7 +178,7 @@ public:
                               | service::ENABLE_UNRECOGNIZED_OPTIONS))
         , noexcept_(false), command_(Command::info)
         , tileFlags_(), metaFlags_(), encodeFlags_()
-        , queryLod_(), textureQuality_(70)
+        , queryLod_(), textureQuality_(70), surfaceReference_(2)
     {
         addOptions_.textureQuality = 0;
         addOptions_.bumpVersion = false;
@@ -221,6 +237,11 @@ private:
 
     void lockConfigure(const po::variables_map &vars);
 
+    void locationConfiguration(po::options_description &config
+                               , const std::string &what);
+
+    void locationConfigure(const po::variables_map &vars);
+
     int runCommand();
 
     int info();
@@ -231,12 +252,16 @@ private:
 
     int remove();
 
+    int reorder();
+
     int generateGlues();
 
     int generateGlue();
 
     int listPendingGlues();
 
+    int dedupStat();
+
     int tags();
 
     int dumpMetatile();
@@ -251,8 +276,13 @@ private:
 
     int tileInfo();
 
+    int removeTile();
+    int removeSubtree();
+    int replaceSubtree();
+
     int dumpMesh();
     int dumpMeshMask();
+    int checkMeshCopy();
 
     int tileIndexInfo();
     int tileIndexRanges();
@@ -267,15 +297,23 @@ private:
 
     int local();
 
+    int bundle();
+
     int clone();
 
+    int coarsen();
+
     int relocate();
 
     int reencode();
     int reencodeCleanup();
 
+    int recoverIndex();
+
     int tilePick();
 
+    int tileBatch();
+
     int file();
 
     int glueRulesSyntax();
@@ -322,6 +360,8 @@ private:
     vts::Storage::AddOptions addOptions_;
     vts::RelocateOptions relocateOptions_;
     vts::ReencodeOptions reencodeOptions_;
+    vts::RecoverIndexOptions recoverIndexOptions_;
+    vts::CoarsenOptions coarsenOptions_;
     Verbosity verbose_;
     bool computeTexelSize_;
     vs::CreditIds forceCredits_;
@@ -332,6 +372,9 @@ private:
     math::Point2IOWrapper<double> queryPoint_;
 
     int textureQuality_;
+    boost::optional<vts::AdaptiveQuality> adaptiveQuality_;
+    int surfaceReference_;
+    boost::optional<vts::SpatialFilter> spatialFilter_;
 
     /** External lock.
      */
@@ -426,6 +469,136 @@ void configureProgress(const po::variables_map &vars
     options.progress = std::make_shared<MergeProgress>(std::move(dup), period);
 }
 
+void adaptiveQualityConfiguration(po::options_description &options)
+{
+    const vts::AdaptiveQuality aq;
+    options.add_options()
+        ("adaptiveQuality.psnr", po::value<double>()
+         , "Encode newly generated textures with the lowest JPEG quality "
+         "that keeps PSNR against source texture at least at given value "
+         "(in dB). Overrides textureQuality for these textures. "
+         "Disabled if not set.")
+        ("adaptiveQuality.min", po::value<int>()
+         ->default_value(aq.minQuality)->required()
+         , "Minimum JPEG quality used by adaptive encoding.")
+        ("adaptiveQuality.max", po::value<int>()
+         ->default_value(aq.maxQuality)->required()
+         , "Maximum JPEG quality used by adaptive encoding.")
+        ("adaptiveQuality.passes", po::value<int>()
+         ->default_value(aq.maxPasses)->required()
+         , "Maximum number of encode passes per texture.")
+        ;
+}
+
+boost::optional<vts::AdaptiveQuality>
+configureAdaptiveQuality(const po::variables_map &vars)
+{
+    if (!vars.count("adaptiveQuality.psnr")) { return boost::none; }
+
+    vts::AdaptiveQuality aq;
+    aq.targetPsnr = vars["adaptiveQuality.psnr"].as<double>();
+    aq.minQuality = vars["adaptiveQuality.min"].as<int>();
+    aq.maxQuality = vars["adaptiveQuality.max"].as<int>();
+    aq.maxPasses = vars["adaptiveQuality.passes"].as<int>();
+
+    if (aq.maxPasses <= 0) {
+        throw po::validation_error
+            (po::validation_error::invalid_option_value
+             , "adaptiveQuality.passes");
+    }
+
+    aq.report = std::make_shared<vts::EncodeReport>();
+    return aq;
+}
+
+void reportAdaptiveQuality(const boost::optional<vts::AdaptiveQuality> &aq)
+{
+    if (!aq || !aq->report) { return; }
+    LOG(info3) << "Adaptive texture encoding: " << *aq->report;
+}
+
+void spatialFilterConfiguration(po::options_description &options)
+{
+    options.add_options()
+        ("filter.srs", po::value<std::string>()
+         , "SRS of spatial filter's extents/polygon. Spatial filtering is "
+         "enabled when set.")
+        ("filter.extents", po::value<math::Extents2>()
+         , "Spatial filter extents in filter.srs. "
+         "In conflict with filter.polygon.")
+        ("filter.polygon", po::value<std::string>()
+         , "Spatial filter polygon in filter.srs given as a "
+         "semicolon-separated list of x,y vertices. "
+         "In conflict with filter.extents.")
+        ("filter.clip", "Clip meshes of tiles on the filter's boundary "
+         "instead of keeping them whole. Available only with "
+         "filter.extents.")
+        ;
+}
+
+boost::optional<vts::SpatialFilter>
+configureSpatialFilter(const po::variables_map &vars)
+{
+    if (!vars.count("filter.srs")) { return boost::none; }
+
+    const bool extents(vars.count("filter.extents"));
+    const bool polygon(vars.count("filter.polygon"));
+    if (extents == polygon) {
+        throw po::validation_error
+            (po::validation_error::invalid_option_value
+             , "filter.extents,filter.polygon");
+    }
+
+    vts::SpatialFilter sf;
+    sf.srs = vars["filter.srs"].as<std::string>();
+    if (vars.count("filter.clip")) {
+        if (polygon) {
+            throw po::validation_error
+                (po::validation_error::invalid_option_value
+                 , "filter.clip");
+        }
+        sf.boundary = vts::SpatialFilter::Boundary::clip;
+    }
+
+    if (extents) {
+        sf.extents = vars["filter.extents"].as<math::Extents2>();
+        return sf;
+    }
+
+    math::Points2 points;
+    std::vector<std::string> parts;
+    for (const auto &part
+             : ba::split(parts, vars["filter.polygon"].as<std::string>()
+                         , ba::is_any_of(";")))
+    {
+        std::vector<std::string> xy;
+        ba::split(xy, part, ba::is_any_of(","));
+        if (xy.size() != 2) {
+            throw po::validation_error
+                (po::validation_error::invalid_option_value
+                 , "filter.polygon");
+        }
+
+        try {
+            points.emplace_back(boost::lexical_cast<double>(xy[0])
+                                , boost::lexical_cast<double>(xy[1]));
+        } catch (const boost::bad_lexical_cast&) {
+            throw po::validation_error
+                (po::validation_error::invalid_option_value
+                 , "filter.polygon");
+        }
+    }
+
+    if (points.size() < 3) {
+        throw po::validation_error
+            (po::validation_error::invalid_option_value
+             , "filter.polygon");
+    }
+
+    sf.setPolygon(points);
+    return sf;
+}
+
 void configureGeneratesetModifier(const po::variables_map &vars
                        , vts::GlueCreationOptions &options)
 {
@@ -477,6 +650,56 @@ void VtsStorage::lockConfigure(const po::variables_map &vars)
     }
 }
 
+void VtsStorage::locationConfiguration(po::options_description &config
+                                       , const std::string &what)
+{
+    config.add_options()
+        ("above", po::value<std::string>()
+         , ("Place " + what + " right above given one."
+            " Conflicts with --below, --top and --bottom.").c_str())
+        ("below", po::value<std::string>()
+         , ("Place " + what + " right below given one."
+            " Conflicts with --above, --top and --bottom.").c_str())
+        ("top", ("Place " + what + " at the top of the stack."
+                 " Conflicts with --above, --below and --bottom.").c_str())
+        ("bottom", ("Place " + what + " at the bottom of the stack."
+                    " Conflicts with --above, --below and --top.").c_str())
+        ;
+}
+
+void VtsStorage::locationConfigure(const po::variables_map &vars)
+{
+    bool above(vars.count("above"));
+    bool below(vars.count("below"));
+    bool top(vars.count("top"));
+    bool bottom(vars.count("bottom"));
+    int sum(above + below + top + bottom);
+    if (!sum) {
+        throw po::validation_error
+            (po::validation_error::at_least_one_value_required
+             , "above,below,top,bottom");
+    }
+    if (sum > 1) {
+        throw po::validation_error
+            (po::validation_error::multiple_values_not_allowed
+             , "above,below,top,bottom");
+    }
+
+    if (above) {
+        where_.where = vars["above"].as<std::string>();
+        where_.direction = vts::Storage::Location::Direction::above;
+    } else if (below) {
+        where_.where = vars["below"].as<std::string>();
+        where_.direction = vts::Storage::Location::Direction::below;
+    } else if (top) {
+        where_.where.clear();
+        where_.direction = vts::Storage::Location::Direction::below;
+    } else if (bottom) {
+        where_.where.clear();
+        where_.direction = vts::Storage::Location::Direction::above;
+    }
+}
+
 void VtsStorage::configuration(po::options_description &cmdline
                                , po::options_description&
                                , po::positional_options_description &pd)
@@ -538,17 +761,6 @@ void VtsStorage::configuration(po::options_description &cmdline
              , "TilesetId to use in storage, defaults to id "
              "stored in tileset.")
 
-            ("above", po::value<std::string>()
-             , "Place new tileset right above given one."
-             " Conflicts with --below, --top and --bottom.")
-            ("below", po::value<std::string>()
-             , "Place new tileset right below given one."
-             " Conflicts with --above, --top and --bottom.")
-            ("top", "Place new tileset at the top of the stack."
-             " Conflicts with --above, --below and --bottom.")
-            ("bottom", "Place new tileset at the bottom of the stack."
-             " Conflicts with --above, --below and --top.")
-
             ("lodRange", po::value<vts::LodRange>()
              , "Limits used LOD range from source tileset.")
             ("textureQuality", po::value(&addOptions_.textureQuality)
@@ -564,6 +776,19 @@ void VtsStorage::configuration(po::options_description &cmdline
             ("tmp", po::value<fs::path>()
              , "Temporary directory where to work with temporary data.")
             ("no-clip", "Don't clip meshes by merge coverage.")
+            ("link", "Adopt tileset's files into storage instead of "
+             "cloning it: immutable files are hardlinked, archives are "
+             "reflinked or copied. Falls back to cloning when not possible. "
+             "In conflict with --move.")
+            ("move", "Hardlink all tileset's files into storage and remove "
+             "source tileset after being added. In conflict with --link.")
+            ("glueMemoryBudget", po::value<std::size_t>()
+             , "Generate glues in memory using up to given number of MB "
+             "before spilling to disk. Empty glues never touch the disk. "
+             "Glues are generated directly on disk if not set.")
+            ("dedup", "Store tile files in storage's content-addressed "
+             "store (storage-path/content) so identical files are kept "
+             "only once across all tilesets and glues.")
             ("addTag", po::value<std::vector<std::string>>()
              , "Set of tags (string identifiers) assigned to tileset. "
              "Glue rules (stored in user-editable file "
@@ -571,7 +796,10 @@ void VtsStorage::configuration(po::options_description &cmdline
              "result in incompatible combination of tags are not generated.")
             ;
 
+        locationConfiguration(p.options, "new tileset");
         progressConfiguration(p.options);
+        adaptiveQualityConfiguration(p.options);
+        spatialFilterConfiguration(p.options);
 
         p.positional.add("tileset", 1);
 
@@ -585,40 +813,13 @@ void VtsStorage::configuration(po::options_description &cmdline
                 addOptions_.filter.lodRange
                 (vars["lodRange"].as<vts::LodRange>());
             }
+            addOptions_.filter.spatialFilter(configureSpatialFilter(vars));
             if (vars.count("tmp")) {
                 addOptions_.tmp = vars["tmp"].as<fs::path>();
             }
 
             // handle where options
-            bool above(vars.count("above"));
-            bool below(vars.count("below"));
-            bool top(vars.count("top"));
-            bool bottom(vars.count("bottom"));
-            int sum(above + below + top + bottom);
-            if (!sum) {
-                throw po::validation_error
-                    (po::validation_error::at_least_one_value_required
-                     , "above,below,top,bottom");
-            }
-            if (sum > 1) {
-                throw po::validation_error
-                    (po::validation_error::multiple_values_not_allowed
-                     , "above,below,top,bottom");
-            }
-
-            if (above) {
-                where_.where = vars["above"].as<std::string>();
-                where_.direction = vts::Storage::Location::Direction::above;
-            } else if (below) {
-                where_.where = vars["below"].as<std::string>();
-                where_.direction = vts::Storage::Location::Direction::below;
-            } else if (top) {
-                where_.where.clear();
-                where_.direction = vts::Storage::Location::Direction::below;
-            } else if (bottom) {
-                where_.where.clear();
-                where_.direction = vts::Storage::Location::Direction::above;
-            }
+            locationConfigure(vars);
 
             addOptions_.bumpVersion = vars.count("bumpVersion");
             addOptions_.dryRun = vars.count("dryRun");
@@ -639,9 +840,32 @@ void VtsStorage::configuration(po::options_description &cmdline
                 addOptions_.mode = vts::Storage::AddOptions::Mode::full;
             }
 
+            // handle adopt mode
+            bool link(vars.count("link"));
+            bool move(vars.count("move"));
+            if (link && move) {
+                throw po::validation_error
+                    (po::validation_error::multiple_values_not_allowed
+                     , "link,move");
+            }
+
+            if (link) {
+                addOptions_.adopt = vts::Storage::AddOptions::Adopt::link;
+            } else if (move) {
+                addOptions_.adopt = vts::Storage::AddOptions::Adopt::move;
+            }
+
             getTags(addOptions_.tags, vars, "addTag");
 
+            if (vars.count("glueMemoryBudget")) {
+                addOptions_.glueMemoryBudget
+                    = (vars["glueMemoryBudget"].as<std::size_t>() << 20);
+            }
+
+            addOptions_.dedup = vars.count("dedup");
+
             configureProgress(vars, addOptions_);
+            addOptions_.adaptiveQuality = configureAdaptiveQuality(vars);
         };
     });
 
@@ -663,6 +887,31 @@ void VtsStorage::configuration(po::options_description &cmdline
         };
     });
 
+    createParser(cmdline, Command::reorder
+                 , "--command=reorder: moves tilesets to new location in "
+                 "VTS storage stack; glues that are no longer valid become "
+                 "pending"
+                 , [&](UP &p)
+    {
+        lockConfiguration(p.options);
+
+        p.options.add_options()
+            ("tileset", po::value(&tilesetIds_)->required()
+             , "Id of tileset to move (can be used more than once). "
+             "Tilesets are placed as a block in given order, "
+             "from bottom to top.")
+            ;
+
+        locationConfiguration(p.options, "moved tilesets");
+
+        p.positional.add("tileset", -1);
+
+        p.configure = [&](const po::variables_map &vars) {
+            lockConfigure(vars);
+            locationConfigure(vars);
+        };
+    });
+
     createParser(cmdline, Command::generateGlues
                  , "--command=glue-generate-pending: generates all "
                  "pending glues for given tileset"
@@ -684,6 +933,7 @@ void VtsStorage::configuration(po::options_description &cmdline
             ;
 
         progressConfiguration(p.options);
+        adaptiveQualityConfiguration(p.options);
 
         p.positional.add("tileset", 1);
 
@@ -696,6 +946,7 @@ void VtsStorage::configuration(po::options_description &cmdline
             addOptions_.clip = !vars.count("no-clip");
 
             configureProgress(vars, addOptions_);
+            addOptions_.adaptiveQuality = configureAdaptiveQuality(vars);
         };
     });
 
@@ -724,6 +975,7 @@ void VtsStorage::configuration(po::options_description &cmdline
             ;
 
         progressConfiguration(p.options);
+        adaptiveQualityConfiguration(p.options);
 
         p.positional.add("tileset", -1);
 
@@ -737,6 +989,7 @@ void VtsStorage::configuration(po::options_description &cmdline
             addOptions_.overwrite = vars.count("overwrite");
 
             configureProgress(vars, addOptions_);
+            addOptions_.adaptiveQuality = configureAdaptiveQuality(vars);
             configureGeneratesetModifier(vars, addOptions_);
         };
     });
@@ -818,6 +1071,44 @@ void VtsStorage::configuration(po::options_description &cmdline
         p.positional.add("tileId", 1);
     });
 
+    createParser(cmdline, Command::removeTile
+                 , "--command=remove-tile: removes tiles' content in place; "
+                 "tile data are left in the archives"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("tileId", po::value(&tileIds_)->required()
+             , "ID's of tiles to remove.")
+            ;
+        p.positional.add("tileId", -1);
+    });
+
+    createParser(cmdline, Command::removeSubtree
+                 , "--command=remove-subtree: removes whole subtrees in "
+                 "place; tile data are left in the archives"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("tileId", po::value(&tileIds_)->required()
+             , "ID's of subtree roots to remove.")
+            ;
+        p.positional.add("tileId", -1);
+    });
+
+    createParser(cmdline, Command::replaceSubtree
+                 , "--command=replace-subtree: replaces whole subtrees in "
+                 "place with the content of another tileset"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("tileset", po::value(&tileset_)->required()
+             , "Path to source tileset.")
+            ("tileId", po::value(&tileIds_)->required()
+             , "ID's of subtree roots to replace.")
+            ;
+        p.positional.add("tileId", -1);
+    });
+
     createParser(cmdline, Command::dumpMesh
                  , "--command=dump-mesh: mesh content"
                  , [&](UP &p)
@@ -843,6 +1134,38 @@ void VtsStorage::configuration(po::options_description &cmdline
         p.positional.add("output", 1);
     });
 
+    createParser(cmdline, Command::checkMeshCopy
+                 , "--command=check-mesh-copy: check that byte-level mesh "
+                 "copy (used by pass-through glue tiles) produces the same "
+                 "bytes as decoding and re-encoding the mesh"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("tileId", po::value(&tileIds_)
+             , "ID of tile to check (can be specified multiple times).")
+            ("lod", po::value<vts::Lod>()
+             , "Check all tiles at given LOD (used when no tileId is given).")
+            ("surfaceReference"
+             , po::value(&surfaceReference_)->default_value(surfaceReference_)
+             ->required()
+             , "Surface reference written to all submeshes.")
+            ;
+
+        p.configure = [&](const po::variables_map &vars) {
+            if (vars.count("lod")) {
+                queryLod_ = vars["lod"].as<vts::Lod>();
+            } else if (tileIds_.empty()) {
+                throw po::required_option("tileId");
+            }
+
+            if ((surfaceReference_ < 1) || (surfaceReference_ > 255)) {
+                throw po::validation_error
+                    (po::validation_error::invalid_option_value
+                     , "surfaceReference");
+            }
+        };
+    });
+
     createParser(cmdline, Command::tileIndexInfo
                  , "--command=tileindex-info: tile-index query"
                  , [&](UP &p)
@@ -890,6 +1213,7 @@ void VtsStorage::configuration(po::options_description &cmdline
             ("lodRange", po::value<vts::LodRange>()
              , "Limits used LOD range from source tileset.")
             ;
+        spatialFilterConfiguration(p.options);
         p.positional.add("tileset", -1);
 
         p.configure = [&](const po::variables_map &vars) {
@@ -900,6 +1224,7 @@ void VtsStorage::configuration(po::options_description &cmdline
             if (vars.count("lodRange")) {
                 optLodRange_ = vars["lodRange"].as<vts::LodRange>();
             }
+            spatialFilter_ = configureSpatialFilter(vars);
         };
     });
 
@@ -984,6 +1309,30 @@ void VtsStorage::configuration(po::options_description &cmdline
         };
     });
 
+    createParser(cmdline, Command::bundle
+                 , "--command=bundle: create read-only single-file bundle "
+                 "from existing tileset"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("source", po::value(&localPath_)->required()
+             , "Source tileset path.")
+            ("overwrite", "Overwrite existing output tileset.")
+            ("tilesetId", po::value<std::string>()
+             , "TilesetId of created tileset, defaults to ID of source set.")
+            ;
+
+        p.configure = [&](const po::variables_map &vars) {
+            if (vars.count("tilesetId")) {
+                optTilesetId_ = vars["tilesetId"].as<std::string>();
+            }
+
+            createMode_ = (vars.count("overwrite")
+                           ? vts::CreateMode::overwrite
+                           : vts::CreateMode::failIfExists);
+        };
+    });
+
     createParser(cmdline, Command::clone
                  , "--command=clone: clone existing tileset"
                  , [&](UP &p)
@@ -1001,13 +1350,20 @@ void VtsStorage::configuration(po::options_description &cmdline
              , "Comma-separated list of string/numeric credit id to override "
              "existing credits. If not specified, credits are not touched.")
             ("encode", po::value(&encodeFlags_)->default_value(0)
-             ,"Comma-separated list of clone options: mesh, inpaint, meta.")
+             ,"Comma-separated list of clone options: mesh, inpaint, meta, "
+             "repack.")
             ("textureQuality", po::value(&textureQuality_)
              ->required()->default_value(textureQuality_)
-             , "Texture quality for inpaint.")
+             , "Texture quality for inpaint and repack.")
             ;
 
+        adaptiveQualityConfiguration(p.options);
+        spatialFilterConfiguration(p.options);
+
         p.configure = [&](const po::variables_map &vars) {
+            adaptiveQuality_ = configureAdaptiveQuality(vars);
+            spatialFilter_ = configureSpatialFilter(vars);
+
             if (vars.count("tilesetId")) {
                 optTilesetId_ = vars["tilesetId"].as<std::string>();
             }
@@ -1051,6 +1407,50 @@ void VtsStorage::configuration(po::options_description &cmdline
         p.positional.add("tileset", 1);
     });
 
+    createParser(cmdline, Command::coarsen
+                 , "--command=coarsen: clone existing tileset and generate "
+                 "missing coarse LODs from existing data"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("tileset", po::value(&tileset_)->required()
+             , "Path to output tileset.")
+            ("overwrite", "Overwrite existing output tileset.")
+            ("tilesetId", po::value<std::string>()
+             , "TilesetId of output tileset. Defaults to filename of "
+             "tileset path ")
+            ("topLod", po::value(&coarsenOptions_.topLod)
+             ->required()->default_value(coarsenOptions_.topLod)
+             , "Topmost LOD to generate.")
+            ("faceBudget", po::value(&coarsenOptions_.faceBudget)
+             ->required()->default_value(coarsenOptions_.faceBudget)
+             , "Maximum number of faces in generated tile.")
+            ("textureQuality", po::value(&coarsenOptions_.textureQuality)
+             ->required()->default_value(coarsenOptions_.textureQuality)
+             , "Quality of repacked atlases.")
+            ;
+
+        p.configure = [&](const po::variables_map &vars) {
+            if (vars.count("tilesetId")) {
+                optTilesetId_ = vars["tilesetId"].as<std::string>();
+            }
+
+            createMode_ = (vars.count("overwrite")
+                           ? vts::CreateMode::overwrite
+                           : vts::CreateMode::failIfExists);
+
+            if ((coarsenOptions_.textureQuality <= 0)
+                || (coarsenOptions_.textureQuality > 100))
+            {
+                throw po::validation_error
+                    (po::validation_error::invalid_option_value
+                     , "textureQuality");
+            }
+        };
+
+        p.positional.add("tileset", 1);
+    });
+
     createParser(cmdline, Command::relocate
                  , "--command=relocate: update paths to external resources "
                  "in a dataset"
@@ -1082,11 +1482,18 @@ void VtsStorage::configuration(po::options_description &cmdline
             ("tag", po::value(&reencodeOptions_.tag)->required()
              , "Reencode tag.")
             ("encode", po::value(&encodeFlags_)->default_value(0)
-             ,"Comma-separated list of clone options: mesh, inpaint, meta.")
+             ,"Comma-separated list of clone options: mesh, inpaint, meta, "
+             "repack.")
+            ("textureQuality", po::value(&reencodeOptions_.textureQuality)
+             ->default_value(reencodeOptions_.textureQuality)->required()
+             , "Quality of inpainted and repacked textures, 0-100.")
             ;
 
+        adaptiveQualityConfiguration(p.options);
+
         p.configure = [&](const po::variables_map &vars) {
             reencodeOptions_.dryRun = vars.count("dryRun");
+            reencodeOptions_.adaptiveQuality = configureAdaptiveQuality(vars);
         };
     });
 
@@ -1105,6 +1512,23 @@ void VtsStorage::configuration(po::options_description &cmdline
         };
     });
 
+    createParser(cmdline, Command::recoverIndex
+                 , "--command=recover-index: rebuild lost or damaged tile "
+                 "index of plain tileset from its archives"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("dryRun", "Do not save recovered tile index.")
+            ("meshFlags", "Read mesh headers to recover watertight and "
+             "multimesh flags.")
+            ;
+
+        p.configure = [&](const po::variables_map &vars) {
+            recoverIndexOptions_.dryRun = vars.count("dryRun");
+            recoverIndexOptions_.meshFlags = vars.count("meshFlags");
+        };
+    });
+
     createParser(cmdline, Command::tilePick
                  , "--command=tile-pick: create new tiles by picking "
                  "enumerated tiles from source"
@@ -1125,6 +1549,30 @@ void VtsStorage::configuration(po::options_description &cmdline
         };
     });
 
+    createParser(cmdline, Command::tileBatch
+                 , "--command=tile-batch: fetch tile files (mesh, atlas, "
+                 "navtile) in one batched call and compare it with one call "
+                 "per file"
+                 , [&](UP &p)
+    {
+        p.options.add_options()
+            ("tileId", po::value(&tileIds_)
+             , "ID of tile to fetch (can be specified multiple times).")
+            ("lod", po::value<vts::Lod>()
+             , "Fetch all tiles at given LOD (used when no tileId is given).")
+            ("output", po::value(&outputPath_)
+             , "Optional path where to write fetched bundle.")
+            ;
+
+        p.configure = [&](const po::variables_map &vars) {
+            if (vars.count("lod")) {
+                queryLod_ = vars["lod"].as<vts::Lod>();
+            } else if (tileIds_.empty()) {
+                throw po::required_option("tileId");
+            }
+        };
+    });
+
     createParser(cmdline, Command::tags
                  , "--command=tags: operate on tileset's tags inside storage"
                  , [&](UP &p)
@@ -1314,6 +1762,13 @@ void VtsStorage::configuration(po::options_description &cmdline
                  , [&](UP&)
     {});
 
+    createParser(cmdline, Command::dedupStat
+                 , "--command=dedup-stat: "
+                 "report how much space content deduplication would save "
+                 "(or saves) in given storage."
+                 , [&](UP&)
+    {});
+
     createParser(cmdline, Command::locker2Stresser
                  , "--command=locker2Stresser: "
                  "stress locker implementation"
@@ -1410,9 +1865,11 @@ int VtsStorage::runCommand()
     case Command::create: return create();
     case Command::add: return add();
     case Command::remove: return remove();
+    case Command::reorder: return reorder();
     case Command::generateGlues: return generateGlues();
     case Command::generateGlue: return generateGlue();
     case Command::listPendingGlues: return listPendingGlues();
+    case Command::dedupStat: return dedupStat();
     case Command::tags: return tags();
 
     case Command::virtualSurfaceCreate: return virtualSurfaceCreate();
@@ -1424,8 +1881,12 @@ int VtsStorage::runCommand()
     case Command::dirs: return dirs();
     case Command::dumpTileIndex: return dumpTileIndex();
     case Command::tileInfo: return tileInfo();
+    case Command::removeTile: return removeTile();
+    case Command::removeSubtree: return removeSubtree();
+    case Command::replaceSubtree: return replaceSubtree();
     case Command::dumpMesh: return dumpMesh();
     case Command::dumpMeshMask: return dumpMeshMask();
+    case Command::checkMeshCopy: return checkMeshCopy();
     case Command::tileIndexInfo: return tileIndexInfo();
     case Command::tileIndexRanges: return tileIndexRanges();
     case Command::convertTileIndex: return convertTileIndex();
@@ -1433,11 +1894,15 @@ int VtsStorage::runCommand()
     case Command::aggregate: return aggregate();
     case Command::remote: return remote();
     case Command::local: return local();
+    case Command::bundle: return bundle();
     case Command::clone: return clone();
+    case Command::coarsen: return coarsen();
     case Command::tilePick: return tilePick();
+    case Command::tileBatch: return tileBatch();
     case Command::relocate: return relocate();
     case Command::reencode: return reencode();
     case Command::reencodeCleanup: return reencodeCleanup();
+    case Command::recoverIndex: return recoverIndex();
     case Command::file: return file();
     case Command::glueRulesSyntax: return glueRulesSyntax();
     case Command::mergeConfSyntax: return mergeConfSyntax();
@@ -1709,6 +2174,8 @@ int VtsStorage::add()
                 , optTilesetId_ ? *optTilesetId_ : std::string()
                 , addOptions_);
 
+    reportAdaptiveQuality(addOptions_.adaptiveQuality);
+
     LOG(info4) << "All done.";
     return EXIT_SUCCESS;
 }
@@ -1723,6 +2190,16 @@ int VtsStorage::remove()
     return EXIT_SUCCESS;
 }
 
+int VtsStorage::reorder()
+{
+    // lock if external locking program is available
+    Lock lock(path_, lock_);
+    auto storage(vts::Storage(path_, vts::OpenMode::readWrite, lock));
+
+    storage.reorder(tilesetIds_, where_);
+    return EXIT_SUCCESS;
+}
+
 int VtsStorage::generateGlues()
 {
     // lock if external locking program is available
@@ -1732,6 +2209,7 @@ int VtsStorage::generateGlues()
     auto ao(addOptions_);
     ao.mode = vts::Storage::AddOptions::Mode::full;
     storage.generateGlues(tilesetId_, ao);
+    reportAdaptiveQuality(ao.adaptiveQuality);
     return EXIT_SUCCESS;
 }
 
@@ -1744,6 +2222,7 @@ int VtsStorage::generateGlue()
     auto ao(addOptions_);
     ao.mode = vts::Storage::AddOptions::Mode::full;
     storage.generateGlue(tilesetIds_, ao);
+    reportAdaptiveQuality(ao.adaptiveQuality);
     return EXIT_SUCCESS;
 }
 
@@ -2133,6 +2612,124 @@ int VtsStorage::dumpMeshMask()
     return EXIT_SUCCESS;
 }
 
+int VtsStorage::checkMeshCopy()
+{
+    auto ts(vts::openTileSet(path_));
+    const auto &ti(ts.tileIndex());
+
+    std::vector<vts::TileId> tileIds;
+    auto addTile([&](const vts::TileId &tileId
+                     , vts::TileIndex::Flag::value_type flags)
+    {
+        if (flags & vts::TileIndex::Flag::mesh) { tileIds.push_back(tileId); }
+    });
+
+    if (tileIds_.empty()) {
+        traverse(ti, *queryLod_, addTile);
+    } else {
+        for (const auto &tileId : tileIds_) {
+            addTile(tileId, ti.get(tileId));
+        }
+    }
+
+    const vts::SubMesh::SurfaceReference surfaceReference(surfaceReference_);
+
+    std::size_t same(0), different(0), unsupported(0);
+    for (const auto &tileId : tileIds) {
+        // byte-level copy
+        std::ostringstream copied;
+        {
+            auto raw(ts.getTileSource(tileId));
+            if (!vts::copyMesh(*raw.mesh, copied, surfaceReference
+                               , raw.mesh->name()))
+            {
+                std::cout << tileId << ": unsupported mesh format" << '
+';
+                ++unsupported;
+                continue;
+            }
+        }
+
+        // decode, update surface references and encode again
+        std::ostringstream reencoded;
+        {
+            auto mesh(ts.getMesh(tileId));
+            for (auto &sm : mesh) { sm.surfaceReference = surfaceReference; }
+
+            vts::RawAtlas atlas;
+            const bool hasAtlas(ti.get(tileId) & vts::TileIndex::Flag::atlas);
+            if (hasAtlas) { ts.getAtlas(tileId, atlas); }
+            vts::saveMesh(reencoded, mesh, (hasAtlas ? &atlas : nullptr));
+        }
+
+        const auto c(copied.str());
+        const auto r(reencoded.str());
+        if (c == r) {
+            ++same;
+            continue;
+        }
+
+        std::size_t offset(0);
+        while ((offset < c.size()) && (offset < r.size())
+               && (c[offset] == r[offset]))
+        {
+            ++offset;
+        }
+
+        std::cout << tileId << ": differs at byte " << offset
+                  << " (copy: " << c.size() << " bytes, re-encoded: "
+                  << r.size() << " bytes)" << '\n';
+        ++different;
+    }
+
+    std::cout << "Checked " << tileIds.size() << " meshes: " << same
+              << " identical, " << different << " different, "
+              << unsupported << " unsupported." << '\n';
+
+    return different ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+namespace {
+
+vts::TileSet openForUpdate(const fs::path &path)
+{
+    return vts::openTileSet
+        (path, vts::OpenOptions().openMode(vts::OpenMode::readWrite));
+}
+
+} // namespace
+
+int VtsStorage::removeTile()
+{
+    auto ts(openForUpdate(path_));
+    for (const auto &tileId : tileIds_) {
+        ts.removeTile(tileId);
+    }
+    ts.flush();
+    return EXIT_SUCCESS;
+}
+
+int VtsStorage::removeSubtree()
+{
+    auto ts(openForUpdate(path_));
+    for (const auto &tileId : tileIds_) {
+        ts.removeSubtree(tileId);
+    }
+    ts.flush();
+    return EXIT_SUCCESS;
+}
+
+int VtsStorage::replaceSubtree()
+{
+    const auto src(vts::openTileSet(tileset_));
+    auto ts(openForUpdate(path_));
+    for (const auto &tileId : tileIds_) {
+        ts.replaceSubtree(tileId, src);
+    }
+    ts.flush();
+    return EXIT_SUCCESS;
+}
+
 int VtsStorage::tileIndexInfo()
 {
     vts::TileIndex ti;
@@ -2239,6 +2836,7 @@ int VtsStorage::concat()
     createOptions.tilesetId(optTilesetId_);
     createOptions.lodRange(optLodRange_);
     createOptions.mode(createMode_);
+    createOptions.spatialFilter(spatialFilter_);
 
     vts::concatTileSets(path_, tilesets_, createOptions);
 
@@ -2320,6 +2918,16 @@ int VtsStorage::local()
     return EXIT_SUCCESS;
 }
 
+int VtsStorage::bundle()
+{
+    vts::CloneOptions createOptions;
+    createOptions.tilesetId(optTilesetId_);
+    createOptions.mode(createMode_);
+
+    vts::createBundleTileSet(path_, localPath_, createOptions);
+    return EXIT_SUCCESS;
+}
+
 int VtsStorage::clone()
 {
     vts::CloneOptions cloneOptions;
@@ -2329,6 +2937,8 @@ int VtsStorage::clone()
         .mode(createMode_)
         .encodeFlags(encodeFlags_.value)
         .textureQuality(textureQuality_)
+        .adaptiveQuality(adaptiveQuality_)
+        .spatialFilter(spatialFilter_)
         ;
 
     if (!forceCredits_.empty()) {
@@ -2367,6 +2977,18 @@ int VtsStorage::clone()
     return EXIT_FAILURE;
 }
 
+int VtsStorage::coarsen()
+{
+    vts::coarsenTileSet(tileset_, vts::openTileSet(path_)
+                        , vts::CloneOptions()
+                        .tilesetId(optTilesetId_)
+                        .mode(createMode_)
+                        , coarsenOptions_);
+
+    LOG(info4) << "All done.";
+    return EXIT_SUCCESS;
+}
+
 int VtsStorage::tilePick()
 {
     auto its(vts::openTileSet(path_));
@@ -2383,6 +3005,84 @@ int VtsStorage::tilePick()
     return EXIT_SUCCESS;
 }
 
+int VtsStorage::tileBatch()
+{
+    auto ts(vts::openTileSet(path_));
+    const auto &ti(ts.tileIndex());
+
+    vts::TileFileRequest::list files;
+    auto addFiles([&](const vts::TileId &tileId
+                      , vts::TileIndex::Flag::value_type flags)
+    {
+        if (flags & vts::TileIndex::Flag::mesh) {
+            files.emplace_back(tileId, vs::TileFile::mesh);
+        }
+        if (flags & vts::TileIndex::Flag::atlas) {
+            files.emplace_back(tileId, vs::TileFile::atlas);
+        }
+        if (flags & vts::TileIndex::Flag::navtile) {
+            files.emplace_back(tileId, vs::TileFile::navtile);
+        }
+    });
+
+    if (tileIds_.empty()) {
+        traverse(ti, *queryLod_, addFiles);
+    } else {
+        for (const auto &tileId : tileIds_) {
+            addFiles(tileId, ti.get(tileId));
+        }
+    }
+
+    auto delivery(vts::Delivery::open(path_));
+
+    std::size_t total(0);
+    auto consume([&](const vs::IStream::pointer &is)
+    {
+        if (!is) { return; }
+        std::ostringstream os;
+        vs::copyFile(is, os);
+        total += os.tellp();
+    });
+
+    // one call per file
+    const auto singleStart(utility::usecFromEpoch());
+    for (const auto &file : files) {
+        consume(delivery->input(file.tileId, file.type, file.flavor
+                                , vs::NullWhenNotFound));
+    }
+    const auto single(utility::usecFromEpoch() - singleStart);
+    const auto singleTotal(total);
+
+    // batched call
+    total = 0;
+    const auto batchStart(utility::usecFromEpoch());
+    for (const auto &is : delivery->input(files, vs::NullWhenNotFound)) {
+        consume(is);
+    }
+    const auto batch(utility::usecFromEpoch() - batchStart);
+
+    std::cout << "files: " << files.size() << '\n'
+              << "bytes: " << singleTotal << '\n'
+              << "single: " << single << " us\n"
+              << "batch: " << batch << " us\n";
+
+    if (total != singleTotal) {
+        std::cerr << "Batched read returned " << total
+                  << " bytes, expected " << singleTotal << "." << '\n';
+        return EXIT_FAILURE;
+    }
+
+    if (!outputPath_.empty()) {
+        auto bundle(delivery->bundle(files));
+        utility::ofstreambuf out(outputPath_.string());
+        out << bundle->get().rdbuf();
+        bundle->close();
+        out.close();
+    }
+
+    return EXIT_SUCCESS;
+}
+
 int VtsStorage::relocate()
 {
     switch (vts::datasetType(path_)) {
@@ -2455,6 +3155,27 @@ int VtsStorage::reencodeCleanup()
     return EXIT_FAILURE;
 }
 
+int VtsStorage::recoverIndex()
+{
+    if (vts::datasetType(path_) != vts::DatasetType::TileSet) {
+        std::cerr << "Unrecognized content " << path_ << "." << '\n';
+        return EXIT_FAILURE;
+    }
+
+    const auto index(vts::recoverTileSetIndex(path_, recoverIndexOptions_));
+
+    typedef vts::TileIndex::Flag TiFlag;
+    std::cout << "lodRange: " << index.lodRange() << '\n'
+              << "mesh: " << index.statMask(TiFlag::mesh).count << '\n'
+              << "atlas: " << index.statMask(TiFlag::atlas).count << '\n'
+              << "navtile: " << index.statMask(TiFlag::navtile).count
+              << '\n';
+    if (recoverIndexOptions_.dryRun) {
+        std::cout << "Dry run, tile index not saved." << '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
 int serveFile(const vts::Delivery::pointer &delivery
               , const std::string &filename)
 {
@@ -2854,6 +3575,86 @@ int VtsStorage::listPendingGlues()
     return EXIT_FAILURE;
 }
 
+int VtsStorage::dedupStat()
+{
+    if (vts::datasetType(path_) != vts::DatasetType::Storage) {
+        std::cerr << "Only storage is supported\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto storage(vts::openStorage(path_));
+
+    std::vector<fs::path> paths;
+    for (const auto &tileset : storage.storedTilesets()) {
+        paths.push_back(storage.path(tileset.tilesetId));
+    }
+    for (const auto &item : storage.glues()) {
+        paths.push_back(storage.path(item.second));
+    }
+
+    std::size_t files(0);
+    std::size_t total(0);
+    std::map<std::string, std::size_t> unique;
+
+    const auto account([&](const vts::IStream::pointer &is)
+    {
+        if (!is) { return; }
+        std::ostringstream os;
+        os << is->get().rdbuf();
+        const auto data(os.str());
+
+        ++files;
+        total += data.size();
+        unique[vts::driver::ContentStore::hash(data)] = data.size();
+    });
+
+    for (const auto &path : paths) {
+        const auto ts(vts::openTileSet(path));
+        const auto &driver(ts.driver());
+
+        std::set<vts::TileId> metaIds;
+        typedef vts::TileIndex::Flag Flag;
+        vts::traverse(ts.tileIndex(), [&](const vts::TileId &tileId
+                                          , Flag::value_type flags)
+        {
+            if (flags & Flag::mesh) {
+                account(driver.input(tileId, vts::TileFile::mesh
+                                     , vs::NullWhenNotFound));
+            }
+            if (flags & Flag::atlas) {
+                account(driver.input(tileId, vts::TileFile::atlas
+                                     , vs::NullWhenNotFound));
+            }
+            if (flags & Flag::navtile) {
+                account(driver.input(tileId, vts::TileFile::navtile
+                                     , vs::NullWhenNotFound));
+            }
+            metaIds.insert(ts.metaId(tileId));
+        });
+
+        for (const auto &metaId : metaIds) {
+            account(driver.input(metaId, vts::TileFile::meta
+                                 , vs::NullWhenNotFound));
+        }
+    }
+
+    std::size_t stored(0);
+    for (const auto &item : unique) { stored += item.second; }
+
+    std::cout << "tilesets+glues: " << paths.size() << '\n'
+              << "files: " << files << '\n'
+              << "unique files: " << unique.size() << '\n'
+              << "total bytes: " << total << '\n'
+              << "unique bytes: " << stored << '\n'
+              << "savings: " << (total - stored) << " bytes";
+    if (total) {
+        std::cout << " (" << (100.0 * (total - stored) / total) << " %)";
+    }
+    std::cout << '\n';
+
+    return EXIT_SUCCESS;
+}
+
 namespace {
 
 class MultiSrsPoint {
@@ -28,6 +28,9 @@
 #include <iostream>
 #include <algorithm>
 #include <iterator>
+#include <vector>
+#include <cmath>
+#include <cstdint>
 
 #include <boost/filesystem.hpp>
 
@@ -37,6 +40,7 @@
 #include "utility/streams.hpp"
 
 #include "utility/buildsys.hpp"
+#include "utility/enum-io.hpp"
 #include "utility/gccversion.hpp"
 #include "utility/progress.hpp"
 #include "utility/streams.hpp"
@@ -75,9 +79,15 @@ namespace ba = boost::algorithm;
 namespace fs = boost::filesystem;
 namespace ublas = boost::numeric::ublas;
 
+UTILITY_GENERATE_ENUM(Mode,
+                      ((mesh))
+                      ((navtile))
+                      )
+
 namespace {
 
 struct Config {
+    Mode mode;
     boost::optional<vts::Lod> lod;
     math::Size2 samplesPerTile;
     boost::optional<std::string> srs;
@@ -85,7 +95,8 @@ struct Config {
     double dtmExtractionRadius;
 
     Config()
-        : samplesPerTile(128, 128), geoidGrid("egm96_15.gtx")
+        : mode(Mode::mesh), samplesPerTile(128, 128)
+        , geoidGrid("egm96_15.gtx")
         , dtmExtractionRadius(10)
     {}
 };
@@ -134,6 +145,14 @@ void Vts2Dem::configuration(po::options_description &cmdline
          , "Path to output (vts) tile set.")
         ("overwrite", "Existing tile set gets overwritten if set.")
 
+        ("mode", po::value(&config_.mode)
+         ->default_value(config_.mode)->required()
+         , "Source of heights: mesh (rasterize meshes at given lod) or "
+         "navtile (sample navtiles at given or coarser lods, rasterize "
+         "meshes only where no navtile is available). Navtile mode is "
+         "way faster and is suitable for quick-look and medium resolution "
+         "DEMs.")
+
         ("lod", po::value<vts::Lod>()
          , "Rasterize given lod instead of the highest one.")
 
@@ -264,12 +283,173 @@ void rasterize(cv::Mat_<double> &pane, const vts::Mesh &mesh)
     }
 }
 
-void process(cv::Mat *data, geo::GeoDataset::Mask *mask
-             , const vts::TileSet *ts, vts::Lod lod
-             , const vts::TileRange *tileRange
-             , const Config *config
-             , const vts::CsConvertor *phys2sd)
+/** Output raster coverage by navtiles.
+ */
+struct Covered {
+    /** Samples filled from navtiles (non-zero).
+     */
+    cv::Mat_<std::uint8_t> samples;
+
+    /** Tiles (in tile range, row-major) completely filled from navtiles.
+     */
+    std::vector<char> tiles;
+};
+
+/** Samples navtiles into output raster.
+ *
+ *  Navtiles are processed from coarse to fine lods, therefore finer navtile
+ *  overwrites samples of its coarser ancestor and output tile is always filled
+ *  from the finest navtile available. Navtile heights are converted from
+ *  navigation SRS to output SRS.
+ *
+ *  Only samples inside navtile coverage mask are filled. Tile is marked as
+ *  covered only when all its samples are filled from navtiles.
+ *
+ * \return coverage of output raster by navtiles
+ */
+Covered sampleNavtiles(cv::Mat &data, const vts::TileSet &ts
+                       , const vts::TileId &rootId, vts::Lod lod
+                       , const vts::TileRange &tileRange
+                       , const math::Extents2 &extents
+                       , const Config &config
+                       , const geo::SrsDefinition &srs)
 {
+    const auto sizeInTiles(vts::tileRangesSize(tileRange));
+    Covered covered;
+    covered.samples.create(data.rows, data.cols);
+    covered.samples = std::uint8_t(0);
+
+    const auto &rf(ts.referenceFrame());
+    const auto &size(config.samplesPerTile);
+    const auto es(math::size(extents));
+    const math::Size2f px(es.width / data.cols, es.height / data.rows);
+    const auto ntSize(vts::NavTile::size());
+
+    cv::Mat_<double> pane(data);
+
+    for (auto l(std::max(rootId.lod, ts.lodRange().min)); l <= lod; ++l) {
+        // navtiles at this lod over output tile range
+        const auto range(vts::parentRange(tileRange, lod - l));
+        std::vector<vts::TileId> navtiles;
+        traverse(ts.tileIndex(), l, [&](const vts::TileId &tileId
+                                        , vts::QTree::value_type flags)
+        {
+            if (!(flags & vts::TileIndex::Flag::navtile)) { return; }
+            if ((tileId.x < range.ll(0)) || (tileId.x > range.ur(0))
+                || (tileId.y < range.ll(1)) || (tileId.y > range.ur(1)))
+            {
+                return;
+            }
+            navtiles.push_back(tileId);
+        });
+
+        if (navtiles.empty()) { continue; }
+
+        LOG(info3) << "Sampling " << navtiles.size()
+                   << " navtiles at LOD " << l << ".";
+
+        // navtiles at the same lod cover disjoint parts of the output
+        const auto count(navtiles.size());
+        UTILITY_OMP(parallel)
+        {
+            // SDS <-> navigation SRS convertors (one set per thread)
+            const vts::CsConvertor sd2nav(*config.srs, rf.model.navigationSrs);
+            const vts::CsConvertor nav2sd(rf.model.navigationSrs, srs);
+
+            UTILITY_OMP(for schedule(dynamic))
+            for (std::size_t n = 0; n < count; ++n) {
+                const auto &tileId(navtiles[n]);
+
+                vts::opencv::NavTile navtile;
+                UTILITY_OMP(critical)
+                    ts.getNavTile(tileId, navtile);
+
+                const auto &mask(navtile.coverageMask());
+                const auto ne(vts::NodeInfo(rf, tileId).extents());
+
+                LOG(info1) << "Sampling navtile " << tileId << ".";
+
+                const auto cr(vts::childRange(tileId, lod));
+                for (auto y(std::max(cr.ll(1), tileRange.ll(1)))
+                         , ey(std::min(cr.ur(1), tileRange.ur(1)));
+                     y <= ey; ++y)
+                {
+                    for (auto x(std::max(cr.ll(0), tileRange.ll(0)))
+                             , ex(std::min(cr.ur(0), tileRange.ur(0)));
+                         x <= ex; ++x)
+                    {
+                        const auto tx(x - tileRange.ll(0));
+                        const auto ty(y - tileRange.ll(1));
+
+                        for (int j(0); j < size.height; ++j) {
+                            const int row(ty * size.height + j);
+                            const auto gy
+                                (extents.ur(1) - (row + 0.5) * px.height);
+
+                            for (int i(0); i < size.width; ++i) {
+                                const int col(tx * size.width + i);
+                                const math::Point2 p
+                                    (extents.ll(0) + (col + 0.5) * px.width
+                                     , gy);
+
+                                const auto ntp(vts::NavTile::sds2px(p, ne));
+                                const int mx
+                                    (std::min(std::max
+                                              (int(std::round(ntp(0))), 0)
+                                              , ntSize.width - 1));
+                                const int my
+                                    (std::min(std::max
+                                              (int(std::round(ntp(1))), 0)
+                                              , ntSize.height - 1));
+                                if (!mask.get(mx, my)) { continue; }
+
+                                // height is in navigation SRS
+                                auto np(sd2nav(math::Point3(p(0), p(1), 0.0)));
+                                np(2) = navtile.sample(ntp);
+                                pane(row, col) = nav2sd(np)(2);
+                                covered.samples(row, col) = 1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // tile is covered only when navtiles filled all its samples
+    const auto tileArea(size.width * size.height);
+    covered.tiles.assign(sizeInTiles.width * sizeInTiles.height, false);
+    for (int ty(0); ty < sizeInTiles.height; ++ty) {
+        for (int tx(0); tx < sizeInTiles.width; ++tx) {
+            const cv::Mat_<std::uint8_t> tile
+                (covered.samples
+                 , cv::Range(ty * size.height, (ty + 1) * size.height)
+                 , cv::Range(tx * size.width, (tx + 1) * size.width));
+            covered.tiles[ty * sizeInTiles.width + tx]
+                = (cv::countNonZero(tile) == tileArea);
+        }
+    }
+
+    return covered;
+}
+
+/** Rasterizes meshes at given lod into output raster. Tiles completely
+ *  covered by navtiles are skipped; in partially covered tiles only samples
+ *  not filled from navtiles are written.
+ *
+ * \return number of rasterized tiles
+ */
+std::size_t process(cv::Mat *data, geo::GeoDataset::Mask *mask
+                    , const vts::TileSet *ts, vts::Lod lod
+                    , const vts::TileRange *tileRange
+                    , const Config *config
+                    , const geo::SrsDefinition *srs
+                    , const Covered *covered = nullptr)
+{
+    const auto sizeInTiles(vts::tileRangesSize(*tileRange));
+    std::size_t rasterized(0);
+    auto *counter(&rasterized);
+
     UTILITY_OMP(parallel)
     UTILITY_OMP(single)
     traverse(ts->tileIndex(), lod, [=](vts::TileId tileId
@@ -277,6 +457,21 @@ void process(cv::Mat *data, geo::GeoDataset::Mask *mask
     {
         if (!vts::TileIndex::Flag::isReal(flags)) { return; }
 
+        const bool inRange((tileId.x >= tileRange->ll(0))
+                           && (tileId.x <= tileRange->ur(0))
+                           && (tileId.y >= tileRange->ll(1))
+                           && (tileId.y <= tileRange->ur(1)));
+
+        if (covered && inRange
+            && covered->tiles[(tileId.y - tileRange->ll(1))
+                              * sizeInTiles.width
+                              + (tileId.x - tileRange->ll(0))])
+        {
+            return;
+        }
+
+        ++*counter;
+
         UTILITY_OMP(task)
         {
             auto mesh([&]() -> vts::Mesh
@@ -302,13 +497,31 @@ void process(cv::Mat *data, geo::GeoDataset::Mask *mask
                 (*data, cv::Range(offset(1), offset(1) + size.height)
                  , cv::Range(offset(0), offset(0) + size.width));
 
-            makeLocal(mesh, ni, *phys2sd, config->samplesPerTile);
-
-            rasterize(pane, mesh);
+            // tile -> SRS covertor (convertor is bound to current thread)
+            const vts::CsConvertor phys2sd
+                (ts->referenceFrame().model.physicalSrs, *srs);
+
+            makeLocal(mesh, ni, phys2sd, config->samplesPerTile);
+
+            if (!covered || !inRange) {
+                rasterize(pane, mesh);
+            } else {
+                // partially covered tile: keep navtile samples
+                const cv::Mat_<std::uint8_t> filled
+                    (covered->samples
+                     , cv::Range(offset(1), offset(1) + size.height)
+                     , cv::Range(offset(0), offset(0) + size.width));
+
+                // samples outside navtile coverage still hold no data value
+                cv::Mat_<double> tmp(pane.clone());
+                rasterize(tmp, mesh);
+                tmp.copyTo(pane, (filled == 0));
+            }
         }
     });
 
     (void) mask;
+    return rasterized;
 }
 
 int Vts2Dem::run()
@@ -435,17 +648,35 @@ int Vts2Dem::run()
                                         , ndv));
     output.data() = cv::Scalar(*ndv);
 
-    // tile -> SRS covertor
-    const vts::CsConvertor phys2sd(rf.model.physicalSrs, srs);
-
-    LOG(info3) << "Rasterizing " << sizeInTiles << "tiles ("
-               << tr << ") at LOD " << lod << ".";
+    if (config_.mode == Mode::mesh) {
+        LOG(info3) << "Rasterizing " << sizeInTiles << "tiles ("
+                   << tr << ") at LOD " << lod << ".";
 
-    process(&output.data(), &output.mask(), &input, lod, &tr
-            , &config_, &phys2sd);
+        process(&output.data(), &output.mask(), &input, lod, &tr
+                , &config_, &srs);
 
-    // filter via "DTM" filter
-    vts::dtmize(output, dtmKernelSize);
+        // filter via "DTM" filter
+        vts::dtmize(output, dtmKernelSize);
+    } else {
+        LOG(info3) << "Sampling navtiles for " << sizeInTiles << "tiles ("
+                   << tr << ") at LOD " << lod << ".";
+
+        const auto covered(sampleNavtiles(output.data(), input, rootId, lod
+                                          , tr, extents, config_, srs));
+
+        // fallback to meshes where there is no navtile
+        const auto rasterized(process(&output.data(), &output.mask(), &input
+                                      , lod, &tr, &config_, &srs
+                                      , &covered));
+
+        if (rasterized) {
+            LOG(info3) << "Rasterized " << rasterized
+                       << " tiles not fully covered by navtiles from meshes.";
+            // navtiles are terrain already, filter only when meshes were
+            // rasterized
+            vts::dtmize(output, dtmKernelSize);
+        }
+    }
 
     output.flush();
 
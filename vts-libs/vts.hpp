@@ -58,12 +58,33 @@ TileSet createTileSet(const boost::filesystem::path &path
                       , const TileSetProperties &properties
                       , CreateMode mode = CreateMode::failIfExists);
 
+/** Creates plain tileset, honours create mode and content store from
+ *  createOptions.
+ */
+TileSet createTileSet(const boost::filesystem::path &path
+                      , const TileSetProperties &properties
+                      , const CloneOptions &createOptions);
+
 TileSet openTileSet(const boost::filesystem::path &path
                     , const OpenOptions &openOptions = OpenOptions());
 
 TileSet cloneTileSet(const boost::filesystem::path &path, const TileSet &src
                      , const CloneOptions &cloneOptions);
 
+/** Recovers lost or damaged tile index of plain tileset from its archives.
+ *
+ *  Tile flags are rebuilt from archive indices (mesh, atlas, navtile);
+ *  existing metatiles are authoritative for tiles they cover (incl. alien
+ *  flag). Recovered index is written back unless options.dryRun is set.
+ *
+ * \param path path to tileset
+ * \param options recovery options
+ * \return recovered tile index
+ */
+TileIndex recoverTileSetIndex(const boost::filesystem::path &path
+                              , const RecoverIndexOptions &options
+                              = RecoverIndexOptions());
+
 TileSet concatTileSets(const boost::filesystem::path &path
                        , const std::vector<boost::filesystem::path> &tilesets
                        , const CloneOptions &createOptions);
@@ -134,6 +155,21 @@ TileSet createLocalTileSet(const boost::filesystem::path &path
                            , const boost::filesystem::path &localPath
                            , const CloneOptions &createOptions);
 
+/** Creates transient in-memory tileset. Tile data over memory budget (in
+ *  bytes) are spilled to disk under given path. Content is lost when tileset
+ *  is destroyed; use cloneTileSet to make it persistent.
+ */
+TileSet createMemoryTileSet(const boost::filesystem::path &path
+                            , const TileSetProperties &properties
+                            , std::size_t budget
+                            , CreateMode mode = CreateMode::failIfExists);
+
+/** Creates read-only single-file bundle from existing tileset.
+ */
+TileSet createBundleTileSet(const boost::filesystem::path &path
+                            , const boost::filesystem::path &sourcePath
+                            , const CloneOptions &createOptions);
+
 } } // namespace vtslibs::vts
 
 #endif // vtslibs_vts_hpp_included_
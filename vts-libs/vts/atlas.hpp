@@ -32,11 +32,13 @@
 #include <vector>
 
 #include <boost/any.hpp>
+#include <boost/optional.hpp>
 #include <boost/filesystem/path.hpp>
 
 #include "math/geometry_core.hpp"
 
 #include "./multifile.hpp"
+#include "./texturequality.hpp"
 
 namespace vtslibs { namespace vts {
 
@@ -121,6 +123,27 @@ private:
 Atlas::pointer inpaint(const Atlas &atlas, const Mesh &mesh
                        , int textureQuality);
 
+/** Downscale atlas.
+ *
+ *  Shrinks every image by given factor (size rounded up). Texture coordinates
+ *  are normalized and therefore stay valid. Fails if OpenCV support is not
+ *  compiled in.
+ */
+Atlas::pointer downscale(const Atlas &atlas, int factor
+                         , int textureQuality);
+
+/** Repack atlas.
+ *
+ *  Repacks every texture to contain only area referenced by mesh faces (see
+ *  repackAtlas in meshop.hpp). Texture coordinates in mesh are updated in
+ *  place. Returns null pointer (and leaves mesh untouched) if no texture was
+ *  repacked. Repacked textures are encoded with adaptive quality if
+ *  given. Fails if OpenCV support is not compiled in.
+ */
+Atlas::pointer repack(const Atlas &atlas, Mesh &mesh, int textureQuality
+                      , const boost::optional<AdaptiveQuality>
+                      &adaptiveQuality = boost::none);
+
 inline double Atlas::area(std::size_t index) const
 {
     auto s(imageSize(index));
@@ -28,6 +28,7 @@
 
 #include <new>
 #include <string>
+#include <vector>
 
 #include "math/geometry_core.hpp"
 
@@ -35,6 +36,7 @@
 
 #include "../storage/lod.hpp"
 #include "../storage/range.hpp"
+#include "../storage/filetypes.hpp"
 #include "../registry.hpp"
 
 namespace vtslibs { namespace vts {
@@ -139,8 +141,26 @@ typedef std::vector<TilesetId> TilesetIdList;
 typedef std::set<TilesetId> TilesetIdSet;
 typedef std::map<TilesetId, std::size_t> TilesetIdCounts;
 
+/** File flavor. Half and quarter are reduced-resolution atlas variants.
+ */
 enum class FileFlavor {
-    regular, raw, debug
+    regular, raw, debug, half, quarter
+};
+
+/** Single tile file in a batched read request.
+ */
+struct TileFileRequest {
+    TileId tileId;
+    storage::TileFile type;
+    FileFlavor flavor;
+
+    TileFileRequest(const TileId &tileId = TileId()
+                    , storage::TileFile type = storage::TileFile::mesh
+                    , FileFlavor flavor = FileFlavor::regular)
+        : tileId(tileId), type(type), flavor(flavor)
+    {}
+
+    typedef std::vector<TileFileRequest> list;
 };
 
 // inline stuff
@@ -159,6 +179,8 @@ UTILITY_GENERATE_ENUM_IO(FileFlavor,
     ((regular))
     ((raw))
     ((debug))
+    ((half))
+    ((quarter))
 )
 
 } } // namespace vtslibs::vts
@@ -0,0 +1,372 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/coarsen.cpp
+ *
+ * Synthesis of missing coarse LODs.
+ */
+
+#include <map>
+#include <set>
+#include <algorithm>
+#include <tuple>
+#include <cmath>
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "../vts.hpp"
+#include "./coarsen.hpp"
+#include "./meshop.hpp"
+#include "./tileop.hpp"
+#include "./nodeinfo.hpp"
+#include "./csconvertor.hpp"
+#include "./opencv/atlas.hpp"
+
+namespace vtslibs { namespace vts {
+
+namespace {
+
+std::size_t faceCount(const SubMesh::list &submeshes)
+{
+    std::size_t count(0);
+    for (const auto &sm : submeshes) { count += sm.faces.size(); }
+    return count;
+}
+
+typedef std::tuple<long, long, long> Cell;
+
+/** Simplifies submeshes by vertex clustering on regular grid with given cell
+ *  size. All submeshes share the grid and cluster representatives to keep
+ *  seams between them closed.
+ *
+ *  Internal texture coordinates are kept as is, external texture coordinates
+ *  are dropped.
+ */
+SubMesh::list cluster(const SubMesh::list &submeshes
+                      , const math::Extents3 &extents, double cellSize)
+{
+    auto cellOf([&](const math::Point3 &p) -> Cell
+    {
+        return Cell(long(std::floor((p(0) - extents.ll(0)) / cellSize))
+                    , long(std::floor((p(1) - extents.ll(1)) / cellSize))
+                    , long(std::floor((p(2) - extents.ll(2)) / cellSize)));
+    });
+
+    // cluster representative: average of all vertices in the cell
+    struct Representative {
+        math::Point3 sum;
+        std::size_t count;
+
+        Representative() : sum(0.0, 0.0, 0.0), count() {}
+    };
+
+    std::map<Cell, Representative> representatives;
+    for (const auto &sm : submeshes) {
+        for (const auto &v : sm.vertices) {
+            auto &r(representatives[cellOf(v)]);
+            r.sum += v;
+            ++r.count;
+        }
+    }
+
+    SubMesh::list out;
+    for (const auto &sm : submeshes) {
+        SubMesh csm;
+        csm.tc = sm.tc;
+        csm.facesTc = sm.facesTc;
+
+        // map vertices to cluster representatives
+        std::map<Cell, Face::value_type> indices;
+        std::vector<Face::value_type> remap;
+        remap.reserve(sm.vertices.size());
+        for (const auto &v : sm.vertices) {
+            const auto cell(cellOf(v));
+            auto findices(indices.find(cell));
+            if (findices == indices.end()) {
+                const auto &r(representatives[cell]);
+                const Face::value_type index(csm.vertices.size());
+                findices = indices.insert(std::make_pair(cell, index)).first;
+                csm.vertices.push_back(r.sum / double(r.count));
+            }
+            remap.push_back(findices->second);
+        }
+
+        for (const auto &face : sm.faces) {
+            csm.faces.emplace_back
+                (remap[face(0)], remap[face(1)], remap[face(2)]);
+        }
+
+        // drop collapsed faces and unused vertices
+        out.push_back(csm.cleanUp());
+        sm.cloneMetadataInto(out.back());
+        out.back().surfaceReference = sm.surfaceReference;
+    }
+
+    return out;
+}
+
+/** Simplifies submeshes to fit given face budget. Grid is made coarser until
+ *  the budget is met.
+ */
+SubMesh::list simplify(const TileId &tileId, const SubMesh::list &submeshes
+                       , std::size_t faceBudget)
+{
+    const auto original(faceCount(submeshes));
+    if (original <= faceBudget) { return submeshes; }
+
+    math::Extents3 e(math::InvalidExtents{});
+    for (const auto &sm : submeshes) { e = unite(e, extents(sm)); }
+
+    const double size(std::max({ e.ur(0) - e.ll(0), e.ur(1) - e.ll(1)
+                                 , e.ur(2) - e.ll(2) }));
+
+    // regular grid over a surface yields ~2 faces per cell
+    double resolution(std::max(2.0, std::sqrt(faceBudget / 2.0)));
+
+    SubMesh::list out;
+    for (;;) {
+        out = cluster(submeshes, e, size / resolution);
+        const auto count(faceCount(out));
+        if ((count <= faceBudget) || (resolution <= 2.0)) {
+            LOG(info1)
+                << "Tile " << tileId << ": simplified from " << original
+                << " to " << count << " faces.";
+            break;
+        }
+
+        resolution = std::max(2.0, resolution
+                              * std::sqrt(double(faceBudget) / count));
+    }
+
+    return out;
+}
+
+cv::Mat downsample(const cv::Mat &image)
+{
+    if ((image.cols < 2) || (image.rows < 2)) { return image; }
+
+    cv::Mat out;
+    cv::resize(image, out
+               , cv::Size((image.cols + 1) / 2, (image.rows + 1) / 2)
+               , 0, 0, cv::INTER_AREA);
+    return out;
+}
+
+class Coarsener {
+public:
+    Coarsener(TileSet &ts, const CoarsenOptions &options)
+        : ts_(ts), options_(options), rf_(ts.referenceFrame())
+    {}
+
+    /** Generates tile from its children. Returns false if there is nothing
+     *  to generate.
+     */
+    bool generate(const TileId &tileId);
+
+private:
+    /** Returns physical SRS -> given division SRS convertor, built once per
+     *  SRS. Coarsener (and therefore convertor) is used by single thread.
+     */
+    const CsConvertor& sdsConvertor(const std::string &srs);
+
+    TileSet &ts_;
+    const CoarsenOptions &options_;
+    const registry::ReferenceFrame &rf_;
+
+    /** Physical SRS -> division SRS convertors.
+     */
+    std::map<std::string, CsConvertor> phys2sds_;
+};
+
+const CsConvertor& Coarsener::sdsConvertor(const std::string &srs)
+{
+    auto fphys2sds(phys2sds_.find(srs));
+    if (fphys2sds == phys2sds_.end()) {
+        fphys2sds = phys2sds_.insert
+            (std::make_pair(srs, CsConvertor(rf_.model.physicalSrs, srs)))
+            .first;
+    }
+    return fphys2sds->second;
+}
+
+bool Coarsener::generate(const TileId &tileId)
+{
+    const NodeInfo nodeInfo(rf_, tileId);
+    if (!nodeInfo.productive()) {
+        LOG(info1) << "Tile " << tileId << " is not productive; skipped.";
+        return false;
+    }
+
+    // existing tile is left intact
+    if (const auto *node = ts_.getMetaNode(tileId, std::nothrow)) {
+        if (node->geometry()) { return false; }
+    }
+
+    Tile tile;
+    SubMesh::list textured;
+    SubMesh::list untextured;
+    std::vector<cv::Mat> textures;
+    double surrogateSum(0.0);
+    std::size_t surrogateCount(0);
+
+    for (const auto &child : children(tileId)) {
+        const auto *node(ts_.getMetaNode(child, std::nothrow));
+        if (!node || !node->geometry()) { continue; }
+
+        const auto mesh(ts_.getMesh(child));
+        opencv::HybridAtlas atlas;
+        if (node->internalTextureCount()) { ts_.getAtlas(child, atlas); }
+
+        // textured submeshes are always in front
+        std::size_t index(0);
+        for (const auto &sm : mesh) {
+            if (index < atlas.size()) {
+                textured.push_back(sm);
+                textures.push_back(downsample(atlas.get(index)));
+            } else {
+                untextured.push_back(sm);
+            }
+            ++index;
+        }
+
+        const auto &credits(node->credits());
+        tile.credits.insert(credits.begin(), credits.end());
+
+        if (node->geomExtents.validSurrogate()) {
+            surrogateSum += node->geomExtents.surrogate;
+            ++surrogateCount;
+        }
+    }
+
+    const auto texturedCount(textured.size());
+    auto submeshes(textured);
+    submeshes.insert(submeshes.end(), untextured.begin(), untextured.end());
+    if (submeshes.empty()) { return false; }
+
+    submeshes = simplify(tileId, submeshes, options_.faceBudget);
+
+    // build mesh and atlas from non-empty submeshes
+    auto mesh(std::make_shared<Mesh>(false));
+    auto atlas(std::make_shared<opencv::HybridAtlas>
+               (options_.textureQuality));
+    for (std::size_t i(0), e(submeshes.size()); i != e; ++i) {
+        auto &sm(submeshes[i]);
+        if (sm.faces.empty()) { continue; }
+
+        // regenerated later
+        sm.etc.clear();
+        mesh->submeshes.push_back(sm);
+        if (i < texturedCount) { atlas->add(textures[i]); }
+    }
+
+    if (mesh->empty()) { return false; }
+
+    // merge submeshes and repack atlas
+    std::tie(tile.mesh, tile.atlas)
+        = mergeSubmeshes(tileId, mesh, atlas, options_.textureQuality);
+    if (!tile.atlas->size()) { tile.atlas.reset(); }
+
+    auto &outMesh(*tile.mesh);
+
+    // external texture coordinates and coverage are generated in SDS
+    const auto &phys2sds(sdsConvertor(nodeInfo.srs()));
+    {
+        Mesh sdsMesh(outMesh);
+        for (auto &sm : sdsMesh) {
+            for (auto &v : sm.vertices) { v = phys2sds(v); }
+        }
+
+        generateEtc(sdsMesh, nodeInfo.extents()
+                    , nodeInfo.node().externalTexture);
+        generateCoverage(sdsMesh, nodeInfo.extents());
+
+        outMesh.coverageMask = sdsMesh.coverageMask;
+        for (std::size_t i(0), e(outMesh.size()); i != e; ++i) {
+            outMesh[i].etc = sdsMesh[i].etc;
+        }
+    }
+
+    tile.geomExtents = geomExtents(phys2sds, outMesh);
+    if (surrogateCount) {
+        tile.geomExtents.surrogate = surrogateSum / surrogateCount;
+    } else {
+        tile.geomExtents.makeAverageSurrogate();
+    }
+
+    ts_.setTile(tileId, tile, nodeInfo);
+    return true;
+}
+
+} // namespace
+
+TileSet coarsenTileSet(const boost::filesystem::path &path
+                       , const TileSet &src
+                       , const CloneOptions &cloneOptions
+                       , const CoarsenOptions &options)
+{
+    auto dst(cloneTileSet(path, src, cloneOptions));
+
+    const auto lodRange(dst.lodRange());
+    if (lodRange.empty() || (lodRange.min <= options.topLod)) {
+        LOG(info3) << "No LOD to generate in <" << dst.id() << ">.";
+        dst.flush();
+        return dst;
+    }
+
+    Coarsener coarsener(dst, options);
+
+    std::size_t generated(0);
+    for (Lod lod(lodRange.min); lod > options.topLod; --lod) {
+        // collect parents of all tiles with geometry at this LOD
+        std::set<TileId> parents;
+        traverse(dst.tileIndex(), lod
+                 , [&](const TileId &tileId, QTree::value_type mask)
+        {
+            if (mask & TileIndex::Flag::mesh) {
+                parents.insert(parent(tileId));
+            }
+        });
+
+        if (parents.empty()) { break; }
+
+        LOG(info3) << "Generating " << parents.size()
+                   << " tile(s) at LOD " << (lod - 1) << ".";
+
+        for (const auto &tileId : parents) {
+            if (coarsener.generate(tileId)) { ++generated; }
+        }
+    }
+
+    LOG(info3) << "Generated " << generated << " coarse tile(s) in <"
+               << dst.id() << ">.";
+
+    dst.flush();
+    return dst;
+}
+
+} } // namespace vtslibs::vts
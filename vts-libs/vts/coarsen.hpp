@@ -0,0 +1,88 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/coarsen.hpp
+ *
+ * Synthesis of missing coarse LODs.
+ */
+
+#ifndef vtslibs_vts_coarsen_hpp_included_
+#define vtslibs_vts_coarsen_hpp_included_
+
+#include <boost/filesystem/path.hpp>
+
+#include "./basetypes.hpp"
+#include "./options.hpp"
+#include "./tileset.hpp"
+
+namespace vtslibs { namespace vts {
+
+/** Coarse LOD synthesis options.
+ */
+struct CoarsenOptions {
+    /** Topmost LOD to generate.
+     */
+    Lod topLod;
+
+    /** Maximum number of faces in generated tile.
+     */
+    std::size_t faceBudget;
+
+    /** JPEG quality of repacked atlases (0-100).
+     */
+    int textureQuality;
+
+    CoarsenOptions()
+        : topLod(), faceBudget(5000), textureQuality(85)
+    {}
+};
+
+/** Clones tileset to given path and generates all missing LODs above source
+ *  tileset's topmost LOD up to options.topLod.
+ *
+ *  Each generated tile is built bottom-up from its (up to four) children:
+ *  children meshes are joined and simplified by vertex clustering to fit face
+ *  budget, their textures are downsampled to half resolution and everything
+ *  is compacted via mergeSubmeshes (i.e. submeshes are merged and atlases are
+ *  repacked).
+ *
+ *  Only tiles whose subtree contains data at source tileset's topmost LOD are
+ *  generated.
+ *
+ * \param path path to output tileset
+ * \param src source tileset
+ * \param cloneOptions options for output tileset creation
+ * \param options synthesis options
+ * \return output tileset
+ */
+TileSet coarsenTileSet(const boost::filesystem::path &path
+                       , const TileSet &src
+                       , const CloneOptions &cloneOptions
+                       , const CoarsenOptions &options = CoarsenOptions());
+
+} } // namespace vtslibs::vts
+
+#endif // vtslibs_vts_coarsen_hpp_included_
@@ -23,29 +23,155 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <map>
+#include <tuple>
+#include <mutex>
+
 #include "./csconvertor.hpp"
 
 namespace vtslibs { namespace vts {
 
+/** Parsed source and destination SRS definitions.
+ */
+struct CsConvertor::Definitions {
+    ::OGRSpatialReference from;
+    ::OGRSpatialReference to;
+
+    /** Set if vertical adjustment is applied in given SRS.
+     */
+    boost::optional<geo::SrsDefinition> adjustFrom;
+    boost::optional<geo::SrsDefinition> adjustTo;
+};
+
+namespace {
+
+/** Cache key: (from SRS, from type, from adjust vertical flag, to SRS, to
+ *  type, to adjust vertical flag).
+ */
+typedef std::tuple<std::string, int, bool, std::string, int, bool> CacheKey;
+
+/** Process-wide cache of parsed SRS definitions. Consulted only when
+ *  building new convertor (see ConvertorCache).
+ */
+class DefinitionsCache {
+public:
+    typedef CsConvertor::Definitions Definitions;
+
+    Definitions get(const geo::SrsDefinition &srsFrom, bool adjustFrom
+                    , const geo::SrsDefinition &srsTo, bool adjustTo)
+    {
+        const CacheKey key(srsFrom.srs, int(srsFrom.type), adjustFrom
+                           , srsTo.srs, int(srsTo.type), adjustTo);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto fmap(map_.find(key));
+        if (fmap == map_.end()) {
+            // limit cache size
+            if (map_.size() >= MaxSize) { map_.clear(); }
+
+            Definitions defs;
+            defs.from = srsFrom.reference();
+            defs.to = srsTo.reference();
+            if (adjustFrom) { defs.adjustFrom = srsFrom; }
+            if (adjustTo) { defs.adjustTo = srsTo; }
+            fmap = map_.insert(Map::value_type(key, defs)).first;
+        }
+
+        // copy under lock
+        return fmap->second;
+    }
+
+    static DefinitionsCache& instance() {
+        static DefinitionsCache cache;
+        return cache;
+    }
+
+private:
+    typedef std::map<CacheKey, Definitions> Map;
+    static constexpr std::size_t MaxSize = 128;
+
+    std::mutex mutex_;
+    Map map_;
+};
+
+/** Per-thread cache of fully built convertors.
+ *
+ *  Creating coordinate transformation is far more expensive than converting
+ *  a point. Transformation objects must not be shared between threads,
+ *  therefore every thread builds and owns its convertors; copies handed out
+ *  share transformation with the cached instance and thus belong to the
+ *  same thread.
+ */
+class ConvertorCache {
+public:
+    template <typename Factory>
+    const CsConvertor& get(const CacheKey &key, const Factory &factory) {
+        auto fmap(map_.find(key));
+        if (fmap != map_.end()) { return fmap->second; }
+
+        // limit cache size
+        if (map_.size() >= MaxSize) { map_.clear(); }
+        return map_.insert(Map::value_type(key, factory())).first->second;
+    }
+
+    static ConvertorCache& instance() {
+        thread_local ConvertorCache cache;
+        return cache;
+    }
+
+private:
+    typedef std::map<CacheKey, CsConvertor> Map;
+    static constexpr std::size_t MaxSize = 128;
+
+    Map map_;
+};
+
+} // namespace
+
+const CsConvertor&
+CsConvertor::cached(const geo::SrsDefinition &srsFrom, bool adjustFrom
+                    , const geo::SrsDefinition &srsTo, bool adjustTo)
+{
+    const CacheKey key(srsFrom.srs, int(srsFrom.type), adjustFrom
+                       , srsTo.srs, int(srsTo.type), adjustTo);
+
+    return ConvertorCache::instance().get(key, [&]() -> CsConvertor
+    {
+        CsConvertor conv;
+        conv.init(DefinitionsCache::instance().get
+                  (srsFrom, adjustFrom, srsTo, adjustTo));
+        return conv;
+    });
+}
+
 CsConvertor::CsConvertor(const std::string &srsIdFrom
                          , const std::string &srsIdTo
                          , const registry::Registry &reg)
 {
-    init(&reg.srs(srsIdFrom), &reg.srs(srsIdTo));
+    const auto &srsFrom(reg.srs(srsIdFrom));
+    const auto &srsTo(reg.srs(srsIdTo));
+
+    // same SRS -> no-op convertor
+    if (&srsFrom == &srsTo) { return; }
+
+    *this = cached(srsFrom.srsDef, srsFrom.adjustVertical()
+                   , srsTo.srsDef, srsTo.adjustVertical());
 }
 
 CsConvertor::CsConvertor(const geo::SrsDefinition &srsFrom
                          , const std::string &srsIdTo
                          , const registry::Registry &reg)
 {
-    init(srsFrom, reg.srs(srsIdTo));
+    const auto &srsTo(reg.srs(srsIdTo));
+    *this = cached(srsFrom, false, srsTo.srsDef, srsTo.adjustVertical());
 }
 
 CsConvertor::CsConvertor(const std::string &srsIdFrom
                          , const geo::SrsDefinition &srsTo
                          , const registry::Registry &reg)
 {
-    init(reg.srs(srsIdFrom), srsTo);
+    const auto &srsFrom(reg.srs(srsIdFrom));
+    *this = cached(srsFrom.srsDef, srsFrom.adjustVertical(), srsTo, false);
 }
 
 CsConvertor::CsConvertor(const ::OGRSpatialReference &srsFrom
@@ -68,53 +194,16 @@ CsConvertor::CsConvertor(const boost::optional<geo::CsConvertor> &conv
     : conv_(conv), srcAdjuster_(srcAdjuster), dstAdjuster_(dstAdjuster)
 {}
 
-void CsConvertor::init(const registry::Srs *srsFrom
-                       , const registry::Srs *srsTo)
+void CsConvertor::init(const Definitions &defs)
 {
-    LOG(debug) << "CsConvert(\"" << srsFrom->srsDef << '"'
-               << (srsFrom->adjustVertical() ? " [va]" : "")
-               << ", \"" << srsTo->srsDef << '"'
-               << (srsTo->adjustVertical() ? " [va]" : "")
-               << ").";
-    if (srsFrom != srsTo) {
-        conv_ = boost::in_place(srsFrom->srsDef, srsTo->srsDef);
-
-        if (srsFrom->adjustVertical()) {
-            srcAdjuster_ = geo::VerticalAdjuster(srsFrom->srsDef);
-        }
+    conv_ = boost::in_place(defs.from, defs.to);
 
-        if (srsTo->adjustVertical()) {
-            dstAdjuster_ = geo::VerticalAdjuster(srsTo->srsDef);
-        }
+    if (defs.adjustFrom) {
+        srcAdjuster_ = geo::VerticalAdjuster(*defs.adjustFrom);
     }
-}
 
-void CsConvertor::init(const geo::SrsDefinition &srsFrom
-                       , const registry::Srs &srsTo)
-{
-    LOG(debug) << "CsConvert(\"" << srsFrom.srs << "\", \""
-               << srsTo.srsDef << '"'
-               << (srsTo.adjustVertical() ? " [va]" : "")
-               << ").";
-    conv_ = boost::in_place(srsFrom, srsTo.srsDef);
-
-    if (srsTo.adjustVertical()) {
-        dstAdjuster_ = geo::VerticalAdjuster(srsTo.srsDef);
-    }
-}
-
-
-void CsConvertor::init(const registry::Srs &srsFrom
-                       , const geo::SrsDefinition &srsTo)
-{
-    LOG(debug) << "CsConvert(\"" << srsFrom.srsDef << '"'
-               << (srsFrom.adjustVertical() ? " [va]" : "")
-               << ", \""
-               << srsTo.srs << "\").";
-    conv_ = boost::in_place(srsFrom.srsDef, srsTo);
-
-    if (srsFrom.adjustVertical()) {
-        srcAdjuster_ = geo::VerticalAdjuster(srsFrom.srsDef);
+    if (defs.adjustTo) {
+        dstAdjuster_ = geo::VerticalAdjuster(*defs.adjustTo);
     }
 }
 
@@ -34,6 +34,11 @@
 namespace vtslibs { namespace vts {
 
 /** Coordinate system convertor.
+ *
+ *  Convertors created from SRS IDs or SRS definitions are built once per
+ *  thread and then served from per-thread cache; SRS definitions are parsed
+ *  once per process. Convertor (and any copy of it) must be used only in the
+ *  thread that created it.
  */
 class CsConvertor {
 public:
@@ -113,11 +118,22 @@ private:
                 , const geo::VerticalAdjuster &srcAdjuster
                 , const geo::VerticalAdjuster &dstAdjuster);
 
+public:
+    /** Parsed SRS definitions, shared via process-wide cache.
+     */
+    struct Definitions;
+
+private:
+    /** Returns convertor from calling thread's cache, builds it on miss.
+     */
+    static const CsConvertor& cached(const geo::SrsDefinition &srsFrom
+                                     , bool adjustFrom
+                                     , const geo::SrsDefinition &srsTo
+                                     , bool adjustTo);
+
     /** Initialization helpers.
      */
-    void init(const registry::Srs *srsFrom, const registry::Srs *srsTo);
-    void init(const geo::SrsDefinition &srsFrom, const registry::Srs &srsTo);
-    void init(const registry::Srs &srsFrom, const geo::SrsDefinition &srsTo);
+    void init(const Definitions &definitions);
     void init(const ::OGRSpatialReference &srsFrom
               , const registry::Srs &srsTo);
     void init(const registry::Srs &srsFrom
@@ -31,6 +31,7 @@ std::vector<EncodeFlags::EncodeFlag> EncodeFlags::mapping = {
     EncodeFlag(vts::CloneOptions::EncodeFlag::mesh, "mesh")
     , EncodeFlag(vts::CloneOptions::EncodeFlag::inpaint, "inpaint")
     , EncodeFlag(vts::CloneOptions::EncodeFlag::meta, "meta")
+    , EncodeFlag(vts::CloneOptions::EncodeFlag::repack, "repack")
 };
 
 } } // namespace vtslibs::vts
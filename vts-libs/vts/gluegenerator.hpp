@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/gluegenerator.hpp
+ *
+ * On-demand generation of pending glues.
+ */
+
+#ifndef vtslibs_vts_gluegenerator_hpp_included_
+#define vtslibs_vts_gluegenerator_hpp_included_
+
+#include <memory>
+
+#include "./basetypes.hpp"
+#include "./glue.hpp"
+#include "./tileindex.hpp"
+#include "./options.hpp"
+#include "./storage/locking.hpp"
+
+namespace vtslibs { namespace vts {
+
+class Storage;
+class Driver;
+
+/** On-demand glue generator.
+ *
+ *  Lets aggregated driver serve storage with pending glues. Glue content is
+ *  generated metatile by metatile when first accessed and persisted in the
+ *  storage so it survives restarts. Generated content is discarded once the
+ *  glue is generated as a whole (i.e. by glue-generate).
+ *
+ *  Implementation must be thread safe.
+ */
+class GlueGenerator {
+public:
+    typedef std::shared_ptr<GlueGenerator> pointer;
+
+    virtual ~GlueGenerator() {}
+
+    /** Returns tile index of all tiles given pending glue can contain. Each
+     *  present tile is marked as a mesh/atlas/navtile tile; some of them are
+     *  not generated at all.
+     */
+    virtual TileIndex expected(const Storage &storage
+                               , const Glue::Id &glueId) = 0;
+
+    /** Generates all glue tiles inside metatile with given ID unless already
+     *  generated. Each metatile is generated only once.
+     *
+     *  Returns driver for generated glue content.
+     */
+    virtual std::shared_ptr<Driver> generate(const Storage &storage
+                                             , const Glue::Id &glueId
+                                             , const TileId &metaId) = 0;
+};
+
+/** Creates default on-demand glue generator. Glue creation options are used
+ *  for each generated metatile. Generation of glue metatile is guarded by
+ *  glue lock in the storage if locker is provided, otherwise only inside
+ *  current process.
+ *
+ *  NB: available only in the main vts-libs library.
+ */
+GlueGenerator::pointer
+createGlueGenerator(const GlueCreationOptions &options
+                    , const StorageLocker::pointer &locker = nullptr);
+
+} } // namespace vtslibs::vts
+
+#endif // vtslibs_vts_gluegenerator_hpp_included_
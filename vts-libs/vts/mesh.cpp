@@ -23,6 +23,8 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <sstream>
+
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 #include <boost/iostreams/restrict.hpp>
@@ -517,6 +519,96 @@ MeshMask loadMeshMask(std::istream &in
     return mask;
 }
 
+bool copyMesh(std::istream &in, std::ostream &out
+              , SubMesh::SurfaceReference surfaceReference
+              , const fs::path &path, registry::IdSet *textureLayers)
+{
+    const auto table(readMeshTable(in, path));
+
+    auto read([&](const multifile::Table::Entry &entry) -> std::string
+    {
+        std::string data(entry.size, '\0');
+        in.seekg(entry.start);
+        in.read(&data[0], data.size());
+        return data;
+    });
+
+    // fetch mesh proper, uncompress if needed
+    std::string meshProper;
+    in.seekg(table.entries[0].start);
+    const bool compressed(storage::gzipped(in));
+    if (compressed) {
+        bio::filtering_istream gzipped;
+        gzipped.push
+            (bio::gzip_decompressor(bio::gzip_params().window_bits, 1 << 16));
+        gzipped.push(bio::restrict(in, table.entries[0].start
+                                   , table.entries[0].size));
+        gzipped.exceptions(in.exceptions());
+
+        std::ostringstream os;
+        os << gzipped.rdbuf();
+        meshProper = os.str();
+    } else {
+        meshProper = read(table.entries[0]);
+    }
+
+    registry::IdSet layers;
+    const auto subMeshCount
+        (detail::remapSurfaceReferences(meshProper, surfaceReference
+                                        , path, layers));
+    if (!subMeshCount) { return false; }
+
+    // find end of coverage mask (surface mapping follows)
+    in.seekg(table.entries[1].start);
+    Mesh::CoverageMask().load(in, path);
+    const multifile::Table::Entry maskEntry
+        (table.entries[1].start
+         , std::size_t(in.tellg()) - table.entries[1].start);
+
+    multifile::Table otable(table.version, MF_MAGIC);
+    auto p(out.tellp());
+
+    // mesh proper, compress again if it was compressed
+    if (compressed) {
+        bio::filtering_ostream gzipped;
+        gzipped.push(bio::gzip_compressor(bio::gzip_params(9), 1 << 16));
+        gzipped.push(out);
+        gzipped.write(meshProper.data(), meshProper.size());
+        gzipped.flush();
+    } else {
+        out.write(meshProper.data(), meshProper.size());
+    }
+    p = otable.add(p, out.tellp() - p);
+
+    // mask as is + new surface mapping
+    {
+        const auto mask(read(maskEntry));
+        out.write(mask.data(), mask.size());
+
+        if ((*subMeshCount != 1) || (surfaceReference != 1)) {
+            bin::write(out, std::uint8_t(*subMeshCount));
+            for (auto i(*subMeshCount); i; --i) {
+                bin::write(out, std::uint8_t(surfaceReference));
+            }
+        }
+    }
+    p = otable.add(p, out.tellp() - p);
+
+    // mesh properties as is
+    {
+        const auto properties(read(table.entries[2]));
+        out.write(properties.data(), properties.size());
+    }
+    otable.entries.emplace_back(p, out.tellp() - p);
+
+    multifile::writeTable(otable, out);
+
+    if (textureLayers) {
+        textureLayers->insert(layers.begin(), layers.end());
+    }
+    return true;
+}
+
 MeshMask loadMeshMask(const boost::filesystem::path &path)
 {
     utility::ifstreambuf f(path.string());
@@ -37,6 +37,7 @@
 #include "math/geometry_core.hpp"
 
 #include "../storage/streams.hpp"
+#include "../registry/types.hpp"
 
 #include "./qtree.hpp"
 #include "./multifile.hpp"
@@ -53,6 +54,7 @@ typedef std::vector<VertexMask> VertexMasks;
 
 // fwd
 class Atlas;
+class RawAtlas;
 
 struct SubMesh {
     /** Vertices
@@ -332,6 +334,25 @@ void updateCoverage(Mesh &mesh, const SubMesh &sm
  */
 void generateCoverage(Mesh &mesh, const math::Extents2 &sdsExtents);
 
+/** Clips mesh to given extents in tile's spatial division SRS.
+ *
+ *  Submeshes clipped out completely are removed together with their internal
+ *  textures. New vertices get external texture coordinates generated from
+ *  tile extents, coverage mask is regenerated. Fails if OpenCV support is not
+ *  compiled in.
+ *
+ * \param mesh mesh in physical SRS, clipped in place
+ * \param atlas optional atlas to update in place
+ * \param phys2sds convertor from physical SRS to tile's SDS
+ * \param sds2phys convertor from tile's SDS to physical SRS
+ * \param sdsExtents extents of tile in SDS
+ * \param clipExtents extents to clip to in SDS
+ */
+void clipMesh(Mesh &mesh, RawAtlas *atlas
+              , const CsConvertor &phys2sds, const CsConvertor &sds2phys
+              , const math::Extents2 &sdsExtents
+              , const math::Extents2 &clipExtents);
+
 // IO
 void saveMesh(std::ostream &out, const Mesh &mesh
               , const Atlas *atlas = nullptr);
@@ -366,6 +387,23 @@ MeshMask loadMeshMask(std::istream &is
 MeshMask loadMeshMask(const boost::filesystem::path &path);
 MeshMask loadMeshMask(const storage::IStream::pointer &in);
 
+/** Copies serialized mesh from input to output replacing surface reference of
+ *  all submeshes. Geometry is neither decoded nor re-encoded, coverage mask and
+ *  mesh properties are copied verbatim.
+ *
+ * \param in input mesh file
+ * \param out output mesh file
+ * \param surfaceReference new surface reference of all submeshes
+ * \param path path to input (for error reporting)
+ * \param textureLayers external texture layers used by mesh are added here
+ * \return false if mesh format doesn't allow such operation (nothing is written
+ *         to the output in such case)
+ */
+bool copyMesh(std::istream &in, std::ostream &out
+              , SubMesh::SurfaceReference surfaceReference
+              , const boost::filesystem::path &path = "unknown"
+              , registry::IdSet *textureLayers = nullptr);
+
 // inlines
 
 inline std::uint32_t extraFlags(const Mesh *mesh) {
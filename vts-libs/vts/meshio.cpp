@@ -23,6 +23,8 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <cstring>
+
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 
@@ -38,6 +40,7 @@
 #include "../registry/referenceframe.hpp"
 
 #include "./mesh.hpp"
+#include "./meshio.hpp"
 #include "./atlas.hpp"
 
 namespace fs = boost::filesystem;
@@ -835,6 +838,138 @@ void loadMeshProper(std::istream &in, const boost::filesystem::path &path
     loadMeshProperImpl(in, path, mesh.submeshes);
 }
 
+namespace {
+
+/** Walks serialized mesh proper held in memory.
+ */
+class MeshWalker {
+public:
+    MeshWalker(std::string &data, const fs::path &path)
+        : data_(data), path_(path), pos_()
+    {}
+
+    template <typename T> T read() {
+        check(sizeof(T));
+        T value;
+        std::memcpy(&value, &data_[pos_], sizeof(T));
+        pos_ += sizeof(T);
+        return value;
+    }
+
+    template <typename T> void write(const T &value) {
+        check(sizeof(T));
+        std::memcpy(&data_[pos_], &value, sizeof(T));
+        pos_ += sizeof(T);
+    }
+
+    void skip(std::size_t size) {
+        check(size);
+        pos_ += size;
+    }
+
+    /** Skips given number of delta-coded words (see DeltaReader::readWord).
+     */
+    void skipWords(std::size_t count) {
+        while (count--) {
+            if (read<std::uint8_t>() & 0x80) { skip(1); }
+        }
+    }
+
+private:
+    void check(std::size_t size) const {
+        if ((pos_ + size) > data_.size()) {
+            LOGTHROW(err1, storage::BadFileFormat)
+                << "File " << path_ << " is truncated.";
+        }
+    }
+
+    std::string &data_;
+    const fs::path &path_;
+    std::size_t pos_;
+};
+
+} // namespace
+
+boost::optional<std::size_t>
+remapSurfaceReferences(std::string &data
+                       , SubMesh::SurfaceReference surfaceReference
+                       , const fs::path &path
+                       , registry::IdSet &textureLayers)
+{
+    if ((data.size() < sizeof(MAGIC))
+        || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)))
+    {
+        LOGTHROW(err1, storage::BadFileFormat)
+            << "File " << path << " is not a VTS mesh file.";
+    }
+
+    MeshWalker w(data, path);
+    w.skip(sizeof(MAGIC));
+
+    const auto version(w.read<std::uint16_t>());
+    if (version > VERSION) {
+        LOGTHROW(err1, storage::VersionError)
+            << "File " << path
+            << " has unsupported version (" << version << ").";
+    }
+
+    // submesh surface reference was added in version=2
+    if (version < 2) { return boost::none; }
+
+    // mean undulation
+    w.skip(sizeof(double));
+
+    const auto subMeshCount(w.read<std::uint16_t>());
+    for (auto i(subMeshCount); i; --i) {
+        const auto flags(w.read<std::uint8_t>());
+        const bool internal(flags & SubMeshFlag::internalTexture);
+        const bool external(flags & SubMeshFlag::externalTexture);
+
+        w.write(std::uint8_t(surfaceReference));
+
+        const auto textureLayer(w.read<std::uint16_t>());
+        if ((flags & SubMeshFlag::textureMode) && textureLayer) {
+            textureLayers.insert(textureLayer);
+        }
+
+        // bounding box
+        w.skip(6 * sizeof(double));
+
+        const auto vertexCount(w.read<std::uint16_t>());
+        if (version >= 3) {
+            // quantization + vertices
+            w.skip(sizeof(std::uint16_t));
+            w.skipWords(3 * vertexCount);
+
+            if (external) {
+                w.skip(sizeof(std::uint16_t));
+                w.skipWords(2 * vertexCount);
+            }
+
+            if (internal) {
+                const auto tcCount(w.read<std::uint16_t>());
+                w.skip(2 * sizeof(std::uint16_t));
+                w.skipWords(2 * tcCount);
+            }
+
+            const auto faceCount(w.read<std::uint16_t>());
+            w.skipWords((internal ? 6 : 3) * faceCount);
+        } else {
+            w.skip(vertexCount * (external ? 5 : 3) * sizeof(std::uint16_t));
+
+            if (internal) {
+                const auto tcCount(w.read<std::uint16_t>());
+                w.skip(tcCount * 2 * sizeof(std::uint16_t));
+            }
+
+            const auto faceCount(w.read<std::uint16_t>());
+            w.skip(faceCount * (internal ? 6 : 3) * sizeof(std::uint16_t));
+        }
+    }
+
+    return std::size_t(subMeshCount);
+}
+
 } // namespace detail
 
 NormalizedSubMesh::list
@@ -26,6 +26,12 @@
 #ifndef vtslibs_vts_meshio_hpp
 #define vtslibs_vts_meshio_hpp
 
+#include <string>
+
+#include <boost/optional.hpp>
+
+#include "../registry/types.hpp"
+
 #include "mesh.hpp"
 
 namespace vtslibs { namespace vts { namespace detail {
@@ -37,6 +43,23 @@ void saveMeshProper(std::ostream &out, const Mesh &mesh
 void loadMeshProper(std::istream &in, const boost::filesystem::path &path
                     , Mesh &mesh);
 
+/** Replaces surface reference of every submesh in serialized (uncompressed)
+ *  mesh proper held in memory. Geometry is not decoded, encoded data are only
+ *  walked to find submesh headers.
+ *
+ * \param data serialized mesh proper, modified in place
+ * \param surfaceReference new surface reference
+ * \param path path to mesh (for error reporting)
+ * \param textureLayers external texture layers found in mesh are added here
+ * \return number of submeshes or boost::none if mesh format doesn't store
+ *          surface references (i.e. mesh must be decoded and saved again)
+ */
+boost::optional<std::size_t>
+remapSurfaceReferences(std::string &data
+                       , SubMesh::SurfaceReference surfaceReference
+                       , const boost::filesystem::path &path
+                       , registry::IdSet &textureLayers);
+
 
 } } } // namespace vtslibs::vts::detail
 
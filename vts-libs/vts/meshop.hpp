@@ -28,6 +28,8 @@
 
 #include <functional>
 
+#include <boost/optional.hpp>
+
 #include "./mesh.hpp"
 #include "./atlas.hpp"
 #include "./opencv/atlas.hpp"
@@ -146,6 +148,11 @@ struct SubmeshMergeOptions {
      */
     AtlasPacking atlasPacking;
 
+    /** Encode repacked textures with adaptive JPEG quality instead of fixed
+     *  textureQuality.
+     */
+    boost::optional<AdaptiveQuality> adaptiveQuality;
+
     SubmeshMergeOptions()
         : atlasPacking(AtlasPacking::progressive)
     {}
@@ -186,6 +193,23 @@ mergeSubmeshes(const TileId &tileId, const Mesh::pointer &mesh
                , int textureQuality
                , const SubmeshMergeOptions &options = SubmeshMergeOptions());
 
+/** Repacks atlas to contain only texture area referenced by faces.
+ *  Submeshes are never merged, each texture is repacked on its own and
+ *  texture coordinates are remapped. Textures that would not get smaller are
+ *  kept as-is.
+ *  Returns original if no texture has been repacked.
+ *  In case of atlas repacking, returned atlas is image based one.
+ *
+ * \param tileId ID of tile this mesh belongs to (info only)
+ * \param mesh mesh to compact
+ * \param atlas meshe's atlas
+ * \param textureQuality JPEG quality (0-100)
+ */
+std::tuple<Mesh::pointer, Atlas::pointer>
+repackAtlas(const TileId &tileId, const Mesh::pointer &mesh
+            , const RawAtlas::pointer &atlas, int textureQuality
+            , const SubmeshMergeOptions &options = SubmeshMergeOptions());
+
 /** Compute enhanced submesh area.
  */
 SubMeshArea area(const EnhancedSubMesh &submesh, const VertexMask &mask);
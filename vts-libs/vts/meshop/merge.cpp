@@ -51,6 +51,8 @@
 #include "imgproc/reconstruct.hpp"
 #include "imgproc/inpaint.hpp"
 
+#include "../../storage/error.hpp"
+
 #include "../opencv/atlas.hpp"
 #include "../opencv/texture.hpp"
 
@@ -1053,6 +1055,7 @@ void MeshAtlasBuilder::ensureChanged(const Range &range)
         // convert atlas
         atlas_ = boost::apply_visitor
             (AsHybridAtlas(atlasEnd_, textureQuality_), originalAtlas_);
+        atlas_->adaptiveQuality(options_.adaptiveQuality);
     }
 }
 
@@ -1244,4 +1247,76 @@ MeshAtlas mergeSubmeshes(const TileId &tileId, const Mesh::pointer &mesh
         .result();
 }
 
+MeshAtlas repackAtlas(const TileId &tileId, const Mesh::pointer &mesh
+                      , const RawAtlas::pointer &atlas
+                      , int textureQuality
+                      , const SubmeshMergeOptions &options)
+{
+    const auto textured(std::min(mesh->submeshes.size(), atlas->size()));
+
+    Mesh::pointer omesh;
+    HybridAtlas::pointer oatlas;
+
+    for (std::size_t i(0); i != textured; ++i) {
+        const auto &sm(mesh->submeshes[i]);
+        if (sm.tc.empty() || sm.facesTc.empty()) { continue; }
+
+        const auto image(HybridAtlas::imageFromRaw(atlas->get(i)));
+
+        TextureInfo::list texturing;
+        texturing.emplace_back(sm, image, options);
+
+        cv::Mat texture;
+        math::Points2d tc;
+        Faces facesTc;
+        std::tie(texture, tc, facesTc) = joinTextures(tileId, texturing);
+
+        // keep original texture unless repacked one is smaller
+        if (texture.total() >= image.total()) { continue; }
+
+        LOG(info1)
+            << "Repacked texture " << tileId << "/" << i << ": "
+            << image.cols << "x" << image.rows << " -> "
+            << texture.cols << "x" << texture.rows << ".";
+
+        if (!omesh) {
+            omesh = std::make_shared<Mesh>(*mesh);
+            oatlas = std::make_shared<HybridAtlas>
+                (atlas->size(), *atlas, textureQuality);
+            oatlas->adaptiveQuality(options.adaptiveQuality);
+        }
+
+        auto &osm(omesh->submeshes[i]);
+        osm.tc = tc;
+        osm.facesTc = facesTc;
+        oatlas->set(i, texture);
+    }
+
+    if (!omesh) { return MeshAtlas(mesh, atlas); }
+    return MeshAtlas(omesh, oatlas);
+}
+
+Atlas::pointer repack(const Atlas &atlas, Mesh &mesh, int textureQuality
+                      , const boost::optional<AdaptiveQuality> &adaptiveQuality)
+{
+    const auto *raw(dynamic_cast<const RawAtlas*>(&atlas));
+    if (!raw) {
+        LOGTHROW(err1, storage::Unimplemented)
+            << "Only raw atlas can be repacked.";
+    }
+
+    // wrap mesh and atlas in non-owning shared pointers
+    Mesh::pointer m(&mesh, [](void*) {});
+    RawAtlas::pointer a(const_cast<RawAtlas*>(raw), [](void*) {});
+
+    SubmeshMergeOptions options;
+    options.adaptiveQuality = adaptiveQuality;
+
+    const auto repacked(repackAtlas(TileId(), m, a, textureQuality, options));
+    if (std::get<0>(repacked) == m) { return {}; }
+
+    mesh = *std::get<0>(repacked);
+    return std::get<1>(repacked);
+}
+
 } } // namespace vtslibs::vts
@@ -35,6 +35,7 @@
 #include "utility/expect.hpp"
 
 #include "../meshop.hpp"
+#include "../math.hpp"
 
 namespace vtslibs { namespace vts {
 
@@ -823,4 +824,72 @@ MeshArea area(const EnhancedSubMesh::list &mesh, const VertexMasks &masks)
     return out;
 }
 
+namespace {
+
+class TileClipConvertor : public MeshVertexConvertor {
+public:
+    TileClipConvertor(const CsConvertor &sds2phys
+                      , const math::Extents2 &sdsExtents)
+        : sds2phys_(sds2phys), tn_(sdsExtents)
+    {}
+
+    virtual math::Point3d vertex(const math::Point3d &v) const {
+        return sds2phys_(v);
+    }
+
+    virtual math::Point2d etc(const math::Point3d &v) const {
+        return tn_(v);
+    }
+
+    virtual math::Point2d etc(const math::Point2d &v) const {
+        // same tile, nothing to convert
+        return v;
+    }
+
+private:
+    const CsConvertor &sds2phys_;
+    TextureNormalizer tn_;
+};
+
+} // namespace
+
+void clipMesh(Mesh &mesh, RawAtlas *atlas
+              , const CsConvertor &phys2sds, const CsConvertor &sds2phys
+              , const math::Extents2 &sdsExtents
+              , const math::Extents2 &clipExtents)
+{
+    const TileClipConvertor convertor(sds2phys, sdsExtents);
+
+    Mesh out;
+    Mesh sdsMesh;
+    RawAtlas outAtlas;
+
+    for (std::size_t i(0), e(mesh.submeshes.size()); i != e; ++i) {
+        const auto &sm(mesh.submeshes[i]);
+
+        EnhancedSubMesh esm(sm);
+        for (const auto &v : sm.vertices) {
+            esm.projected.push_back(phys2sds(v));
+        }
+
+        auto clipped(clipAndRefine(esm, clipExtents, convertor));
+        if (clipped.mesh.faces.empty()) { continue; }
+
+        // keep texture of this submesh
+        if (atlas && (i < atlas->size())) { outAtlas.add(atlas->get(i)); }
+
+        out.submeshes.push_back(clipped.mesh);
+
+        // remember projected submesh for coverage generation
+        sdsMesh.submeshes.push_back(clipped.mesh);
+        sdsMesh.submeshes.back().vertices.swap(clipped.projected);
+    }
+
+    generateCoverage(sdsMesh, sdsExtents);
+    out.coverageMask = sdsMesh.coverageMask;
+
+    mesh = std::move(out);
+    if (atlas) { *atlas = std::move(outAtlas); }
+}
+
 } } // namespace vtslibs::vts
@@ -24,6 +24,12 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <stdexcept>
+#include <vector>
 
 #include "dbglog/dbglog.hpp"
 
@@ -252,6 +258,7 @@ class RFTreeSubtree::Sampler : boost::noncopyable {
 public:
     Sampler(const RFNode &root, const registry::Registry &reg)
         : conv_(root.srs, root.constraints->extentsSrs, reg)
+        , inv_(root.constraints->extentsSrs, root.srs, reg)
         , extents_(root.constraints->extents)
     {}
 
@@ -263,9 +270,37 @@ public:
         return math::inside(extents_, sample(p));
     }
 
+    /** Returns (cached) coverage mask of given node.
+     */
+    CoverageMask coverageMask(CoverageType type, const math::Size2 &size
+                              , unsigned int dilation, const RFNode &node)
+        const;
+
+    /** Generates coverage mask of given node by sampling every grid point.
+     */
+    CoverageMask sampled(CoverageType type, const math::Size2 &size
+                         , unsigned int dilation, const RFNode &node) const;
+
 private:
+    class Rasterizer;
+
+    CoverageMask generate(CoverageType type, const math::Size2 &size
+                          , unsigned int dilation, const RFNode &node) const;
+
     CsConvertor conv_;
+    CsConvertor inv_;
     math::Extents2 extents_;
+
+    typedef std::tuple<RFNode::Id, int, int, CoverageType, unsigned int>
+        CacheKey;
+    typedef std::map<CacheKey, CoverageMask> Cache;
+
+    /** Maximum number of cached masks, cache is dropped when full.
+     */
+    static constexpr std::size_t MaxCachedMasks = 512;
+
+    mutable std::mutex cacheMutex_;
+    mutable Cache cache_;
 };
 
 bool RFTreeSubtree::initSampler() const
@@ -367,6 +402,21 @@ NodeInfo::coverageMask(CoverageType type, const math::Size2 &size
     return subtree_.coverageMask(type, size, dilation, node_);
 }
 
+NodeInfo::CoverageMask
+NodeInfo::sampledCoverageMask(CoverageType type, const math::Size2 &size
+                              , unsigned int dilation) const
+{
+    if (!valid()) {
+        return CoverageMask(size, CoverageMask::InitMode::EMPTY);
+    }
+
+    if (!partial_) {
+        return CoverageMask(size, CoverageMask::InitMode::FULL);
+    }
+
+    return subtree_.sampledCoverageMask(type, size, dilation, node_);
+}
+
 RFTreeSubtree::CoverageMask
 RFTreeSubtree::coverageMask(CoverageType type, const math::Size2 &size
                             , unsigned int dilation, const RFNode &node) const
@@ -376,31 +426,339 @@ RFTreeSubtree::coverageMask(CoverageType type, const math::Size2 &size
         return CoverageMask(size, CoverageMask::InitMode::FULL);
     }
 
+    return sampler_->coverageMask(type, size, dilation, node);
+}
+
+RFTreeSubtree::CoverageMask
+RFTreeSubtree::sampledCoverageMask(CoverageType type, const math::Size2 &size
+                                   , unsigned int dilation
+                                   , const RFNode &node) const
+{
+    if (!initSampler()) {
+        // no sampler -> no constraints -> full mask
+        return CoverageMask(size, CoverageMask::InitMode::FULL);
+    }
+
+    return sampler_->sampled(type, size, dilation, node);
+}
+
+namespace {
+
+/** Returns extents of sample grid of node's coverage mask.
+ */
+math::Extents2 maskGrid(RFTreeSubtree::CoverageType type
+                        , const math::Size2 &size
+                        , const math::Extents2 &extents)
+{
+    // grid coordinates: leave extents
+    if (type == RFTreeSubtree::CoverageType::grid) { return extents; }
+
+    // pixel coordinates: move one half pixel inside
+    auto grid(extents);
+    auto s(math::size(extents));
+    math::Size2f hps(s.width / (2.0 * size.width)
+                     , s.height / (2.0 * size.height));
+    grid.ll(0) += hps.width;
+    grid.ll(1) += hps.height;
+    grid.ur(0) -= hps.width;
+    grid.ur(1) -= hps.height;
+    return grid;
+}
+
+} // namespace
+
+RFTreeSubtree::CoverageMask
+RFTreeSubtree::Sampler::coverageMask(CoverageType type, const math::Size2 &size
+                                     , unsigned int dilation
+                                     , const RFNode &node) const
+{
+    const CacheKey key(node.id, size.width, size.height, type, dilation);
+
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex_);
+        auto fcache(cache_.find(key));
+        if (fcache != cache_.end()) { return fcache->second; }
+    }
+
+    auto mask(generate(type, size, dilation, node));
+
+    std::lock_guard<std::mutex> lock(cacheMutex_);
+    if (cache_.size() >= MaxCachedMasks) { cache_.clear(); }
+    cache_.insert(Cache::value_type(key, mask));
+    return mask;
+}
+
+/** Rasterizes valid area (i.e. constraint extents converted to node's SRS)
+ *  into sample grid. Boundary of valid area is traced as a polygon in grid
+ *  coordinates and scan-converted; samples near the boundary are then
+ *  re-sampled exactly to get the same result as sampling whole grid.
+ *
+ *  Grid point (i, j) is located at (ref(0) + i * ps.width, ref(1) - j *
+ *  ps.height) in node's SRS.
+ */
+class RFTreeSubtree::Sampler::Rasterizer {
+public:
+    Rasterizer(const Sampler &sampler, const math::Point2 &ref
+               , const math::Size2f &ps, int width, int height)
+        : sampler_(sampler), ref_(ref), ps_(ps)
+        , width_(width), height_(height)
+        , gridBox_(-1.0, -1.0, width, height)
+    {}
+
+    /** Returns false if valid area boundary cannot be traced (conversion
+     *  error). Caller must sample whole grid in such case.
+     */
+    bool run(std::vector<std::uint8_t> &samples);
+
+private:
+    math::Point2 toGrid(const math::Point2 &p) const {
+        const auto g(sampler_.inv_(p));
+        return { (g(0) - ref_(0)) / ps_.width
+                , (ref_(1) - g(1)) / ps_.height };
+    }
+
+    math::Point2 fromGrid(int i, int j) const {
+        return { ref_(0) + i * ps_.width, ref_(1) - j * ps_.height };
+    }
+
+    void trace(const math::Point2 &a, const math::Point2 &b
+               , const math::Point2 &ga, const math::Point2 &gb, int depth);
+
+    const Sampler &sampler_;
+    const math::Point2 ref_;
+    const math::Size2f ps_;
+    const int width_;
+    const int height_;
+    const math::Extents2 gridBox_;
+
+    /** Traced boundary polygon in grid coordinates.
+     */
+    std::vector<math::Point2> polygon_;
+};
+
+void RFTreeSubtree::Sampler::Rasterizer::trace(const math::Point2 &a
+                                               , const math::Point2 &b
+                                               , const math::Point2 &ga
+                                               , const math::Point2 &gb
+                                               , int depth)
+{
+    const math::Point2 m(0.5 * (a + b));
+    const auto gm(toGrid(m));
+    if (!std::isfinite(gm(0)) || !std::isfinite(gm(1))) {
+        throw std::domain_error("Non-finite boundary point.");
+    }
+
+    // deviation of curve from chord (in pixels)
+    const auto deviation(boost::numeric::ublas::norm_2(gm - 0.5 * (ga + gb)));
+
+    // segment's bounding box enlarged by deviation and one pixel
+    const auto margin(deviation + 1.0);
+    const math::Extents2 box
+        (std::min({ ga(0), gb(0), gm(0) }) - margin
+         , std::min({ ga(1), gb(1), gm(1) }) - margin
+         , std::max({ ga(0), gb(0), gm(0) }) + margin
+         , std::max({ ga(1), gb(1), gm(1) }) + margin);
+
+    if ((box.ur(0) < gridBox_.ll(0)) || (box.ll(0) > gridBox_.ur(0))
+        || (box.ur(1) < gridBox_.ll(1)) || (box.ll(1) > gridBox_.ur(1)))
+    {
+        // far from grid, coarse segment is fine here
+        polygon_.push_back(ga);
+        return;
+    }
+
+    const auto length(boost::numeric::ublas::norm_2(gb - ga));
+    if (!depth || ((length <= 1.0) && (deviation <= 0.25))) {
+        polygon_.push_back(ga);
+        return;
+    }
+
+    trace(a, m, ga, gm, depth - 1);
+    trace(m, b, gm, gb, depth - 1);
+}
+
+bool RFTreeSubtree::Sampler::Rasterizer::run(std::vector<std::uint8_t>
+                                             &samples)
+{
+    // trace valid area boundary
+    try {
+        const auto &e(sampler_.extents_);
+        const math::Point2 corners[4] = {
+            ll(e), lr(e), ur(e), ul(e)
+        };
+
+        math::Point2 gcorners[4];
+        for (int i(0); i < 4; ++i) {
+            gcorners[i] = toGrid(corners[i]);
+            if (!std::isfinite(gcorners[i](0))
+                || !std::isfinite(gcorners[i](1)))
+            {
+                return false;
+            }
+        }
+
+        for (int i(0); i < 4; ++i) {
+            const int n((i + 1) % 4);
+            trace(corners[i], corners[n], gcorners[i], gcorners[n], 48);
+        }
+    } catch (const std::exception &e) {
+        LOG(debug) << "Unable to trace valid area boundary (" << e.what()
+                   << "), sampling whole grid.";
+        return false;
+    }
+
+    const auto edges(polygon_.size());
+
+    // scan-convert polygon (even-odd rule), sample points are at integral
+    // grid coordinates
+    std::vector<double> crossings;
+    for (int j(0); j < height_; ++j) {
+        crossings.clear();
+        for (std::size_t e(0); e < edges; ++e) {
+            const auto &p1(polygon_[e]);
+            const auto &p2(polygon_[(e + 1) % edges]);
+            if ((p1(1) <= j) == (p2(1) <= j)) { continue; }
+            crossings.push_back
+                (p1(0) + (j - p1(1)) * (p2(0) - p1(0)) / (p2(1) - p1(1)));
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        auto *row(&samples[j * width_]);
+        for (std::size_t c(0); (c + 1) < crossings.size(); c += 2) {
+            const int start(std::max
+                            (0.0, std::ceil(crossings[c])));
+            const int end(std::min
+                          (double(width_), std::ceil(crossings[c + 1])));
+            for (int i(start); i < end; ++i) { row[i] = true; }
+        }
+    }
+
+    // re-sample points along the boundary exactly
+    std::vector<std::uint8_t> band(samples.size(), false);
+    for (std::size_t e(0); e < edges; ++e) {
+        const auto &p1(polygon_[e]);
+        const auto &p2(polygon_[(e + 1) % edges]);
+
+        const int ie(std::min(width_ - 1.0
+                              , std::ceil(std::max(p1(0), p2(0))) + 1));
+        const int je(std::min(height_ - 1.0
+                              , std::ceil(std::max(p1(1), p2(1))) + 1));
+        for (int j(std::max(0.0, std::floor(std::min(p1(1), p2(1))) - 1));
+             j <= je; ++j)
+        {
+            for (int i(std::max(0.0, std::floor(std::min(p1(0), p2(0))) - 1));
+                 i <= ie; ++i)
+            {
+                band[j * width_ + i] = true;
+            }
+        }
+    }
+
+    for (int j(0), gp(0); j < height_; ++j) {
+        for (int i(0); i < width_; ++i, ++gp) {
+            if (band[gp]) { samples[gp] = sampler_.inside(fromGrid(i, j)); }
+        }
+    }
+
+    return true;
+}
+
+RFTreeSubtree::CoverageMask
+RFTreeSubtree::Sampler::generate(CoverageType type, const math::Size2 &size
+                                 , unsigned int dilation, const RFNode &node)
+    const
+{
     // extents to process
-    const auto grid([&]() -> math::Extents2
+    const auto grid(maskGrid(type, size, node.extents));
+
+    // get grid size and calculate pixel size (i.e. step)
+    const auto gs(math::size(grid));
+    math::Size2f ps(gs.width / (size.width - 1)
+                    , gs.height / (size.height - 1));
+
+    // sampled grid is enlarged by dilation on each side
+    const int d(dilation);
+    const int width(size.width + 2 * d);
+    const int height(size.height + 2 * d);
+    const math::Point2 ref(ul(grid)(0) - d * ps.width
+                           , ul(grid)(1) + d * ps.height);
+
+    // NB: we cannot use OpenCV here, this is core lib functionality
+    std::vector<std::uint8_t> samples(width * height, false);
+
+    Rasterizer rasterizer(*this, ref, ps, width, height);
+    if (!rasterizer.run(samples)) {
+        // fallback: sample whole grid
+        for (int j(0), gp(0); j < height; ++j) {
+            const double y(ref(1) - j * ps.height);
+            for (int i(0); i < width; ++i, ++gp) {
+                samples[gp] = inside(math::Point2(ref(0) + i * ps.width, y));
+            }
+        }
+    }
+
+    // separable dilation (box filter of size 2 * d + 1) using running counts
+    std::vector<std::uint8_t> pane(area(size), false);
     {
-        // grid coordinates: leave extents
-        if (type == CoverageType::grid) { return node.extents; }
-
-        // pixel coordinates: move one half pixel inside
-        auto grid(node.extents);
-        auto s(math::size(node.extents));
-        math::Size2f hps(s.width / (2.0 * size.width)
-                         , s.height / (2.0 * size.height));
-        grid.ll(0) += hps.width;
-        grid.ll(1) += hps.height;
-        grid.ur(0) -= hps.width;
-        grid.ur(1) -= hps.height;
-        return grid;
-    }());
+        // horizontal pass: height x size.width
+        std::vector<std::uint8_t> tmp(height * size.width, false);
+        for (int j(0); j < height; ++j) {
+            const auto *src(&samples[j * width]);
+            auto *dst(&tmp[j * size.width]);
+            int count(0);
+            for (int i(0); i < 2 * d; ++i) { count += src[i]; }
+            for (int i(0); i < size.width; ++i) {
+                count += src[i + 2 * d];
+                dst[i] = (count > 0);
+                count -= src[i];
+            }
+        }
 
+        // vertical pass: size.height x size.width
+        std::vector<int> counts(size.width, 0);
+        for (int j(0); j < 2 * d; ++j) {
+            const auto *src(&tmp[j * size.width]);
+            for (int i(0); i < size.width; ++i) { counts[i] += src[i]; }
+        }
+        for (int j(0); j < size.height; ++j) {
+            const auto *add(&tmp[(j + 2 * d) * size.width]);
+            const auto *sub(&tmp[j * size.width]);
+            auto *dst(&pane[j * size.width]);
+            for (int i(0); i < size.width; ++i) {
+                counts[i] += add[i];
+                dst[i] = (counts[i] > 0);
+                counts[i] -= sub[i];
+            }
+        }
+    }
+
+    // build mask by touching the smaller set of pixels
+    const auto white(std::count(pane.begin(), pane.end(), true));
+    const bool fill(std::size_t(2 * white) > pane.size());
+
+    CoverageMask mask(size, (fill ? CoverageMask::InitMode::FULL
+                             : CoverageMask::InitMode::EMPTY));
+    for (int j(0), gp(0); j < size.height; ++j) {
+        for (int i(0); i < size.width; ++i, ++gp) {
+            if (bool(pane[gp]) != fill) { mask.set(i, j, !fill); }
+        }
+    }
+
+    return mask;
+}
+
+RFTreeSubtree::CoverageMask
+RFTreeSubtree::Sampler::sampled(CoverageType type, const math::Size2 &size
+                                , unsigned int dilation, const RFNode &node)
+    const
+{
     // get grid size and calculate pixel size (i.e. step)
+    const auto grid(maskGrid(type, size, node.extents));
     const auto gs(math::size(grid));
     math::Size2f ps(gs.width / (size.width - 1)
                     , gs.height / (size.height - 1));
     const auto ref(ul(grid));
 
-    // NB: we cannot use OpenCV here, this is core lib functionality
     std::vector<std::uint8_t> pane(area(size), false);
 
     auto clip([](int v, int limit) -> int
@@ -410,28 +768,22 @@ RFTreeSubtree::coverageMask(CoverageType type, const math::Size2 &size
         return v;
     });
 
-    // sample tile in grid
-    const auto &sampler(*sampler_);
-    for (int j(-dilation), je(size.height + dilation), gp(0); j < je; ++j) {
-        double y(ref(1) - j * ps.height);
-        for (int i(-dilation), ie(size.width + dilation); i < ie; ++i, ++gp) {
-            double x(ref(0) + i * ps.width);
-            if (sampler.inside(math::Point2(x, y))) {
-                if (!dilation) {
-                    pane[gp] = true;
-                }
-
-                // some dilation -> apply
-                for (int jj(clip(j - dilation, size.height - 1))
-                         , jje(clip(j + dilation, size.height - 1))
-                         , gy(jj * size.width);
-                     jj <= jje; ++jj, gy += size.width) {
-                    for (int ii(clip(i - dilation, size.width - 1))
-                             , iie(clip(i + dilation, size.width - 1));
-                         ii <= iie; ++ii)
-                    {
-                        pane[gy + ii] = true;
-                    }
+    // sample every grid point, apply dilation to every valid sample
+    const int d(dilation);
+    for (int j(-d), je(size.height + d); j < je; ++j) {
+        const double y(ref(1) - j * ps.height);
+        for (int i(-d), ie(size.width + d); i < ie; ++i) {
+            if (!inside(math::Point2(ref(0) + i * ps.width, y))) { continue; }
+
+            for (int jj(clip(j - d, size.height - 1))
+                     , jje(clip(j + d, size.height - 1));
+                 jj <= jje; ++jj)
+            {
+                for (int ii(clip(i - d, size.width - 1))
+                         , iie(clip(i + d, size.width - 1));
+                     ii <= iie; ++ii)
+                {
+                    pane[jj * size.width + ii] = true;
                 }
             }
         }
@@ -440,9 +792,7 @@ RFTreeSubtree::coverageMask(CoverageType type, const math::Size2 &size
     CoverageMask mask(size, CoverageMask::InitMode::EMPTY);
     for (int j(0), gp(0); j < size.height; ++j) {
         for (int i(0); i < size.width; ++i, ++gp) {
-            if (pane[gp]) {
-                mask.set(i, j, true);
-            }
+            if (pane[gp]) { mask.set(i, j, true); }
         }
     }
 
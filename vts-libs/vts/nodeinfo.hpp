@@ -74,10 +74,22 @@ public:
      */
     enum class CoverageType { pixel, grid };
 
+    /** Generates coverage mask of given node. Generated masks are cached
+     *  (shared by all copies of this subtree).
+     */
     CoverageMask coverageMask(CoverageType type, const math::Size2 &size
                               , unsigned int dilation, const RFNode &node)
         const;
 
+    /** Generates coverage mask of given node by sampling every grid point.
+     *  Slow reference implementation of coverageMask(), not cached. Use only
+     *  for verification.
+     */
+    CoverageMask sampledCoverageMask(CoverageType type
+                                     , const math::Size2 &size
+                                     , unsigned int dilation
+                                     , const RFNode &node) const;
+
     const registry::Registry& registry() const { return *registry_; }
 
 private:
@@ -173,6 +185,14 @@ public:
     CoverageMask coverageMask(CoverageType type, const math::Size2 &size
                               , unsigned int dilation = 0) const;
 
+    /** Same as coverageMask() but partial node's mask is computed by slow
+     *  reference implementation (every grid point is sampled). Use only for
+     *  verification.
+     */
+    CoverageMask sampledCoverageMask(CoverageType type
+                                     , const math::Size2 &size
+                                     , unsigned int dilation = 0) const;
+
     /** Queries whether given point is inside node's valid area.  Point must be
      *  in node's SRS. Performs extra check to extents in parents SRS in case of
      *  partial node.
@@ -23,7 +23,10 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <algorithm>
+
 #include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
 
 #include "dbglog/dbglog.hpp"
 
@@ -72,6 +75,79 @@ cv::Mat jpeg2mat(const std::vector<unsigned char> &buf
     return image;
 }
 
+/** Encodes image with the lowest quality meeting adaptive quality target.
+ */
+std::vector<unsigned char> mat2jpeg(const cv::Mat &mat
+                                    , const AdaptiveQuality &aq)
+{
+    const int minQuality(std::max(1, std::min(aq.minQuality, aq.maxQuality)));
+    const int maxQuality(std::min(100, std::max(aq.minQuality
+                                                , aq.maxQuality)));
+
+    // PSNR is computed against decoded color image, make color reference
+    cv::Mat reference;
+    switch (mat.type()) {
+    case CV_8UC3: reference = mat; break;
+    case CV_8UC1: cv::cvtColor(mat, reference, cv::COLOR_GRAY2BGR); break;
+    case CV_8UC4: cv::cvtColor(mat, reference, cv::COLOR_BGRA2BGR); break;
+
+    default:
+        LOG(warn2) << "Adaptive quality not available for texture of type "
+                   << mat.type() << "; encoding " << mat.cols << "x"
+                   << mat.rows << " texture with maximum quality "
+                   << maxQuality << ".";
+        return mat2jpeg(mat, maxQuality);
+    }
+
+    std::vector<unsigned char> best;
+    int quality(maxQuality);
+    double psnr(0.0);
+    int passes(0);
+
+    // bisect quality range
+    for (int lo(minQuality), hi(maxQuality);
+         (lo <= hi) && (passes < aq.maxPasses); ++passes)
+    {
+        const int q((lo + hi) / 2);
+        auto buf(mat2jpeg(mat, q));
+        const auto p(cv::PSNR(reference, jpeg2mat(buf)));
+
+        if (p >= aq.targetPsnr) {
+            // good enough, try lower quality
+            best.swap(buf);
+            quality = q;
+            psnr = p;
+            hi = q - 1;
+        } else {
+            lo = q + 1;
+        }
+    }
+
+    if (best.empty()) {
+        // target not met, use maximum quality
+        quality = maxQuality;
+        best = mat2jpeg(mat, quality);
+        psnr = cv::PSNR(reference, jpeg2mat(best));
+        ++passes;
+    }
+
+    LOG(debug) << "Encoded " << mat.cols << "x" << mat.rows
+               << " texture with quality " << quality
+               << " (PSNR " << psnr << " dB, " << passes << " passes).";
+
+    if (aq.report) { aq.report->add(quality, psnr, passes, best.size()); }
+
+    return best;
+}
+
+std::vector<unsigned char>
+mat2jpeg(const cv::Mat &mat, int quality
+         , const boost::optional<AdaptiveQuality> &adaptiveQuality)
+{
+    if (adaptiveQuality) { return mat2jpeg(mat, *adaptiveQuality); }
+    return mat2jpeg(mat, quality);
+}
+
 } // namespace
 
 multifile::Table Atlas::serialize_impl(std::ostream &os) const
@@ -81,7 +157,7 @@ multifile::Table Atlas::serialize_impl(std::ostream &os) const
 
     for (const auto &image : images_) {
         using utility::binaryio::write;
-        auto buf(mat2jpeg(image, quality_));
+        auto buf(mat2jpeg(image, quality_, adaptiveQuality_));
         write(os, buf.data(), buf.size());
         pos = table.add(pos, buf.size());
     }
@@ -226,7 +302,7 @@ multifile::Table HybridAtlas::serialize_impl(std::ostream &os) const
     for (const auto &entry : entries_) {
         using utility::binaryio::write;
         if (entry.image.data) {
-            auto buf(mat2jpeg(entry.image, quality_));
+            auto buf(mat2jpeg(entry.image, quality_, adaptiveQuality_));
             write(os, buf.data(), buf.size());
             pos = table.add(pos, buf.size());
         } else {
@@ -26,9 +26,12 @@
 #ifndef vtslibs_vts_opencv_atlas_hpp
 #define vtslibs_vts_opencv_atlas_hpp
 
+#include <boost/optional.hpp>
+
 #include <opencv2/core/core.hpp>
 
 #include "../atlas.hpp"
+#include "../texturequality.hpp"
 
 namespace vtslibs { namespace vts { namespace opencv {
 
@@ -61,6 +64,16 @@ public:
 
     int quality() const { return quality_; }
 
+    /** Encode images with adaptive quality instead of fixed one.
+     */
+    void adaptiveQuality(const boost::optional<AdaptiveQuality> &value) {
+        adaptiveQuality_ = value;
+    }
+
+    const boost::optional<AdaptiveQuality>& adaptiveQuality() const {
+        return adaptiveQuality_;
+    }
+
 private:
     virtual multifile::Table serialize_impl(std::ostream &os) const;
 
@@ -71,6 +84,7 @@ private:
     virtual math::Size2 imageSize_impl(std::size_t index) const;
 
     int quality_;
+    boost::optional<AdaptiveQuality> adaptiveQuality_;
     Images images_;
 };
 
@@ -89,7 +103,10 @@ public:
      */
     HybridAtlas(const Atlas &atlas, int textureQuality = 100);
 
-    HybridAtlas(const opencv::Atlas &atlas) : quality_(atlas.quality()) {
+    HybridAtlas(const opencv::Atlas &atlas)
+        : quality_(atlas.quality())
+        , adaptiveQuality_(atlas.adaptiveQuality())
+    {
         append(atlas);
     }
 
@@ -127,6 +144,17 @@ public:
     static Image imageFromRaw(const Raw &raw);
     static Raw rawFromImage(const Image &image, int quality);
 
+    /** Encode newly added images with adaptive quality instead of fixed one.
+     *  Raw entries are kept intact.
+     */
+    void adaptiveQuality(const boost::optional<AdaptiveQuality> &value) {
+        adaptiveQuality_ = value;
+    }
+
+    const boost::optional<AdaptiveQuality>& adaptiveQuality() const {
+        return adaptiveQuality_;
+    }
+
 private:
     virtual multifile::Table serialize_impl(std::ostream &os) const;
 
@@ -137,6 +165,7 @@ private:
     virtual math::Size2 imageSize_impl(std::size_t index) const;
 
     int quality_;
+    boost::optional<AdaptiveQuality> adaptiveQuality_;
 
     /** "union" of raw data and color image
      *  Either blob is non-empty or image.data is valid
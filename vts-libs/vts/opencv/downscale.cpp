@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "./atlas.hpp"
+
+namespace vtslibs { namespace vts {
+
+// actual implementation
+Atlas::pointer downscale(const Atlas &atlas, int factor
+                         , int textureQuality)
+{
+    opencv::Atlas in(atlas, textureQuality);
+
+    auto out(std::make_shared<opencv::Atlas>(textureQuality));
+
+    for (const auto &image : in.get()) {
+        if (factor <= 1) {
+            out->add(image);
+            continue;
+        }
+
+        // round up to keep at least one pixel; whole image is resized so
+        // normalized texture coordinates keep pointing to the same texels
+        const cv::Size size((image.cols + factor - 1) / factor
+                            , (image.rows + factor - 1) / factor);
+
+        cv::Mat small;
+        cv::resize(image, small, size, 0.0, 0.0, cv::INTER_AREA);
+        out->add(small);
+    }
+
+    return out;
+}
+
+} } // namespace vtslibs::vts
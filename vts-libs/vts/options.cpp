@@ -44,6 +44,39 @@ void OpenOptions::configuration(po::options_description &od
          , po::value(&ioWait_)->default_value(ioWait_)
          , "Timeout for I/O operations [in ms] "
          "(-1 means infinity retries).")
+        ((prefix + "io.deadline").c_str()
+         , po::value(&ioDeadline_)->default_value(ioDeadline_)
+         , "Overall time budget for I/O operation including all retries "
+         "[in ms] (-1 means no deadline).")
+        ((prefix + "io.backoff").c_str()
+         , po::value(&ioBackoff_)->default_value(ioBackoff_)
+         , "Delay between retries [in ms].")
+        ((prefix + "io.backoffMax").c_str()
+         , po::value(&ioBackoffMax_)->default_value(ioBackoffMax_)
+         , "Maximal delay between retries [in ms]. When greater than "
+         "io.backoff the delay grows exponentially with random jitter up "
+         "to this value (0 means fixed delay).")
+        ((prefix + "io.hedge").c_str()
+         , po::value(&ioHedge_)->default_value(ioHedge_)
+         , "Send second (hedged) request when first one takes longer "
+         "than given latency percentile of the host (0 means no hedging).")
+        ((prefix + "io.breaker").c_str()
+         , po::value(&ioBreaker_)->default_value(ioBreaker_)
+         , "Number of consecutive failures after which requests to given "
+         "host fail immediately (0 means no circuit breaking).")
+        ((prefix + "io.breakerCooldown").c_str()
+         , po::value(&ioBreakerCooldown_)
+         ->default_value(ioBreakerCooldown_)
+         , "Time for which requests to failing host fail "
+         "immediately [in ms].")
+        ((prefix + "atlas.variantQuality").c_str()
+         , po::value(&atlasVariantQuality_)
+         ->default_value(atlasVariantQuality_)
+         , "JPEG quality of reduced-resolution atlas variants.")
+        ((prefix + "atlas.variantCache").c_str()
+         , po::value(&atlasVariantCache_)
+         ->default_value(atlasVariantCache_)
+         , "Size of reduced-resolution atlas variant cache [in MB].")
         ((prefix + "cname").c_str()
          , po::value<std::vector<std::string>>()
          , "CName mimicking for hostnames in remote tileset URLs. "
@@ -75,7 +108,15 @@ std::ostream& OpenOptions::dump(std::ostream &os, const std::string &prefix)
     const
 {
     os << prefix << "io.retries = " << ioRetries_ << '\n'
-       << prefix << "io.wait = " << ioWait_ << '\n';
+       << prefix << "io.wait = " << ioWait_ << '\n'
+       << prefix << "io.deadline = " << ioDeadline_ << '\n'
+       << prefix << "io.backoff = " << ioBackoff_ << '\n'
+       << prefix << "io.backoffMax = " << ioBackoffMax_ << '\n'
+       << prefix << "io.hedge = " << ioHedge_ << '\n'
+       << prefix << "io.breaker = " << ioBreaker_ << '\n'
+       << prefix << "io.breakerCooldown = " << ioBreakerCooldown_ << '\n'
+       << prefix << "atlas.variantQuality = " << atlasVariantQuality_ << '\n'
+       << prefix << "atlas.variantCache = " << atlasVariantCache_ << '\n';
 
     for (const auto &item : cnames_) {
         os << prefix << "cname = " << item.first
@@ -37,16 +37,22 @@
 #include <iostream>
 
 #include <boost/optional.hpp>
+#include <boost/filesystem/path.hpp>
 #include <boost/program_options.hpp>
 
 #include "./basetypes.hpp"
 #include "./tileindex.hpp"
+#include "./texturequality.hpp"
+#include "./spatialfilter.hpp"
 
 namespace vtslibs { namespace vts {
 
 // fwd declaration; include metatile.hpp if MetaNode is needed.
 struct MetaNode;
 
+// fwd declaration; include gluegenerator.hpp if GlueGenerator is needed.
+class GlueGenerator;
+
 /** Tileset open options.
  *
  *  Available options:
@@ -57,7 +63,16 @@ public:
     OpenOptions()
         : ioRetries_(-1) // infinity
         , ioWait_(-1) // infinity
+        , ioDeadline_(-1) // infinity
+        , ioBackoff_(1000)
+        , ioBackoffMax_(0) // fixed delay
+        , ioHedge_(0) // no hedging
+        , ioBreaker_(0) // no circuit breaking
+        , ioBreakerCooldown_(5000)
         , scarceMemory_(false)
+        , atlasVariantQuality_(75)
+        , atlasVariantCache_(64)
+        , openMode_(OpenMode::readOnly)
     {}
 
     typedef std::map<std::string, std::string> CNames;
@@ -80,11 +95,64 @@ public:
         ioWait_ = ioWait; return *this;
     }
 
+    long ioDeadline() const { return ioDeadline_; }
+    OpenOptions& ioDeadline(long ioDeadline) {
+        ioDeadline_ = ioDeadline; return *this;
+    }
+
+    long ioBackoff() const { return ioBackoff_; }
+    OpenOptions& ioBackoff(long ioBackoff) {
+        ioBackoff_ = ioBackoff; return *this;
+    }
+
+    long ioBackoffMax() const { return ioBackoffMax_; }
+    OpenOptions& ioBackoffMax(long ioBackoffMax) {
+        ioBackoffMax_ = ioBackoffMax; return *this;
+    }
+
+    int ioHedge() const { return ioHedge_; }
+    OpenOptions& ioHedge(int ioHedge) {
+        ioHedge_ = ioHedge; return *this;
+    }
+
+    int ioBreaker() const { return ioBreaker_; }
+    OpenOptions& ioBreaker(int ioBreaker) {
+        ioBreaker_ = ioBreaker; return *this;
+    }
+
+    long ioBreakerCooldown() const { return ioBreakerCooldown_; }
+    OpenOptions& ioBreakerCooldown(long ioBreakerCooldown) {
+        ioBreakerCooldown_ = ioBreakerCooldown; return *this;
+    }
+
     bool scarceMemory() const { return scarceMemory_; }
     OpenOptions& scarceMemory(bool scarceMemory) {
         scarceMemory_ = scarceMemory; return *this;
     }
 
+    int atlasVariantQuality() const { return atlasVariantQuality_; }
+    OpenOptions& atlasVariantQuality(int atlasVariantQuality) {
+        atlasVariantQuality_ = atlasVariantQuality; return *this;
+    }
+
+    std::size_t atlasVariantCache() const { return atlasVariantCache_; }
+    OpenOptions& atlasVariantCache(std::size_t atlasVariantCache) {
+        atlasVariantCache_ = atlasVariantCache; return *this;
+    }
+
+    OpenMode openMode() const { return openMode_; }
+    OpenOptions& openMode(OpenMode openMode) {
+        openMode_ = openMode; return *this;
+    }
+
+    const std::shared_ptr<GlueGenerator>& glueGenerator() const {
+        return glueGenerator_;
+    }
+    OpenOptions&
+    glueGenerator(const std::shared_ptr<GlueGenerator> &glueGenerator) {
+        glueGenerator_ = glueGenerator; return *this;
+    }
+
     void configuration(boost::program_options::options_description &od
                        , const std::string &prefix = "");
 
@@ -106,9 +174,60 @@ private:
      */
     long ioWait_;
 
+    /** Overall time budget in ms for one IO operation including all
+     *  retries. Interpreted by remote driver.
+     */
+    long ioDeadline_;
+
+    /** Delay in ms between retries. Interpreted by remote driver.
+     */
+    long ioBackoff_;
+
+    /** Maximal delay in ms between retries. If greater than ioBackoff_ the
+     *  delay grows exponentially (with random jitter) with each failed
+     *  attempt up to this value; otherwise the delay is fixed.
+     */
+    long ioBackoffMax_;
+
+    /** Latency percentile (1-99) of given host after which hedged (second)
+     *  request is sent. 0 disables hedging. Interpreted by remote driver.
+     */
+    int ioHedge_;
+
+    /** Number of consecutive failures after which requests to the failing
+     *  host fail immediately for ioBreakerCooldown_ ms. 0 disables circuit
+     *  breaking. Interpreted by remote driver.
+     */
+    int ioBreaker_;
+
+    /** Time in ms the circuit breaker stays open.
+     */
+    long ioBreakerCooldown_;
+
     /** We are (or do not want to be) running out of memory.
      */
     bool scarceMemory_;
+
+    /** JPEG quality of reduced-resolution atlas variants. Interpreted by
+     *  delivery.
+     */
+    int atlasVariantQuality_;
+
+    /** Size (in MB) of in-memory cache of generated reduced-resolution atlas
+     *  variants. Interpreted by delivery.
+     */
+    std::size_t atlasVariantCache_;
+
+    /** Open existing tileset for in-place update (readWrite). Supported only
+     *  by the plain driver.
+     */
+    OpenMode openMode_;
+
+    /** Generates pending glues on demand. Interpreted by in-memory
+     *  aggregated driver: pending glues do not prevent aggregation, their
+     *  content is generated when first accessed.
+     */
+    std::shared_ptr<GlueGenerator> glueGenerator_;
 };
 
 /** Tilset clone options. Sometimes used for tileset creation.
@@ -135,6 +254,12 @@ private:
  *                See configuration of given tileset/driver.
  *
  *    * openOptions: open time options
+ *
+ *    * contentStore: content-addressed store used by newly created plain
+ *                    tilesets to deduplicate tile files (optional)
+ *
+ *    * adaptiveQuality: encode repacked textures with adaptive JPEG quality
+ *                       instead of fixed textureQuality (optional)
  */
 class CloneOptions {
 public:
@@ -185,6 +310,7 @@ public:
              *  v*->v4: generate geomExtents from mesh/navtiles(surrogate)
              */
             , meta = 0x4
+            , repack = 0x8 // repack atlases to used texture area only
         };
     };
 
@@ -209,6 +335,30 @@ public:
         textureQuality_ = value; return *this;
     }
 
+    const boost::optional<boost::filesystem::path>& contentStore() const {
+        return contentStore_;
+    }
+    CloneOptions&
+    contentStore(const boost::optional<boost::filesystem::path> &value) {
+        contentStore_ = value; return *this;
+    }
+
+    const boost::optional<AdaptiveQuality>& adaptiveQuality() const {
+        return adaptiveQuality_;
+    }
+    CloneOptions&
+    adaptiveQuality(const boost::optional<AdaptiveQuality> &value) {
+        adaptiveQuality_ = value; return *this;
+    }
+
+    const boost::optional<SpatialFilter>& spatialFilter() const {
+        return spatialFilter_;
+    }
+    CloneOptions&
+    spatialFilter(const boost::optional<SpatialFilter> &value) {
+        spatialFilter_ = value; return *this;
+    }
+
 private:
     CreateMode mode_;
     boost::optional<std::string> tilesetId_;
@@ -222,6 +372,13 @@ private:
     /** Texture quality (used only when inpainting)
      */
     int textureQuality_;
+
+    boost::optional<boost::filesystem::path> contentStore_;
+    boost::optional<AdaptiveQuality> adaptiveQuality_;
+
+    /** Only tiles inside this area are cloned.
+     */
+    boost::optional<SpatialFilter> spatialFilter_;
 };
 
 class RelocateOptions {
@@ -283,6 +440,11 @@ struct GlueCreationOptions {
      */
     int textureQuality;
 
+    /** Encode glue textures with adaptive JPEG quality instead of fixed
+     *  textureQuality. Used only when textureQuality is non-zero.
+     */
+    boost::optional<AdaptiveQuality> adaptiveQuality;
+
     /** Clip meshes based on merge coverage.
      */
     bool clip;
@@ -307,7 +469,7 @@ class ReencodeOptions {
 public:
     ReencodeOptions()
         : encodeFlags(), dryRun(false), cleanup(false)
-        , descend(true)
+        , descend(true), textureQuality(70)
     {}
 
     CloneOptions::EncodeFlag::value_type encodeFlags;
@@ -315,6 +477,31 @@ public:
     bool cleanup;
     std::string tag;
     bool descend;
+
+    /** JPEG quality of inpainted/repacked textures.
+     */
+    int textureQuality;
+
+    /** Encode repacked textures with adaptive JPEG quality.
+     */
+    boost::optional<AdaptiveQuality> adaptiveQuality;
+};
+
+class RecoverIndexOptions {
+public:
+    RecoverIndexOptions()
+        : dryRun(false), meshFlags(false)
+    {}
+
+    /** Do not write recovered tile index.
+     */
+    bool dryRun;
+
+    /** Read coverage mask and submesh count of every mesh to recover
+     *  watertight and multimesh flags (these are not stored in metatiles).
+     *  Mesh geometry is not decoded.
+     */
+    bool meshFlags;
 };
 
 // inlines
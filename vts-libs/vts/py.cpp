@@ -0,0 +1,595 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/py.cpp
+ *
+ * Python module providing batched read-only access to tilesets and storages.
+ *
+ * All tile data are returned as NumPy arrays that take ownership of buffers
+ * filled on the C++ side, i.e. one array per batch, no per-tile objects. GIL
+ * is released while reading and decoding the data.
+ *
+ * Usage:
+ *
+ *     import vtslibs
+ *     ts = vtslibs.openTileSet("/path/to/tileset")
+ *     ids, flags = ts.tiles(vtslibs.TileFlags.mesh)
+ *     meshes = ts.meshes(ids[:1000])
+ */
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+#include <boost/python.hpp>
+#include <boost/python/numpy.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "pysupport/string.hpp"
+
+#include "../vts.hpp"
+#include "./tileset/driver.hpp"
+#include "./opencv/navtile.hpp"
+
+namespace python = boost::python;
+namespace np = boost::python::numpy;
+namespace fs = boost::filesystem;
+
+namespace vtslibs { namespace vts { namespace py {
+
+using pysupport::py2utf8;
+
+namespace {
+
+/** Releases GIL for the lifetime of this object.
+ */
+class GilRelease {
+public:
+    GilRelease() : state_(::PyEval_SaveThread()) {}
+    ~GilRelease() { ::PyEval_RestoreThread(state_); }
+
+private:
+    GilRelease(const GilRelease&) = delete;
+    GilRelease& operator=(const GilRelease&) = delete;
+
+    ::PyThreadState *state_;
+};
+
+template <typename T>
+void destroyBuffer(::PyObject *capsule)
+{
+    delete static_cast<std::vector<T>*>
+        (::PyCapsule_GetPointer(capsule, nullptr));
+}
+
+/** Wraps buffer into NumPy array without copying. Array takes ownership of the
+ *  buffer. Array is C-contiguous with given shape.
+ */
+template <typename T>
+np::ndarray asArray(std::vector<T> &&data, const std::vector<long> &shape)
+{
+    auto *buffer(new std::vector<T>(std::move(data)));
+    python::object owner
+        (python::handle<>(::PyCapsule_New(buffer, nullptr
+                                          , &destroyBuffer<T>)));
+
+    python::list pshape, pstrides;
+    long stride(sizeof(T));
+    std::vector<long> strides(shape.size());
+    for (auto i(shape.size()); i--; ) {
+        strides[i] = stride;
+        stride *= shape[i];
+    }
+    for (std::size_t i(0); i != shape.size(); ++i) {
+        pshape.append(shape[i]);
+        pstrides.append(strides[i]);
+    }
+
+    return np::from_data(buffer->data(), np::dtype::get_builtin<T>()
+                         , python::tuple(pshape), python::tuple(pstrides)
+                         , owner);
+}
+
+np::ndarray asArray(std::vector<bool> &&data)
+{
+    std::vector<std::uint8_t> tmp(data.begin(), data.end());
+    return asArray(std::move(tmp), { long(data.size()) })
+        .astype(np::dtype::get_builtin<bool>());
+}
+
+/** Converts any (N, 3) array-like object of (lod, x, y) into list of tile IDs.
+ */
+TileId::list tileIds(const python::object &ids)
+{
+    const auto array
+        (np::from_object(ids, np::dtype::get_builtin<std::uint32_t>(), 2, 2
+                         , np::ndarray::C_CONTIGUOUS));
+    if (array.shape(1) != 3) {
+        LOGTHROW(err1, std::runtime_error)
+            << "Tile IDs must be passed as (N, 3) array of (lod, x, y).";
+    }
+
+    const auto count(array.shape(0));
+    const auto *data
+        (reinterpret_cast<const std::uint32_t*>(array.get_data()));
+
+    TileId::list out;
+    out.reserve(count);
+    for (long i(0); i != count; ++i, data += 3) {
+        out.emplace_back(data[0], data[1], data[2]);
+    }
+    return out;
+}
+
+/** Read-only tileset shared between Python threads.
+ *
+ *  Metatile cache and drivers are not thread safe: metanode lookup and stream
+ *  opening are serialized, data reading and decoding run in parallel.
+ */
+class TileSetReader {
+public:
+    typedef std::shared_ptr<TileSetReader> pointer;
+
+    TileSetReader(const TileSet &ts) : ts_(ts) {}
+
+    std::string id() const { return ts_.id(); }
+
+    python::tuple lodRange() const {
+        const auto lr(ts_.lodRange());
+        return python::make_tuple(lr.min, lr.max);
+    }
+
+    std::string referenceFrame() const { return ts_.referenceFrame().id; }
+
+    python::tuple tiles(TileIndex::Flag::value_type mask) const;
+
+    python::dict meshes(const python::object &ids) const;
+
+    python::dict coverageMasks(const python::object &ids) const;
+
+    python::dict navtiles(const python::object &ids) const;
+
+    python::dict metanodes(const python::object &ids) const;
+
+private:
+    bool has(const TileId &tileId, TileIndex::Flag::value_type flag) const {
+        return ts_.tileIndex().get(tileId) & flag;
+    }
+
+    IStream::pointer input(const TileId &tileId, TileFile type) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ts_.driver().input(tileId, type);
+    }
+
+    boost::optional<MetaNode> metanode(const TileId &tileId) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (const auto *node = ts_.getMetaNode(tileId, std::nothrow)) {
+            return *node;
+        }
+        return boost::none;
+    }
+
+    TileSet ts_;
+    mutable std::mutex mutex_;
+};
+
+python::tuple TileSetReader::tiles(TileIndex::Flag::value_type mask) const
+{
+    std::vector<std::uint32_t> ids;
+    std::vector<std::uint32_t> flags;
+
+    {
+        GilRelease nogil;
+        traverse(ts_.tileIndex(), [&](const TileId &tileId
+                                      , QTree::value_type value)
+        {
+            if (!(value & mask)) { return; }
+            ids.push_back(tileId.lod);
+            ids.push_back(tileId.x);
+            ids.push_back(tileId.y);
+            flags.push_back(value);
+        });
+    }
+
+    const long count(flags.size());
+    return python::make_tuple(asArray(std::move(ids), { count, 3 })
+                              , asArray(std::move(flags), { count }));
+}
+
+python::dict TileSetReader::meshes(const python::object &pids) const
+{
+    const auto ids(tileIds(pids));
+
+    std::vector<bool> valid(ids.size(), false);
+    std::vector<double> vertices;
+    std::vector<double> etc;
+    std::vector<double> tc;
+    std::vector<std::uint32_t> faces;
+    std::vector<std::uint32_t> facesTc;
+
+    // tile, vertexStart, vertexCount, faceStart, faceCount, tcStart, tcCount,
+    // textureMode, textureLayer, surfaceReference
+    const long smColumns(10);
+    std::vector<std::int64_t> submeshes;
+
+    {
+        GilRelease nogil;
+
+        // load all meshes first to be able to allocate output at once
+        std::vector<Mesh> meshes(ids.size());
+        std::size_t vertexCount(0), faceCount(0), tcCount(0), smCount(0);
+        for (std::size_t i(0); i != ids.size(); ++i) {
+            if (!has(ids[i], TileIndex::Flag::mesh)) { continue; }
+
+            auto &mesh(meshes[i]);
+            mesh = loadMesh(input(ids[i], TileFile::mesh));
+            valid[i] = true;
+
+            for (const auto &sm : mesh) {
+                vertexCount += sm.vertices.size();
+                faceCount += sm.faces.size();
+                tcCount += sm.tc.size();
+            }
+            smCount += mesh.submeshes.size();
+        }
+
+        vertices.reserve(3 * vertexCount);
+        etc.reserve(2 * vertexCount);
+        tc.reserve(2 * tcCount);
+        faces.reserve(3 * faceCount);
+        facesTc.reserve(3 * faceCount);
+        submeshes.reserve(smColumns * smCount);
+
+        for (std::size_t i(0); i != ids.size(); ++i) {
+            for (const auto &sm : meshes[i]) {
+                const std::uint32_t vOffset(vertices.size() / 3);
+                const std::uint32_t tOffset(tc.size() / 2);
+
+                submeshes.push_back(i);
+                submeshes.push_back(vOffset);
+                submeshes.push_back(sm.vertices.size());
+                submeshes.push_back(faces.size() / 3);
+                submeshes.push_back(sm.faces.size());
+                submeshes.push_back(tOffset);
+                submeshes.push_back(sm.tc.size());
+                submeshes.push_back
+                    (sm.textureMode == SubMesh::TextureMode::external);
+                submeshes.push_back(sm.textureLayer ? *sm.textureLayer : -1);
+                submeshes.push_back(sm.surfaceReference);
+
+                for (const auto &v : sm.vertices) {
+                    vertices.insert(vertices.end(), { v(0), v(1), v(2) });
+                }
+
+                if (sm.etc.empty()) {
+                    etc.resize(etc.size() + 2 * sm.vertices.size());
+                } else {
+                    for (const auto &t : sm.etc) {
+                        etc.insert(etc.end(), { t(0), t(1) });
+                    }
+                }
+
+                for (const auto &t : sm.tc) {
+                    tc.insert(tc.end(), { t(0), t(1) });
+                }
+
+                for (const auto &f : sm.faces) {
+                    faces.insert(faces.end(), { f(0) + vOffset, f(1) + vOffset
+                                                , f(2) + vOffset });
+                }
+
+                if (sm.facesTc.empty()) {
+                    facesTc.resize(facesTc.size() + 3 * sm.faces.size());
+                } else {
+                    for (const auto &f : sm.facesTc) {
+                        facesTc.insert(facesTc.end()
+                                       , { f(0) + tOffset, f(1) + tOffset
+                                           , f(2) + tOffset });
+                    }
+                }
+            }
+        }
+    }
+
+    const long vc(vertices.size() / 3);
+    const long tcc(tc.size() / 2);
+    const long fc(faces.size() / 3);
+    const long smc(submeshes.size() / smColumns);
+
+    python::dict out;
+    out["valid"] = asArray(std::move(valid));
+    out["vertices"] = asArray(std::move(vertices), { vc, 3 });
+    out["etc"] = asArray(std::move(etc), { vc, 2 });
+    out["tc"] = asArray(std::move(tc), { tcc, 2 });
+    out["faces"] = asArray(std::move(faces), { fc, 3 });
+    out["facesTc"] = asArray(std::move(facesTc), { fc, 3 });
+    out["submeshes"] = asArray(std::move(submeshes), { smc, smColumns });
+    return out;
+}
+
+python::dict TileSetReader::coverageMasks(const python::object &pids) const
+{
+    const auto ids(tileIds(pids));
+    const auto size(Mesh::coverageSize());
+    const std::size_t pixels(size.width * size.height);
+
+    std::vector<bool> valid(ids.size(), false);
+    std::vector<std::uint8_t> masks(ids.size() * pixels, 0);
+
+    {
+        GilRelease nogil;
+
+        for (std::size_t i(0); i != ids.size(); ++i) {
+            if (!has(ids[i], TileIndex::Flag::mesh)) { continue; }
+
+            // only mask is loaded, mesh is not decoded
+            const auto mm(loadMeshMask(input(ids[i], TileFile::mesh)));
+            valid[i] = true;
+
+            auto *mask(&masks[i * pixels]);
+            mm.coverageMask.forEachNode
+                ([&](unsigned int x, unsigned int y, unsigned int xsize
+                     , QTree::value_type)
+            {
+                for (auto j(y), je(y + xsize); j != je; ++j) {
+                    std::memset(mask + j * size.width + x, 1, xsize);
+                }
+            }, QTree::Filter::white);
+        }
+    }
+
+    python::dict out;
+    out["valid"] = asArray(std::move(valid));
+    out["masks"] = asArray(std::move(masks)
+                           , { long(ids.size()), size.height, size.width });
+    return out;
+}
+
+python::dict TileSetReader::navtiles(const python::object &pids) const
+{
+    const auto ids(tileIds(pids));
+    const auto size(NavTile::size());
+    const std::size_t pixels(size.width * size.height);
+
+    std::vector<bool> valid(ids.size(), false);
+    std::vector<float> heights(ids.size() * pixels, 0.f);
+    std::vector<std::uint8_t> masks(ids.size() * pixels, 0);
+
+    {
+        GilRelease nogil;
+
+        for (std::size_t i(0); i != ids.size(); ++i) {
+            if (!has(ids[i], TileIndex::Flag::navtile)) { continue; }
+
+            const auto node(metanode(ids[i]));
+            if (!node) { continue; }
+
+            const auto is(input(ids[i], TileFile::navtile));
+            opencv::NavTile nt;
+            nt.deserialize(node->heightRange, is->get(), is->name());
+            valid[i] = true;
+
+            // copy heights row by row (matrix may be padded)
+            const auto &data(nt.data());
+            auto *h(&heights[i * pixels]);
+            for (int row(0); row != size.height; ++row) {
+                const auto *src(data.ptr<opencv::NavTile::DataType>(row));
+                std::copy(src, src + size.width, h + row * size.width);
+            }
+
+            auto *mask(&masks[i * pixels]);
+            nt.coverageMask().forEachQuad
+                ([&](unsigned int x, unsigned int y, unsigned int xsize
+                     , unsigned int ysize, bool)
+            {
+                for (auto j(y), je(y + ysize); j != je; ++j) {
+                    std::memset(mask + j * size.width + x, 1, xsize);
+                }
+            }, NavTile::CoverageMask::Filter::white);
+        }
+    }
+
+    const long count(ids.size());
+    python::dict out;
+    out["valid"] = asArray(std::move(valid));
+    out["heights"] = asArray(std::move(heights)
+                             , { count, size.height, size.width });
+    out["masks"] = asArray(std::move(masks)
+                           , { count, size.height, size.width });
+    return out;
+}
+
+python::dict TileSetReader::metanodes(const python::object &pids) const
+{
+    const auto ids(tileIds(pids));
+    const auto count(ids.size());
+
+    std::vector<bool> valid(count, false);
+    std::vector<std::uint16_t> flags(count, 0);
+    std::vector<double> extents(6 * count, 0.0);
+    std::vector<float> geomExtents(3 * count, 0.f);
+    std::vector<float> texelSize(count, 0.f);
+    std::vector<std::uint16_t> displaySize(count, 0);
+    std::vector<std::int16_t> heightRange(2 * count, 0);
+    std::vector<std::uint8_t> internalTextureCount(count, 0);
+
+    {
+        GilRelease nogil;
+
+        for (std::size_t i(0); i != count; ++i) {
+            const auto node(metanode(ids[i]));
+            if (!node) { continue; }
+
+            valid[i] = true;
+            flags[i] = node->flags();
+            for (int c(0); c != 3; ++c) {
+                extents[6 * i + c] = node->extents.ll(c);
+                extents[6 * i + 3 + c] = node->extents.ur(c);
+            }
+            geomExtents[3 * i] = node->geomExtents.z.min;
+            geomExtents[3 * i + 1] = node->geomExtents.z.max;
+            geomExtents[3 * i + 2] = node->geomExtents.surrogate;
+            texelSize[i] = node->texelSize;
+            displaySize[i] = node->displaySize;
+            heightRange[2 * i] = node->heightRange.min;
+            heightRange[2 * i + 1] = node->heightRange.max;
+            internalTextureCount[i] = node->internalTextureCount();
+        }
+    }
+
+    const long c(count);
+    python::dict out;
+    out["valid"] = asArray(std::move(valid));
+    out["flags"] = asArray(std::move(flags), { c });
+    out["extents"] = asArray(std::move(extents), { c, 6 });
+    out["geomExtents"] = asArray(std::move(geomExtents), { c, 3 });
+    out["texelSize"] = asArray(std::move(texelSize), { c });
+    out["displaySize"] = asArray(std::move(displaySize), { c });
+    out["heightRange"] = asArray(std::move(heightRange), { c, 2 });
+    out["internalTextureCount"]
+        = asArray(std::move(internalTextureCount), { c });
+    return out;
+}
+
+/** Read-only storage.
+ */
+class StorageReader {
+public:
+    StorageReader(const Storage &storage) : storage_(storage) {}
+
+    python::list tilesets() const {
+        python::list out;
+        for (const auto &id : storage_.tilesets()) { out.append(id); }
+        return out;
+    }
+
+    std::string referenceFrame() const {
+        return storage_.referenceFrame().id;
+    }
+
+    TileSetReader::pointer open(const python::object &tilesetId) const {
+        return std::make_shared<TileSetReader>
+            (storage_.open(py2utf8(tilesetId)));
+    }
+
+    /** Opens in-memory aggregated tileset of given (or all) tilesets
+     *  including their glues.
+     */
+    TileSetReader::pointer aggregate(const python::object &tilesets) const {
+        TilesetIdList ids;
+        if (tilesets.is_none()) {
+            ids = storage_.tilesets();
+        } else {
+            for (python::stl_input_iterator<python::object> it(tilesets), e;
+                 it != e; ++it)
+            {
+                ids.push_back(py2utf8(*it));
+            }
+        }
+
+        CloneOptions co;
+        co.tilesetId("aggregated");
+        return std::make_shared<TileSetReader>
+            (aggregateTileSets(storage_, co, ids));
+    }
+
+private:
+    Storage storage_;
+};
+
+TileSetReader::pointer openTileSetReader(const python::object &path)
+{
+    return std::make_shared<TileSetReader>
+        (openTileSet(fs::path(py2utf8(path))));
+}
+
+std::shared_ptr<StorageReader> openStorageReader(const python::object &path)
+{
+    return std::make_shared<StorageReader>
+        (openStorage(fs::path(py2utf8(path)), OpenMode::readOnly));
+}
+
+} // namespace
+
+} } } // namespace vtslibs::vts::py
+
+BOOST_PYTHON_MODULE(vtslibs)
+{
+    using namespace python;
+    namespace py = vtslibs::vts::py;
+    typedef vtslibs::vts::TileIndex::Flag TileFlag;
+
+    np::initialize();
+
+    // tile index flags usable as tiles() mask
+    {
+        object flags(class_<TileFlag>("TileFlags", no_init));
+        flags.attr("mesh") = TileFlag::value_type(TileFlag::mesh);
+        flags.attr("watertight") = TileFlag::value_type(TileFlag::watertight);
+        flags.attr("atlas") = TileFlag::value_type(TileFlag::atlas);
+        flags.attr("navtile") = TileFlag::value_type(TileFlag::navtile);
+        flags.attr("alien") = TileFlag::value_type(TileFlag::alien);
+        flags.attr("multimesh") = TileFlag::value_type(TileFlag::multimesh);
+        flags.attr("content") = TileFlag::value_type(TileFlag::content);
+        flags.attr("any") = TileFlag::value_type(TileFlag::any);
+    }
+
+    class_<py::TileSetReader, py::TileSetReader::pointer
+           , boost::noncopyable>("TileSet", no_init)
+        .add_property("id", &py::TileSetReader::id)
+        .add_property("lodRange", &py::TileSetReader::lodRange)
+        .add_property("referenceFrame", &py::TileSetReader::referenceFrame)
+        .def("tiles", &py::TileSetReader::tiles
+             , (arg("mask") = TileFlag::value_type(TileFlag::mesh))
+             , "Returns (ids, flags): (N, 3) array of (lod, x, y) and (N) "
+             "array of tile index flags of all tiles matching mask.")
+        .def("meshes", &py::TileSetReader::meshes, (arg("ids"))
+             , "Loads meshes of given tiles into concatenated arrays.")
+        .def("coverageMasks", &py::TileSetReader::coverageMasks, (arg("ids"))
+             , "Loads coverage masks of given tiles, (N, H, W) array.")
+        .def("navtiles", &py::TileSetReader::navtiles, (arg("ids"))
+             , "Loads navtiles of given tiles, (N, H, W) arrays.")
+        .def("metanodes", &py::TileSetReader::metanodes, (arg("ids"))
+             , "Loads metanodes of given tiles as arrays of fields.")
+        ;
+
+    class_<py::StorageReader, std::shared_ptr<py::StorageReader>
+           , boost::noncopyable>("Storage", no_init)
+        .add_property("referenceFrame", &py::StorageReader::referenceFrame)
+        .def("tilesets", &py::StorageReader::tilesets)
+        .def("open", &py::StorageReader::open, (arg("tilesetId")))
+        .def("aggregate", &py::StorageReader::aggregate
+             , (arg("tilesets") = object()))
+        ;
+
+    def("openTileSet", &py::openTileSetReader, (arg("path"))
+        , "Opens tileset in read-only mode.");
+    def("openStorage", &py::openStorageReader, (arg("path"))
+        , "Opens storage in read-only mode.");
+}
@@ -0,0 +1,265 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <cmath>
+#include <stdexcept>
+
+#include "dbglog/dbglog.hpp"
+
+#include "../storage/error.hpp"
+
+#include "./spatialfilter.hpp"
+#include "./nodeinfo.hpp"
+#include "./csconvertor.hpp"
+
+namespace vtslibs { namespace vts {
+
+namespace {
+
+/** Ray casting point in polygon test.
+ */
+bool inside(const math::Points2 &polygon, const math::Point2 &p)
+{
+    bool in(false);
+    for (std::size_t i(0), j(polygon.size() - 1), e(polygon.size());
+         i != e; j = i++)
+    {
+        const auto &a(polygon[i]);
+        const auto &b(polygon[j]);
+        if (((a(1) > p(1)) != (b(1) > p(1)))
+            && (p(0) < ((b(0) - a(0)) * (p(1) - a(1)) / (b(1) - a(1))
+                        + a(0))))
+        {
+            in = !in;
+        }
+    }
+    return in;
+}
+
+inline double cross(const math::Point2 &o, const math::Point2 &a
+                    , const math::Point2 &b)
+{
+    return ((a(0) - o(0)) * (b(1) - o(1)) - (a(1) - o(1)) * (b(0) - o(0)));
+}
+
+/** Proper segment intersection test.
+ */
+bool intersects(const math::Point2 &a, const math::Point2 &b
+                , const math::Point2 &c, const math::Point2 &d)
+{
+    const auto d1(cross(c, d, a));
+    const auto d2(cross(c, d, b));
+    const auto d3(cross(a, b, c));
+    const auto d4(cross(a, b, d));
+    return ((((d1 > 0) && (d2 < 0)) || ((d1 < 0) && (d2 > 0)))
+            && (((d3 > 0) && (d4 < 0)) || ((d3 < 0) && (d4 > 0))));
+}
+
+bool strictlyInside(const math::Extents2 &e, const math::Point2 &p)
+{
+    return ((p(0) > e.ll(0)) && (p(0) < e.ur(0))
+            && (p(1) > e.ll(1)) && (p(1) < e.ur(1)));
+}
+
+math::Extents2 polygonExtents(const math::Points2 &polygon)
+{
+    math::Extents2 extents(math::InvalidExtents{});
+    for (const auto &p : polygon) { math::update(extents, p); }
+    return extents;
+}
+
+math::Point2 convert(const CsConvertor &conv, const math::Point2 &p)
+{
+    const auto c(conv(p));
+    if (!std::isfinite(c(0)) || !std::isfinite(c(1))) {
+        throw std::domain_error("Non-finite converted point.");
+    }
+    return c;
+}
+
+/** Edge subdivision limits: every edge is split at least 2^MinDepth times
+ *  and at most 2^MaxDepth times; splitting stops when converted midpoint
+ *  deviates from converted chord less than MaxDeviation * chord length.
+ */
+const int MinDepth(3);
+const int MaxDepth(16);
+const double MaxDeviation(1e-4);
+
+/** Converts edge (a, b) into destination SRS (ca and cb are converted a and
+ *  b) and appends all its vertices but the last one to output.
+ */
+void convertEdge(const CsConvertor &conv, const math::Point2 &a
+                 , const math::Point2 &b, const math::Point2 &ca
+                 , const math::Point2 &cb, int depth, math::Points2 &out)
+{
+    if (depth < MaxDepth) {
+        const math::Point2 m(0.5 * (a + b));
+        const auto cm(convert(conv, m));
+
+        const auto chord(boost::numeric::ublas::norm_2(cb - ca));
+        const auto deviation
+            (boost::numeric::ublas::norm_2(cm - 0.5 * (ca + cb)));
+
+        if ((depth < MinDepth) || (deviation > MaxDeviation * chord)) {
+            convertEdge(conv, a, m, ca, cm, depth + 1, out);
+            convertEdge(conv, m, b, cm, cb, depth + 1, out);
+            return;
+        }
+    }
+
+    out.push_back(ca);
+}
+
+/** Converts polygon ring into destination SRS. Edges are densified so that
+ *  the converted ring follows the true (possibly curved) area boundary.
+ */
+math::Points2 convertRing(const CsConvertor &conv, const math::Points2 &ring)
+{
+    math::Points2 converted;
+    for (const auto &p : ring) { converted.push_back(convert(conv, p)); }
+
+    math::Points2 out;
+    for (std::size_t i(0), e(ring.size()); i != e; ++i) {
+        const auto n((i + 1) % e);
+        convertEdge(conv, ring[i], ring[n], converted[i], converted[n]
+                    , 0, out);
+    }
+    return out;
+}
+
+} // namespace
+
+SpatialFilter& SpatialFilter::setPolygon(const math::Points2 &polygon)
+{
+    if (polygon.size() < 3) {
+        LOGTHROW(err2, storage::InconsistentInput)
+            << "Spatial filter polygon must have at least 3 vertices.";
+    }
+
+    this->polygon = polygon;
+    extents = polygonExtents(polygon);
+    return *this;
+}
+
+SpatialFilterMatcher::SpatialFilterMatcher(const SpatialFilter &filter
+                                           , const registry::ReferenceFrame
+                                           &referenceFrame)
+    : boundary_(filter.boundary)
+{
+    if (filter.srs.empty() || !math::valid(filter.extents)) {
+        LOGTHROW(err2, storage::InconsistentInput)
+            << "Spatial filter must have valid SRS and extents.";
+    }
+
+    if (!filter.polygon.empty()
+        && (filter.boundary == SpatialFilter::Boundary::clip))
+    {
+        // clipMesh clips only to extents, clipping to polygon's bounding box
+        // would leave geometry outside the area
+        LOGTHROW(err2, storage::InconsistentInput)
+            << "Spatial filter polygon cannot be used in clip mode.";
+    }
+
+    // area boundary: polygon or extents' outline
+    const auto ring(filter.polygon.empty()
+                    ? math::Points2{
+                        ll(filter.extents), lr(filter.extents)
+                        , ur(filter.extents), ul(filter.extents) }
+                    : filter.polygon);
+
+    for (const auto &srs : referenceFrame.division.srsList()) {
+        // area is converted as a polygon since edges of converted extents are
+        // not straight in general; extents are taken from converted polygon
+        Area area;
+        try {
+            const CsConvertor conv(filter.srs, srs);
+            area.polygon = convertRing(conv, ring);
+        } catch (const std::exception &e) {
+            // area not representable in this SRS, all its tiles are outside
+            LOG(warn2)
+                << "Unable to convert spatial filter area to SRS <" << srs
+                << "> (" << e.what() << "); treating all tiles in this "
+                "SRS as outside.";
+            continue;
+        }
+
+        area.extents = polygonExtents(area.polygon);
+        areas_.insert(Areas::value_type(srs, area));
+    }
+}
+
+const math::Extents2& SpatialFilterMatcher::extents(const std::string &srs)
+    const
+{
+    auto fareas(areas_.find(srs));
+    if (fareas == areas_.end()) {
+        LOGTHROW(err2, storage::Error)
+            << "Inconsistency: no spatial filter area for srs <"
+            << srs << ">.";
+    }
+    return fareas->second.extents;
+}
+
+SpatialClass SpatialFilterMatcher::operator()(const NodeInfo &nodeInfo) const
+{
+    auto fareas(areas_.find(nodeInfo.srs()));
+    if (fareas == areas_.end()) { return SpatialClass::outside; }
+    const auto &area(fareas->second);
+    const auto &e(nodeInfo.extents());
+
+    if (!math::overlaps(area.extents, e)) { return SpatialClass::outside; }
+
+    const math::Point2 corners[4] = {
+        e.ll, math::Point2(e.ur(0), e.ll(1))
+        , e.ur, math::Point2(e.ll(0), e.ur(1))
+    };
+
+    int cornersInside(0);
+    for (const auto &c : corners) {
+        if (inside(area.polygon, c)) { ++cornersInside; }
+    }
+
+    // any polygon vertex inside tile or any edge crossing tile's edge makes
+    // tile a boundary one
+    const auto &polygon(area.polygon);
+    for (std::size_t i(0), j(polygon.size() - 1), ie(polygon.size());
+         i != ie; j = i++)
+    {
+        if (strictlyInside(e, polygon[i])) { return SpatialClass::boundary; }
+        for (int c(0); c < 4; ++c) {
+            if (intersects(polygon[j], polygon[i]
+                           , corners[c], corners[(c + 1) % 4]))
+            {
+                return SpatialClass::boundary;
+            }
+        }
+    }
+
+    if (!cornersInside) { return SpatialClass::outside; }
+    if (cornersInside == 4) { return SpatialClass::inside; }
+    return SpatialClass::boundary;
+}
+
+} } // namespace vtslibs::vts
@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/spatialfilter.hpp
+ *
+ * Spatial filtering of tileset content.
+ */
+
+#ifndef vtslibs_vts_spatialfilter_hpp_included_
+#define vtslibs_vts_spatialfilter_hpp_included_
+
+#include <map>
+#include <string>
+
+#include "math/geometry_core.hpp"
+
+namespace vtslibs {
+
+namespace registry { struct ReferenceFrame; }
+
+namespace vts {
+
+class NodeInfo;
+
+/** Restricts tileset content to given area.
+ *
+ *  Area is given either by extents or by polygon (outer ring only) in given
+ *  SRS. Tiles fully outside the area are skipped, tiles on the area's boundary
+ *  are either kept whole or clipped.
+ */
+struct SpatialFilter {
+    /** What to do with tiles on the area's boundary.
+     */
+    enum class Boundary {
+        keep   //!< boundary tiles are kept as they are
+        , clip //!< boundary tiles' meshes are clipped to the area's extents
+               //!< (extents only, not allowed with polygon)
+    };
+
+    /** SRS of extents/polygon.
+     */
+    std::string srs;
+
+    /** Area extents. Set to polygon's bounding box by polygon(...).
+     */
+    math::Extents2 extents;
+
+    /** Optional area polygon. Empty if area is given by extents only.
+     */
+    math::Points2 polygon;
+
+    Boundary boundary;
+
+    SpatialFilter()
+        : extents(math::InvalidExtents{}), boundary(Boundary::keep)
+    {}
+
+    SpatialFilter(const std::string &srs, const math::Extents2 &extents
+                  , Boundary boundary = Boundary::keep)
+        : srs(srs), extents(extents), boundary(boundary)
+    {}
+
+    /** Sets area polygon and updates extents.
+     */
+    SpatialFilter& setPolygon(const math::Points2 &polygon);
+};
+
+/** Classification of a tile against spatial filter.
+ */
+enum class SpatialClass { outside, boundary, inside };
+
+/** Spatial filter prepared for given reference frame, i.e. area converted to
+ *  all spatial division SRSs. Area boundary is densified before conversion
+ *  to follow curved edges; SRS the area cannot be converted to has all its
+ *  tiles outside.
+ */
+class SpatialFilterMatcher {
+public:
+    SpatialFilterMatcher(const SpatialFilter &filter
+                         , const registry::ReferenceFrame &referenceFrame);
+
+    /** Classifies tile (given by its node) against filter's area.
+     */
+    SpatialClass operator()(const NodeInfo &nodeInfo) const;
+
+    /** Area extents in given spatial division SRS. Throws if area is not
+     *  available in given SRS.
+     */
+    const math::Extents2& extents(const std::string &srs) const;
+
+    SpatialFilter::Boundary boundary() const { return boundary_; }
+
+private:
+    struct Area {
+        /** Bounding box of polygon.
+         */
+        math::Extents2 extents;
+
+        /** Converted (densified) area boundary.
+         */
+        math::Points2 polygon;
+    };
+
+    typedef std::map<std::string, Area> Areas;
+    Areas areas_;
+    SpatialFilter::Boundary boundary_;
+};
+
+} } // namespace vtslibs::vts
+
+#endif // vtslibs_vts_spatialfilter_hpp_included_
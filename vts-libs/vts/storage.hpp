@@ -134,8 +134,18 @@ public:
         lodRange_ = lodRange;  return *this;
     }
 
+    const boost::optional<SpatialFilter>& spatialFilter() const {
+        return spatialFilter_;
+    }
+
+    TileFilter&
+    spatialFilter(const boost::optional<SpatialFilter> &spatialFilter) {
+        spatialFilter_ = spatialFilter;  return *this;
+    }
+
 private:
     boost::optional<LodRange> lodRange_;
+    boost::optional<SpatialFilter> spatialFilter_;
 };
 
 class PendingGluesError : public std::runtime_error {
@@ -206,9 +216,38 @@ public:
         Mode mode;
         bool overwrite;
 
+        /** How tileset data get into the storage:
+         *    * copy: tileset is cloned (default)
+         *    * link: tileset's immutable files are hardlinked into
+         *            storage, files modified in place (archives, index)
+         *            are reflinked (copy-on-write) if possible or copied;
+         *            source tileset is left intact
+         *    * move: all files are hardlinked and source tileset is removed
+         *            once the tileset is committed into the storage
+         *
+         *  Linking falls back to cloning when source tileset is not a plain
+         *  tileset, lives on different filesystem or LOD filter is applied.
+         */
+        enum class Adopt { copy, link, move };
+        Adopt adopt;
+
+        /** Memory budget (in bytes) for generating glues in memory. Glues
+         *  are written to disk only when non-empty. Zero means glues are
+         *  generated directly on disk.
+         */
+        std::size_t glueMemoryBudget;
+
+        /** Store tile files of added tileset and generated glues in storage's
+         *  content-addressed store (storage-path/content) so that identical
+         *  files are kept only once. Temporary directory must be on the same
+         *  filesystem as the storage.
+         */
+        bool dedup;
+
         AddOptions()
             : bumpVersion(false), filter(), dryRun(false)
-            , mode(Mode::legacy), overwrite(false)
+            , mode(Mode::legacy), overwrite(false), adopt(Adopt::copy)
+            , glueMemoryBudget(0), dedup(false)
         {}
     };
 
@@ -225,6 +264,38 @@ public:
     void add(const boost::filesystem::path &tilesetPath, const Location &where
              , const TilesetId &tilesetId, const AddOptions &addOptions);
 
+    /** Single tileset in batch add. Members have the same meaning as
+     *  arguments of single tileset add.
+     */
+    struct AddEntry {
+        boost::filesystem::path tilesetPath;
+        Location where;
+        TilesetId tilesetId;
+        AddOptions addOptions;
+
+        AddEntry(const boost::filesystem::path &tilesetPath
+                 , const Location &where, const TilesetId &tilesetId
+                 , const AddOptions &addOptions)
+            : tilesetPath(tilesetPath), where(where), tilesetId(tilesetId)
+            , addOptions(addOptions)
+        {}
+
+        typedef std::vector<AddEntry> list;
+    };
+
+    /** Adds all given tilesets in one transaction. Entries are placed into
+     *  the stack one by one, therefore an entry's location can reference
+     *  tileset added by previous entry. Glues are planned only once against
+     *  the final stack.
+     *
+     *  Per-tileset options (bumpVersion, filter, tags, openOptions, adopt)
+     *  are taken from each entry. Transaction-wide options (mode, dryRun,
+     *  tmp) and glue creation options (textureQuality, adaptiveQuality,
+     *  clip, overwrite, glueMemoryBudget, dedup) must be the same in all
+     *  entries; glue progress reporting is taken from the first entry.
+     */
+    void add(const AddEntry::list &entries);
+
     /** Removes given tileset from the storage.
      *
      * Removes all glues and virtual surfaces that reference given tileset.
@@ -233,6 +304,20 @@ public:
      */
     void remove(const TilesetIdList &tilesetIds);
 
+    /** Moves given tilesets to new location in the stack. Moved tilesets
+     *  are placed at the location as a block, in the given order (first one
+     *  is the lowest one).
+     *
+     *  Glues whose member order is still valid are kept. Other glues are
+     *  removed and their combinations become pending (generate them by
+     *  generateGlues). Virtual surfaces whose member order changed are
+     *  removed.
+     *
+     *  \param tilesetIds Ids of tilesets to move
+     *  \param where new location; must not reference moved tileset
+     */
+    void reorder(const TilesetIdList &tilesetIds, const Location &where);
+
     void generateGlues(const TilesetId &tilesetId
                        , const AddOptions &addOptions);
 
@@ -38,6 +38,16 @@
 #include <iterator>
 #include <functional>
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#  include <linux/fs.h>
+#endif
+
 #include <boost/optional.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/filesystem.hpp>
@@ -61,6 +71,9 @@
 #include "../../vts.hpp"
 #include "./detail.hpp"
 #include "../tileset/detail.hpp"
+#include "../tileset/config.hpp"
+#include "../tileset/driver/plain.hpp"
+#include "../tileset/driver/contentstore.hpp"
 #include "../encoder.hpp"
 #include "../io.hpp"
 
@@ -131,6 +144,27 @@ void Storage::add(const boost::filesystem::path &tilesetPath
                  , ao);
 }
 
+void Storage::add(const AddEntry::list &entries)
+{
+    const auto mergeConf
+        (loadMergeConf(detail().root / storage_paths::mergeConfPath()
+                       , true));
+
+    TileSet::list tilesets;
+    AddEntry::list resolved;
+    for (const auto &entry : entries) {
+        const auto ao(updateAddOptions(entry.addOptions, mergeConf));
+        tilesets.push_back(openTileSet(entry.tilesetPath, ao.openOptions));
+        const auto &ts(tilesets.back());
+        resolved.emplace_back(entry.tilesetPath, entry.where
+                              , (entry.tilesetId.empty()
+                                 ? ts.getProperties().id : entry.tilesetId)
+                              , ao);
+    }
+
+    detail().add(tilesets, resolved);
+}
+
 void Storage::generateGlues(const TilesetId &tilesetId
                             , const AddOptions &addOptions)
 {
@@ -161,6 +195,11 @@ void Storage::remove(const TilesetIdList &tilesetIds)
     detail().remove(tilesetIds);
 }
 
+void Storage::reorder(const TilesetIdList &tilesetIds, const Location &where)
+{
+    detail().reorder(tilesetIds, where);
+}
+
 void Storage::createVirtualSurface( const TilesetIdSet &tilesets
                                   , const CloneOptions &createOptions)
 {
@@ -176,10 +215,28 @@ namespace {
 
 void rmrf(const fs::path &path)
 {
+    // release content shared via content store (if any)
+    try {
+        driver::ContentStore::releaseTileSet(path);
+    } catch (const std::exception &e) {
+        LOG(warn2) << "Unable to release content of " << path
+                   << ": <" << e.what() << ">.";
+    }
+
     boost::system::error_code ec;
     remove_all(path, ec);
 }
 
+/** Content store used for new tilesets if deduplication is requested.
+ */
+boost::optional<fs::path> contentStore(const fs::path &root
+                                       , const Storage::AddOptions &addOptions)
+{
+    if (!addOptions.dedup) { return boost::none; }
+    // NB: path is saved in tileset config -> must be absolute
+    return fs::absolute(root / storage_paths::contentStoreRoot());
+}
+
 class Tx : boost::noncopyable {
 public:
     Tx(const fs::path &root, const boost::optional<fs::path> &tmpRoot
@@ -382,18 +439,27 @@ namespace {
 typedef std::vector<TileSet> TileSets;
 typedef std::vector<TileIndex> TileIndices;
 
-std::tuple<TileSets, std::size_t>
-openTilesets(Tx &tx, const StoredTileset::list &infos, const TileSet &tileset
-             , const vts::TilesetId &addedId)
+/** Added tilesets (already open), mapped by tileset ID.
+ */
+typedef std::map<vts::TilesetId, TileSet> AddedTilesets;
+
+/** Indices of added tilesets in the stack.
+ */
+typedef std::vector<std::size_t> AddedIndices;
+
+std::tuple<TileSets, AddedIndices>
+openTilesets(Tx &tx, const StoredTileset::list &infos
+             , const AddedTilesets &added)
 {
-    std::tuple<TileSets, std::size_t> res;
+    std::tuple<TileSets, AddedIndices> res;
     TileSets &tilesets(std::get<0>(res));
     std::size_t index(0);
     for (const auto &info : infos) {
-        if (info.tilesetId == addedId) {
-            tilesets.push_back(tileset);
-            std::get<1>(res) = index;
-            LOG(info2) << "Reused already open <" << addedId << ">.";
+        auto fadded(added.find(info.tilesetId));
+        if (fadded != added.end()) {
+            tilesets.push_back(fadded->second);
+            std::get<1>(res).push_back(index);
+            LOG(info2) << "Reused already open <" << info.tilesetId << ">.";
         } else {
             tilesets.push_back(tx.open(info.tilesetId));
             LOG(info2) << "Opened tileset <" << info.tilesetId << ">.";
@@ -554,8 +620,8 @@ GlueDescriptor::list prepareGlues(Tx &tx, Ts::list &tilesets, Ts &added)
         incidentSets.push_back(&added);
 
         for (auto &ts : tilesets) {
-            // ignore added tileset
-            if (ts.added) {continue; }
+            // ignore added tileset itself
+            if (&ts == &added) { continue; }
             if (ts.notoverlaps(added)) {
                 LOG(info1) << "Tileset <" << ts.id()
                            << "> does not overlap added tileset <"
@@ -681,14 +747,17 @@ GlueDescriptor::list prepareGlues(Tx &tx, Ts::list &tilesets, Ts &added)
 
 GlueDescriptor::list
 prepareGlues(Tx &tx, Storage::Properties properties
-             , const std::tuple<TileSets, std::size_t> &tsets)
+             , const std::tuple<TileSets, AddedIndices> &tsets)
 {
     if (properties.tilesets.size() <= 1) {
         LOG(info3) << "No need to create any glue.";
         return {};
     }
 
-    // create tileset list
+    const auto &addedIndices(std::get<1>(tsets));
+
+    // create tileset list; spheres of influence are computed only once and
+    // shared between all added tilesets
     Ts::list tilesets;
     {
         // accumulate lod range for all tilesets
@@ -697,14 +766,25 @@ prepareGlues(Tx &tx, Storage::Properties properties
 
         std::size_t index(0);
         for (auto &set : std::get<0>(tsets)) {
-            tilesets.emplace_back(index, set, lr, properties
-                                  , (index == std::get<1>(tsets)));
+            tilesets.emplace_back
+                (index, set, lr, properties
+                 , (std::find(addedIndices.begin(), addedIndices.end()
+                              , index) != addedIndices.end()));
             ++index;
         }
     }
 
-    // prepare glues
-    auto gds(prepareGlues(tx, tilesets, tilesets[std::get<1>(tsets)]));
+    // prepare glues for each added tileset; glue touching more added
+    // tilesets is found more than once
+    GlueDescriptor::list gds;
+    std::set<Glue::Id> seen;
+    for (auto index : addedIndices) {
+        for (auto &gd : prepareGlues(tx, tilesets, tilesets[index])) {
+            if (!seen.insert(gd.glue.id).second) { continue; }
+            gd.index = gds.size() + 1;
+            gds.push_back(std::move(gd));
+        }
+    }
 
     // done
     return gds;
@@ -774,9 +854,17 @@ Glue createGlue(Tx &tx, const GlueDescriptor &gd
 
     reportMemoryUsage("before glue creation");
 
-    // create glue
+    // create glue, either directly on disk or in memory first
     auto gPath(tx.addGlue(gd.glue));
-    auto gts(createTileSet(gPath, gprop, CreateMode::overwrite));
+    const bool inMemory(addOptions.glueMemoryBudget);
+    const auto store(contentStore(tx.root(), addOptions));
+    auto gts(inMemory
+             ? createMemoryTileSet(utility::addExtension(gPath, ".mem")
+                                   , gprop, addOptions.glueMemoryBudget
+                                   , CreateMode::overwrite)
+             : createTileSet(gPath, gprop, CloneOptions()
+                             .mode(CreateMode::overwrite)
+                             .contentStore(store)));
 
     // create glue
     utility::DurationMeter timer;
@@ -810,6 +898,14 @@ Glue createGlue(Tx &tx, const GlueDescriptor &gd
         // flush
         gts.flush();
 
+        if (inMemory) {
+            // persist in-memory glue
+            cloneTileSet(gPath, gts, CloneOptions()
+                         .mode(CreateMode::overwrite)
+                         .tilesetId(gprop.id)
+                         .contentStore(store));
+        }
+
         reportMemoryUsage("after glue flush");
     }
 
@@ -817,6 +913,136 @@ Glue createGlue(Tx &tx, const GlueDescriptor &gd
     return glue;
 }
 
+/** Makes copy-on-write clone (reflink) of a file, i.e. data are shared
+ *  until either copy is modified. Returns false if not supported.
+ */
+bool reflink(const fs::path &src, const fs::path &dst)
+{
+#if defined(__linux__) && defined(FICLONE)
+    const int sfd(::open(src.string().c_str(), O_RDONLY | O_CLOEXEC));
+    if (sfd == -1) { return false; }
+
+    const int dfd(::open(dst.string().c_str()
+                         , O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666));
+    if (dfd == -1) {
+        ::close(sfd);
+        return false;
+    }
+
+    const bool ok(!::ioctl(dfd, FICLONE, sfd));
+    ::close(dfd);
+    ::close(sfd);
+
+    if (!ok) {
+        ::unlink(dst.string().c_str());
+        return false;
+    }
+
+    boost::system::error_code ec;
+    fs::permissions(dst, fs::status(src).permissions(), ec);
+    return true;
+#else
+    (void) src; (void) dst;
+    return false;
+#endif
+}
+
+/** Adopts plain tileset into the storage without cloning it tile by tile.
+ *  Configuration is written anew since it carries tileset ID.
+ *
+ *  Files that are modified in place (tilar archives, index...) must not
+ *  share inodes with the source tileset unless source tileset is dropped
+ *  (move mode, shareAll = true). They are cloned via reflink if supported
+ *  by the filesystem or copied otherwise. Immutable content store
+ *  references are always hardlinked.
+ *
+ *  Returns false if tileset cannot be linked (different filesystem, no
+ *  hardlink support etc.); work path is cleaned up in such case.
+ */
+bool linkTileSet(const fs::path &path, const TileSet &src
+                 , const TilesetId &tilesetId, bool shareAll)
+{
+    if (!boost::any_cast<const driver::PlainOptions>
+        (&src.getProperties().driverOptions))
+    {
+        LOG(info2) << "Tileset <" << src.id() << "> is not a plain tileset, "
+            "cannot be linked.";
+        return false;
+    }
+
+    const auto srcRoot(src.root());
+    const auto config(srcRoot / "tileset.conf");
+
+    // content store references are never modified
+    const auto refRoot
+        (driver::ContentStore::referenceRoot(srcRoot).string() + "/");
+    auto immutable([&](const fs::path &p) -> bool
+    {
+        return !p.string().compare(0, refRoot.size(), refRoot);
+    });
+
+    std::size_t linked(0), cloned(0), copied(0);
+
+    auto failed([&](const boost::system::error_code &ec) -> bool
+    {
+        LOG(info3)
+            << "Cannot link tileset <" << src.id() << "> from "
+            << srcRoot << " (" << ec.message() << "); cloning.";
+        rmrf(path);
+        return false;
+    });
+
+    boost::system::error_code ec;
+    rmrf(path);
+    fs::create_directories(path, ec);
+    if (ec) { return failed(ec); }
+
+    for (fs::recursive_directory_iterator isrc(srcRoot), esrc;
+         isrc != esrc; ++isrc)
+    {
+        const auto &srcPath(isrc->path());
+        if (srcPath == config) { continue; }
+
+        // iterator yields paths prefixed by srcRoot
+        const auto dstPath
+            (path / srcPath.string().substr(srcRoot.string().size()));
+
+        switch (isrc->symlink_status().type()) {
+        case fs::directory_file:
+            fs::create_directory(dstPath, ec);
+            break;
+
+        case fs::symlink_file:
+            fs::copy_symlink(srcPath, dstPath, ec);
+            break;
+
+        default:
+            if (shareAll || immutable(srcPath)) {
+                fs::create_hard_link(srcPath, dstPath, ec);
+                ++linked;
+            } else if (reflink(srcPath, dstPath)) {
+                ++cloned;
+            } else {
+                fs::copy_file(srcPath, dstPath, ec);
+                ++copied;
+            }
+            break;
+        }
+
+        if (ec) { return failed(ec); }
+    }
+
+    // write configuration under new tileset ID
+    auto properties(tileset::loadConfig(config));
+    properties.id = tilesetId;
+    tileset::saveConfig(path / "tileset.conf", properties);
+
+    LOG(info3) << "Linked tileset <" << src.id() << "> from "
+               << srcRoot << " (" << linked << " files hardlinked, "
+               << cloned << " reflinked, " << copied << " copied).";
+    return true;
+}
+
 } // namespace
 
 std::tuple<Storage::Properties, StoredTileset>
@@ -976,6 +1202,131 @@ Storage::Detail::removeTilesets(const Properties &properties
     return res;
 }
 
+std::tuple<Storage::Properties, Glue::map, VirtualSurface::map, Glue::IdSet>
+Storage::Detail::reorderTilesets(const Properties &properties
+                                 , const TilesetIdList &tilesetIds
+                                 , const Location &where)
+    const
+{
+    std::tuple<Properties, Glue::map, VirtualSurface::map, Glue::IdSet>
+        res(properties, {}, {}, {});
+    auto &p(std::get<0>(res));
+    auto &tilesets(p.tilesets);
+
+    // pull moved tilesets out of the stack
+    StoredTileset::list moved;
+    for (const auto &tilesetId : tilesetIds) {
+        auto ftilesets(p.findTilesetIt(tilesetId));
+        if (ftilesets == tilesets.end()) {
+            LOGTHROW(err1, vtslibs::storage::NoSuchTileSet)
+                << "Tileset <" << tilesetId << "> "
+                "not found in storage " << root << ".";
+        }
+        moved.push_back(*ftilesets);
+        tilesets.erase(ftilesets);
+    }
+
+    // and put them back at new location
+    auto place([&]() -> StoredTileset::list::iterator
+    {
+        if (where.where.empty()) {
+            // void reference: below -> top, above -> bottom
+            return ((where.direction == Location::Direction::below)
+                    ? tilesets.end() : tilesets.begin());
+        }
+
+        auto ftilesets(p.findTilesetIt(where.where));
+        if (ftilesets == tilesets.end()) {
+            LOGTHROW(err1, vtslibs::storage::NoSuchTileSet)
+                << "Tileset <" << where.where << "> (used as a reference) "
+                "not found in storage " << root << " or is being moved.";
+        }
+
+        return ((where.direction == Location::Direction::below)
+                ? ftilesets : std::next(ftilesets));
+    }());
+    tilesets.insert(place, moved.begin(), moved.end());
+
+    // new stack position of each tileset
+    std::map<TilesetId, std::size_t> position;
+    {
+        std::size_t index(0);
+        for (const auto &tileset : tilesets) {
+            position[tileset.tilesetId] = index++;
+        }
+    }
+
+    // sorts members of given glue/virtual surface by new stack position
+    const auto reordered([&](const TilesetIdList &id) -> TilesetIdList
+    {
+        auto out(id);
+        std::sort(out.begin(), out.end()
+                  , [&](const TilesetId &l, const TilesetId &r)
+        {
+            return position.at(l) < position.at(r);
+        });
+        return out;
+    });
+
+    // pending glues: just fix member order
+    {
+        auto &resPendingGlues(std::get<3>(res));
+        Glue::IdSet pendingGlues;
+        for (const auto &id : p.pendingGlues) {
+            const auto nid(reordered(id));
+            if (nid != id) { resPendingGlues.insert(id); }
+            pendingGlues.insert(nid);
+        }
+        p.pendingGlues.swap(pendingGlues);
+    }
+
+    // glues: keep if member order is still valid, otherwise regenerate
+    auto &resGlues(std::get<1>(res));
+    for (auto iglues(p.glues.begin()); iglues != p.glues.end(); ) {
+        const auto nid(reordered(iglues->first));
+        if (nid == iglues->first) {
+            ++iglues;
+            continue;
+        }
+
+        LOG(info2) << "Glue <" << utility::join(iglues->first, ",")
+                   << "> invalidated, <" << utility::join(nid, ",")
+                   << "> is pending.";
+        p.pendingGlues.insert(nid);
+        resGlues.insert(*iglues);
+        iglues = p.glues.erase(iglues);
+    }
+
+    // empty glues: emptiness depends on member order as well
+    for (auto iglues(p.emptyGlues.begin()); iglues != p.emptyGlues.end(); ) {
+        const auto nid(reordered(*iglues));
+        if (nid == *iglues) {
+            ++iglues;
+            continue;
+        }
+
+        p.pendingGlues.insert(nid);
+        iglues = p.emptyGlues.erase(iglues);
+    }
+
+    // virtual surfaces cannot be regenerated automatically
+    auto &virtualSurfaces(p.virtualSurfaces);
+    auto &resVirtualSurfaces(std::get<2>(res));
+    for (auto ivirtualSurfaces(virtualSurfaces.begin());
+         ivirtualSurfaces != virtualSurfaces.end(); )
+    {
+        if (reordered(ivirtualSurfaces->first) == ivirtualSurfaces->first) {
+            ++ivirtualSurfaces;
+            continue;
+        }
+
+        resVirtualSurfaces.insert(*ivirtualSurfaces);
+        ivirtualSurfaces = virtualSurfaces.erase(ivirtualSurfaces);
+    }
+
+    return res;
+}
+
 std::tuple<Storage::Properties, VirtualSurface::map>
 Storage::Detail::removeVirtualSurfaces(const Properties &properties
                                        , const VirtualSurface::Ids &ids)
@@ -1088,6 +1439,9 @@ void generateGluesImpl(Tx &tx, const GlueDescriptor::list &gds
 
         // main transaction is not commit changes to the sub transaction
         subTx.commit();
+
+        // drop any partial content generated on demand
+        rmrf(storage_paths::onDemandGluePath(detail.root, glue.id));
     }
 }
 
@@ -1095,6 +1449,64 @@ void Storage::Detail::add(const TileSet &tileset, const Location &where
                           , const TilesetId &tilesetId
                           , const AddOptions &addOptions)
 {
+    add(TileSet::list{ tileset }
+        , AddEntry::list{ AddEntry(tileset.root(), where, tilesetId
+                                   , addOptions) });
+}
+
+namespace {
+
+/** Returns true if both add options generate the same glues.
+ */
+bool sameGlueOptions(const Storage::AddOptions &l
+                     , const Storage::AddOptions &r)
+{
+    const auto &laq(l.adaptiveQuality);
+    const auto &raq(r.adaptiveQuality);
+    if (bool(laq) != bool(raq)) { return false; }
+    if (laq && ((laq->minQuality != raq->minQuality)
+                || (laq->maxQuality != raq->maxQuality)
+                || (laq->targetPsnr != raq->targetPsnr)
+                || (laq->maxPasses != raq->maxPasses)))
+    {
+        return false;
+    }
+
+    return ((l.textureQuality == r.textureQuality)
+            && (l.clip == r.clip)
+            && (l.overwrite == r.overwrite)
+            && (l.glueMemoryBudget == r.glueMemoryBudget)
+            && (l.dedup == r.dedup));
+}
+
+} // namespace
+
+void Storage::Detail::add(const TileSet::list &tilesets
+                          , const AddEntry::list &entries)
+{
+    if (entries.empty()) { return; }
+
+    // transaction-wide options are taken from the first entry
+    const auto &addOptions(entries.front().addOptions);
+    for (const auto &entry : entries) {
+        const auto &ao(entry.addOptions);
+        if ((ao.mode != addOptions.mode) || (ao.dryRun != addOptions.dryRun)
+            || (ao.tmp != addOptions.tmp))
+        {
+            LOGTHROW(err2, vtslibs::storage::InconsistentInput)
+                << "All tilesets added in one batch must share add mode, "
+                "dry run flag and temporary directory.";
+        }
+
+        // glues may involve any tileset in the batch
+        if (!sameGlueOptions(ao, addOptions)) {
+            LOGTHROW(err2, vtslibs::storage::InconsistentInput)
+                << "All tilesets added in one batch must share glue "
+                "creation options (texture quality, adaptive quality, "
+                "clipping, overwrite, glue memory budget and dedup).";
+        }
+    }
+
     if (storageLock && (addOptions.mode == AddOptions::Mode::legacy)) {
         LOGTHROW(err2, vtslibs::storage::InconsistentInput)
             << "Legacy add mode is incompatible with locker2 storage locking "
@@ -1104,66 +1516,122 @@ void Storage::Detail::add(const TileSet &tileset, const Location &where
     // (re)load config to have fresh copy when under lock
     if (storageLock) { loadConfig(); }
 
+    TilesetIdList tilesetIds;
+    for (const auto &entry : entries) {
+        tilesetIds.push_back(entry.tilesetId);
+    }
+
     std::string simulation(addOptions.dryRun ? "(simulation) " : "");
     vtslibs::storage::TIDGuard tg
-        (str(boost::format("%sadd(%s)") % simulation % tilesetId));
+        (str(boost::format("%sadd(%s)") % simulation
+             % utility::join(tilesetIds, ",")));
+
+    // prepare new tileset list, tilesets are placed one by one
+    Properties nProperties(properties);
+    StoredTileset::list tilesetInfos;
+    for (std::size_t i(0), e(entries.size()); i != e; ++i) {
+        const auto &tileset(tilesets[i]);
+        const auto &entry(entries[i]);
+
+        // check compatibility
+        if (tileset.getProperties().referenceFrame
+            != properties.referenceFrame)
+        {
+            LOGTHROW(err1, vtslibs::storage::IncompatibleTileSet)
+                << "Tileset <" << entry.tilesetId << "> "
+                "uses different reference frame ("
+                << tileset.getProperties().referenceFrame
+                << ") from the one  this storage supports ("
+                << properties.referenceFrame << ").";
+        }
 
-    // check compatibility
-    if (tileset.getProperties().referenceFrame != properties.referenceFrame) {
-        LOGTHROW(err1, vtslibs::storage::IncompatibleTileSet)
-            << "Tileset <" << tilesetId << "> "
-            "uses different reference frame ("
-            << tileset.getProperties().referenceFrame
-            << ") from the one  this storage supports ("
-            << properties.referenceFrame << ").";
-    }
+        StoredTileset tilesetInfo;
+        std::tie(nProperties, tilesetInfo)
+            = addTileset(nProperties, entry.tilesetId, entry.addOptions
+                         , entry.where);
+        tilesetInfos.push_back(tilesetInfo);
 
-    // prepare new tileset list
-    Properties nProperties;
-    StoredTileset tilesetInfo;
-    std::tie(nProperties, tilesetInfo)
-        = addTileset(properties, tilesetId, addOptions, where);
-
-    LOG(info3)
-        << "Adding tileset <" << tileset.id() << "> (from "
-        << tileset.root() << ").";
+        LOG(info3)
+            << "Adding tileset <" << tileset.id() << "> (from "
+            << tileset.root() << ").";
+    }
 
     Tx tx(root, addOptions.tmp, addOptions.openOptions);
 
-    auto dst([&]() -> TileSet
+    auto dst([&](const TileSet &tileset, const StoredTileset &tilesetInfo
+                 , const AddOptions &ao) -> TileSet
     {
-        if (addOptions.dryRun) { return tileset; }
+        if (ao.dryRun) { return tileset; }
 
         // lock tileset when cloning
         ScopedStorageLock tsLock
             (&storageLock, lockName(tilesetInfo.tilesetId));
 
+        const auto path(tx.addTileset(tilesetInfo.tilesetId));
+
+        // try to adopt tileset's data if allowed; filtered tileset must be
+        // cloned
+        if ((ao.adopt != AddOptions::Adopt::copy)
+            && !ao.filter.lodRange()
+            && !ao.filter.spatialFilter()
+            && linkTileSet(path, tileset, tilesetInfo.tilesetId
+                           , (ao.adopt == AddOptions::Adopt::move)))
+        {
+            return openTileSet(path, ao.openOptions);
+        }
+
         // create tileset at work path (overwrite any existing stuff here)
         // NB: we have to clone original tileset's content as-is!
-        return cloneTileSet(tx.addTileset(tilesetInfo.tilesetId), tileset
+        return cloneTileSet(path, tileset
                             , CloneOptions()
                             .mode(CreateMode::overwrite)
                             .sameType(true)
                             .tilesetId(tilesetInfo.tilesetId)
-                            .lodRange(addOptions.filter.lodRange())
-                            .openOptions(addOptions.openOptions)
+                            .lodRange(ao.filter.lodRange())
+                            .spatialFilter(ao.filter.spatialFilter())
+                            .openOptions(ao.openOptions)
+                            .contentStore(contentStore(tx.root(), ao))
                             );
-    }());
+    });
 
-    auto tilesets(openTilesets(tx, nProperties.tilesets
-                               , dst, tilesetInfo.tilesetId));
+    AddedTilesets added;
+    for (std::size_t i(0), e(entries.size()); i != e; ++i) {
+        added.insert(AddedTilesets::value_type
+                     (tilesetInfos[i].tilesetId
+                      , dst(tilesets[i], tilesetInfos[i]
+                            , entries[i].addOptions)));
+    }
+
+    auto tsets(openTilesets(tx, nProperties.tilesets, added));
 
-    auto gds(prepareGlues(tx, nProperties, tilesets));
+    // plan all glues at once against the final stack
+    auto gds(prepareGlues(tx, nProperties, tsets));
 
     // dry run -> do nothing
     if (addOptions.dryRun) { return; }
 
     writePendingGlues(nProperties, gds);
 
+    // source tilesets are consumed by the storage in move mode
+    auto dropSources([&]()
+    {
+        for (std::size_t i(0), e(entries.size()); i != e; ++i) {
+            if (entries[i].addOptions.adopt != AddOptions::Adopt::move) {
+                continue;
+            }
+
+            const auto &tileset(tilesets[i]);
+            LOG(info3) << "Removing adopted tileset <" << tileset.id()
+                       << "> from " << tileset.root() << ".";
+            rmrf(tileset.root());
+        }
+    });
+
     if (addOptions.mode != AddOptions::Mode::legacy) {
         // new interface: commit new properties and changes to transaction
         saveConfig(nProperties);
         tx.commit();
+        dropSources();
     }
 
     // lazy add? wrap it here
@@ -1176,6 +1644,7 @@ void Storage::Detail::add(const TileSet &tileset, const Location &where
         // old interface: flush and done
         saveConfig(nProperties);
         tx.commit();
+        dropSources();
     }
 }
 
@@ -1258,6 +1727,17 @@ void Storage::Detail::remove(const TilesetIdList &tilesetIds)
     // (re)load config to have fresh copy when under lock
     if (storageLock) { loadConfig(); }
 
+    // pending glues to be dropped (may have content generated on demand)
+    Glue::IdSet pendingGlues;
+    for (const auto &glueId : properties.pendingGlues) {
+        for (const auto &tilesetId : tilesetIds) {
+            if (Glue::references(glueId, tilesetId)) {
+                pendingGlues.insert(glueId);
+                break;
+            }
+        }
+    }
+
     Properties nProperties;
     Glue::map glues;
     VirtualSurface::map virtualSurfaces;
@@ -1286,6 +1766,55 @@ void Storage::Detail::remove(const TilesetIdList &tilesetIds)
         rmrf(path);
     }
 
+    for (const auto &glueId : pendingGlues) {
+        rmrf(storage_paths::onDemandGluePath(root, glueId));
+    }
+
+    for (const auto &item : virtualSurfaces) {
+        const auto &virtualSurface(item.second);
+        auto path(storage_paths::virtualSurfacePath(root, virtualSurface));
+        LOG(info3) << "Removing virtual surface <"
+                   << utility::join(virtualSurface.id, ",")
+                   << "> from " << virtualSurface.path << ".";
+        rmrf(path);
+    }
+}
+
+void Storage::Detail::reorder(const TilesetIdList &tilesetIds
+                              , const Location &where)
+{
+    // (re)load config to have fresh copy when under lock
+    if (storageLock) { loadConfig(); }
+
+    Properties nProperties;
+    Glue::map glues;
+    VirtualSurface::map virtualSurfaces;
+    Glue::IdSet pendingGlues;
+    std::tie(nProperties, glues, virtualSurfaces, pendingGlues)
+        = reorderTilesets(properties, tilesetIds, where);
+
+    LOG(info3)
+        << "Reordering tilesets <" << utility::join(tilesetIds, ", ")
+        << ">; " << glues.size() << " glue(s) invalidated, "
+        << nProperties.pendingGlues.size() << " glue(s) pending.";
+
+    properties = nProperties;
+    saveConfig();
+
+    // physical removal (failure doesn't corrupt the configuration)
+    for (const auto &item : glues) {
+        const auto &glue(item.second);
+        auto path(storage_paths::gluePath(root, glue));
+        LOG(info3) << "Removing glue <" << utility::join(glue.id, ",")
+                   << "> from " << glue.path << ".";
+        rmrf(path);
+    }
+
+    // content generated on demand is bound to old glue ID
+    for (const auto &glueId : pendingGlues) {
+        rmrf(storage_paths::onDemandGluePath(root, glueId));
+    }
+
     for (const auto &item : virtualSurfaces) {
         const auto &virtualSurface(item.second);
         auto path(storage_paths::virtualSurfacePath(root, virtualSurface));
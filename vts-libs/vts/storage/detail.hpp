@@ -255,6 +255,11 @@ struct Storage::Detail
     void add(const TileSet &tileset, const Location &where
              , const TilesetId &tilesetId, const AddOptions &addOptions);
 
+    /** Batch add. Entries' tileset IDs are already resolved, tilesets are
+     *  open (same order as entries).
+     */
+    void add(const TileSet::list &tilesets, const AddEntry::list &entries);
+
     void generateGlues(const TilesetId &tilesetId
                        , const AddOptions &addOptions);
 
@@ -263,6 +268,8 @@ struct Storage::Detail
 
     void remove(const TilesetIdList &tilesetIds);
 
+    void reorder(const TilesetIdList &tilesetIds, const Location &where);
+
     void createVirtualSurface( const TilesetIdSet &tilesets
                              , const CloneOptions &createOptions);
 
@@ -289,6 +296,16 @@ struct Storage::Detail
                           , const VirtualSurface::Ids &ids)
         const;
 
+    /** Moves given tilesets in properties and returns new properties, list
+     *  of invalidated glues and virtual surfaces and set of pending glues
+     *  that changed their ID.
+     */
+    std::tuple<Properties, Glue::map, VirtualSurface::map, Glue::IdSet>
+    reorderTilesets(const Properties &properties
+                    , const TilesetIdList &tilesetIds
+                    , const Location &where)
+        const;
+
     bool externallyChanged() const;
 
     void updateTags(const TilesetId &tilesetId, const Tags &add
@@ -0,0 +1,324 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <map>
+#include <mutex>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "utility/streams.hpp"
+#include "utility/path.hpp"
+
+#include "../../vts.hpp"
+#include "../gluegenerator.hpp"
+#include "../tileset/driver.hpp"
+#include "./detail.hpp"
+#include "./paths.hpp"
+
+namespace fs = boost::filesystem;
+
+namespace vtslibs { namespace vts {
+
+namespace {
+
+const std::string DoneIndexName("ondemand.index");
+
+inline std::string glueId2path(const Glue::Id &id)
+{
+    return boost::lexical_cast<std::string>(utility::join(id, "_"));
+}
+
+/** Loads index of already generated metatiles (shrinked metatile IDs).
+ */
+TileIndex loadDone(const fs::path &path)
+{
+    TileIndex done;
+    if (exists(path)) { done.load(path); }
+    return done;
+}
+
+/** Saves index of generated metatiles atomically (write + rename) so that
+ *  crash cannot leave it half-written.
+ */
+void saveDone(const TileIndex &done, const fs::path &path)
+{
+    const auto tmp(utility::addExtension(path, ".tmp"));
+    done.save(tmp);
+    fs::rename(tmp, path);
+}
+
+/** On-demand state of single pending glue.
+ */
+struct GlueState {
+    typedef std::shared_ptr<GlueState> pointer;
+
+    /** Guards state members.
+     */
+    std::mutex mutex;
+
+    /** Serializes generation of glue content.
+     */
+    std::mutex generating;
+
+    bool initialized;
+
+    /** Storage revision this state has been prepared for.
+     */
+    unsigned int revision;
+
+    /** Glue root.
+     */
+    fs::path path;
+
+    /** Glued tilesets, in glue order.
+     */
+    TileSet::list sets;
+
+    /** Glue generate set, computed only once.
+     */
+    TileSet::GlueGenerateSet generateSet;
+
+    /** Already generated metatiles.
+     */
+    TileIndex done;
+
+    /** Driver for already generated content.
+     */
+    Driver::pointer driver;
+
+    GlueState() : initialized(false), revision() {}
+};
+
+class StorageGlueGenerator : public GlueGenerator {
+public:
+    StorageGlueGenerator(const GlueCreationOptions &options
+                         , const StorageLocker::pointer &locker)
+        : options_(options), locker_(locker)
+    {
+        // there is no reasonable way to report progress of on-demand
+        // generation
+        options_.progress.reset();
+    }
+
+    virtual TileIndex expected(const Storage &storage
+                               , const Glue::Id &glueId);
+
+    virtual Driver::pointer generate(const Storage &storage
+                                     , const Glue::Id &glueId
+                                     , const TileId &metaId);
+
+private:
+    /** Returns state of given glue. State is prepared anew when storage
+     *  revision changes; previous state stays alive while in use.
+     */
+    GlueState::pointer state(const Storage &storage, const Glue::Id &glueId);
+
+    void generate(GlueState &state, const TileId &metaId, bool create);
+
+    GlueCreationOptions options_;
+    StorageLocker::pointer locker_;
+
+    std::mutex mutex_;
+    std::map<fs::path, GlueState::pointer> states_;
+};
+
+GlueState::pointer StorageGlueGenerator::state(const Storage &storage
+                                               , const Glue::Id &glueId)
+{
+    const auto path(storage_paths::onDemandGluePath(storage.path(), glueId));
+    const auto revision(storage.detail().properties.revision);
+
+    GlueState::pointer gs;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto &slot(states_[path]);
+        if (slot && (slot->revision != revision)) {
+            // storage has changed, forget cached state
+            LOG(info2) << "Storage revision changed, dropping state of "
+                       << "on-demand glue <" << utility::join(glueId, ",")
+                       << ">.";
+            slot.reset();
+        }
+        if (!slot) {
+            slot = std::make_shared<GlueState>();
+            slot->revision = revision;
+        }
+        gs = slot;
+    }
+
+    std::unique_lock<std::mutex> lock(gs->mutex);
+    if (gs->initialized) { return gs; }
+
+    LOG(info3) << "Preparing on-demand glue <"
+               << utility::join(glueId, ",") << ">.";
+
+    gs->path = path;
+    TileSet::list sets;
+    for (const auto &tilesetId : glueId) {
+        sets.push_back(storage.open(tilesetId));
+    }
+
+    gs->generateSet = TileSet::glueGenerateSet(sets, options_);
+    gs->sets = std::move(sets);
+    gs->done = loadDone(path / DoneIndexName);
+    if (!gs->done.empty()) { gs->driver = Driver::open(path); }
+    gs->initialized = true;
+
+    return gs;
+}
+
+TileIndex StorageGlueGenerator::expected(const Storage &storage
+                                         , const Glue::Id &glueId)
+{
+    typedef TileIndex::Flag TiFlag;
+    const auto state(this->state(storage, glueId));
+    const auto &gs(state->generateSet);
+
+    // every generated tile has mesh and atlas
+    TileIndex ti(gs.mesh);
+    ti.translate([](QTree::value_type value) -> QTree::value_type
+    {
+        return value ? (TiFlag::mesh | TiFlag::atlas) : 0;
+    });
+
+    // add navtiles
+    ti.combine(gs.navtile, [](QTree::value_type o, QTree::value_type n)
+               -> QTree::value_type
+    {
+        return n ? (o | TiFlag::navtile) : o;
+    });
+
+    return ti;
+}
+
+void StorageGlueGenerator::generate(GlueState &state, const TileId &metaId
+                                    , bool create)
+{
+    const auto &sets(state.sets);
+    const auto &gs(state.generateSet);
+    const auto mbo(sets.front().referenceFrame().metaBinaryOrder);
+
+    // constrain generate sets to given metatile
+    // NB: block must cover all LODs of generate sets to intersect properly
+    Lod maxLod(metaId.lod);
+    if (!gs.mesh.empty()) { maxLod = std::max(maxLod, gs.mesh.maxLod()); }
+    if (!gs.navtile.empty()) {
+        maxLod = std::max(maxLod, gs.navtile.maxLod());
+    }
+
+    TileIndex block(LodRange(0, maxLod));
+    {
+        const TileId::index_type limit((1u << metaId.lod) - 1);
+        const TileId::index_type size(1u << mbo);
+        block.set(metaId.lod
+                  , TileRange(metaId.x, metaId.y
+                              , std::min(limit, metaId.x + size - 1)
+                              , std::min(limit, metaId.y + size - 1))
+                  , 1);
+    }
+
+    TileSet::GlueGenerateSet constrained;
+    constrained.mesh = gs.mesh.intersect(block);
+    constrained.navtile = gs.navtile.intersect(block);
+
+    auto glue([&]() -> TileSet
+    {
+        if (!create) {
+            return openTileSet(state.path, OpenOptions()
+                               .openMode(OpenMode::readWrite));
+        }
+
+        TileSetProperties props;
+        props.id = state.path.filename().string();
+        props.referenceFrame = sets.front().getProperties().referenceFrame;
+        return createTileSet(state.path, props, CreateMode::overwrite);
+    }());
+
+    if (!constrained.empty()) {
+        TileSet::createGlue(glue, sets, constrained, options_);
+    }
+
+    glue.flush();
+}
+
+Driver::pointer StorageGlueGenerator::generate(const Storage &storage
+                                               , const Glue::Id &glueId
+                                               , const TileId &metaId)
+{
+    const auto state(this->state(storage, glueId));
+    auto &gs(*state);
+
+    const auto mbo(storage.referenceFrame().metaBinaryOrder);
+    const TileId doneId(metaId.lod, metaId.x >> mbo, metaId.y >> mbo);
+
+    // fast path: already generated
+    {
+        std::unique_lock<std::mutex> lock(gs.mutex);
+        if (gs.driver && gs.done.get(doneId)) { return gs.driver; }
+    }
+
+    std::unique_lock<std::mutex> generating(gs.generating);
+
+    // lock glue in the storage (shared with regular glue generation)
+    ScopedStorageLock glueLock(locker_, glueId2path(glueId));
+
+    // re-load list of generated metatiles since another process may have
+    // generated this metatile in the meantime
+    const auto donePath(gs.path / DoneIndexName);
+    const bool create(!exists(donePath));
+    auto done(loadDone(donePath));
+
+    if (!done.get(doneId)) {
+        LOG(info3) << "Generating metatile " << metaId
+                   << " of on-demand glue <"
+                   << utility::join(glueId, ",") << ">.";
+        generate(gs, metaId, create);
+
+        done.set(doneId, 1);
+        saveDone(done, donePath);
+    }
+
+    auto driver(Driver::open(gs.path));
+
+    std::unique_lock<std::mutex> lock(gs.mutex);
+    gs.done = std::move(done);
+    gs.driver = driver;
+    return driver;
+}
+
+} // namespace
+
+GlueGenerator::pointer
+createGlueGenerator(const GlueCreationOptions &options
+                    , const StorageLocker::pointer &locker)
+{
+    return std::make_shared<StorageGlueGenerator>(options, locker);
+}
+
+} } // namespace vtslibs::vts
@@ -34,8 +34,11 @@
 #define vtslibs_vts_storage_paths_hpp_included_
 
 #include <boost/optional.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/filesystem/path.hpp>
 
+#include "utility/streams.hpp"
+
 #include "../storage.hpp"
 
 namespace vtslibs { namespace vts { namespace storage_paths {
@@ -60,6 +63,14 @@ inline boost::filesystem::path glueRulesPath() { return "glue.rules"; }
  */
 inline boost::filesystem::path mergeConfPath() { return "merge.conf"; }
 
+/** Get root of content-addressed store shared by deduplicated tilesets.
+ */
+inline boost::filesystem::path contentStoreRoot() { return "content"; }
+
+/** Get root for pending glues generated on demand.
+ */
+inline boost::filesystem::path onDemandGlueRoot() { return "glues.ondemand"; }
+
 /** Generate path for storage tileset. If tmp is false regular storage path is
  *  generated.
  *  Otherwise root / "tmp" is used unless different tmpRoot is provided.
@@ -91,6 +102,11 @@ virtualSurfacePath(const boost::filesystem::path &root
                    , const boost::optional<boost::filesystem::path> &tmpRoot
                    = boost::none);
 
+/** Generate path for pending glue generated on demand.
+ */
+boost::filesystem::path
+onDemandGluePath(const boost::filesystem::path &root, const Glue::Id &glueId);
+
 // inlines
 
 inline boost::filesystem::path
@@ -139,6 +155,13 @@ virtualSurfacePath(const boost::filesystem::path &root
     return root / virtualSurfaceRoot() / virtualSurface.path;
 }
 
+inline boost::filesystem::path
+onDemandGluePath(const boost::filesystem::path &root, const Glue::Id &glueId)
+{
+    return (root / onDemandGlueRoot()
+            / boost::lexical_cast<std::string>(utility::join(glueId, "_")));
+}
+
 } } } // namespace vtslibs::vts::storage_paths
 
 #endif // vtslibs_vts_storage_paths_hpp_included_
@@ -0,0 +1,126 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/texturequality.hpp
+ *
+ * Adaptive texture quality settings.
+ */
+
+#ifndef vtslibs_vts_texturequality_hpp_included_
+#define vtslibs_vts_texturequality_hpp_included_
+
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <iostream>
+
+namespace vtslibs { namespace vts {
+
+/** Accumulated results of adaptive texture encoding. Thread safe.
+ */
+class EncodeReport {
+public:
+    typedef std::shared_ptr<EncodeReport> pointer;
+
+    EncodeReport()
+        : count_(), passes_(), bytes_(), quality_(), psnr_()
+        , minPsnr_(std::numeric_limits<double>::infinity())
+    {}
+
+    /** Records one encoded texture.
+     */
+    void add(int quality, double psnr, int passes, std::size_t bytes);
+
+    /** Dumps report in human readable form.
+     */
+    void dump(std::ostream &os) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::size_t count_;
+    std::size_t passes_;
+    std::size_t bytes_;
+    double quality_;
+    double psnr_;
+    double minPsnr_;
+};
+
+/** Adaptive JPEG quality: every texture is encoded with the lowest quality
+ *  from [minQuality, maxQuality] that keeps PSNR against the source texture at
+ *  or above targetPsnr. Quality is found by bisection using at most maxPasses
+ *  encode/decode passes; maxQuality is used when the target is not met.
+ *
+ *  Achieved quality and PSNR are recorded in report (if any).
+ */
+struct AdaptiveQuality {
+    int minQuality;
+    int maxQuality;
+    double targetPsnr;
+    int maxPasses;
+    EncodeReport::pointer report;
+
+    AdaptiveQuality()
+        : minQuality(40), maxQuality(95), targetPsnr(40.0), maxPasses(4)
+    {}
+};
+
+// inlines
+
+inline void EncodeReport::add(int quality, double psnr, int passes
+                              , std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++count_;
+    passes_ += passes;
+    bytes_ += bytes;
+    quality_ += quality;
+    psnr_ += psnr;
+    if (psnr < minPsnr_) { minPsnr_ = psnr; }
+}
+
+inline void EncodeReport::dump(std::ostream &os) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    os << "textures: " << count_ << ", bytes: " << bytes_;
+    if (!count_) { return; }
+    os << ", average quality: " << (quality_ / count_)
+       << ", average PSNR: " << (psnr_ / count_) << " dB"
+       << ", minimum PSNR: " << minPsnr_ << " dB"
+       << ", average passes: " << (double(passes_) / count_);
+}
+
+template<typename CharT, typename Traits>
+inline std::basic_ostream<CharT, Traits>&
+operator<<(std::basic_ostream<CharT, Traits> &os, const EncodeReport &r)
+{
+    r.dump(os);
+    return os;
+}
+
+} } // namespace vtslibs::vts
+
+#endif // vtslibs_vts_texturequality_hpp_included_
@@ -54,6 +54,9 @@ namespace {
     const std::string DebugMaskExt("mask.dbg");
     const std::string DebugMetaExt("meta.dbg");
 
+    const std::string HalfAtlasExt("half.jpg");
+    const std::string QuarterAtlasExt("quarter.jpg");
+
     inline const std::string& extension(TileFile type, FileFlavor flavor)
     {
         switch (type) {
@@ -62,6 +65,8 @@ namespace {
             case FileFlavor::regular: return MetaExt;
             case FileFlavor::raw: break;
             case FileFlavor::debug: return DebugMetaExt;
+            case FileFlavor::half: break;
+            case FileFlavor::quarter: break;
             }
             break;
         case TileFile::mesh:
@@ -69,6 +74,8 @@ namespace {
             case FileFlavor::regular: return MeshExt;
             case FileFlavor::raw: return RawMeshExt;
             case FileFlavor::debug: break;
+            case FileFlavor::half: break;
+            case FileFlavor::quarter: break;
             }
             break;
         case TileFile::atlas:
@@ -76,6 +83,8 @@ namespace {
             case FileFlavor::regular: return AtlasExt;
             case FileFlavor::raw: return RawAtlasExt;
             case FileFlavor::debug: break;
+            case FileFlavor::half: return HalfAtlasExt;
+            case FileFlavor::quarter: return QuarterAtlasExt;
             }
             break;
         case TileFile::navtile:
@@ -83,6 +92,8 @@ namespace {
             case FileFlavor::regular: return NavTileExt;
             case FileFlavor::raw: return RawNavTileExt;
             case FileFlavor::debug: break;
+            case FileFlavor::half: break;
+            case FileFlavor::quarter: break;
             }
             break;
         case TileFile::meta2d: return Meta2dExt;
@@ -91,6 +102,8 @@ namespace {
             case FileFlavor::regular: return MaskExt;
             case FileFlavor::raw: break;
             case FileFlavor::debug: return DebugMaskExt;
+            case FileFlavor::half: break;
+            case FileFlavor::quarter: break;
             }
             break;
         case TileFile::ortho: return OrthoExt;
@@ -148,6 +161,17 @@ namespace {
         HANDLE_EXT(DebugMaskExt, mask)
 #undef HANDLE_EXT
 
+#define HANDLE_EXT(EXT, TYPE, FLAVOR)           \
+        if (!EXT.compare(p)) {                  \
+            type = TileFile::TYPE;              \
+            *flavor = FileFlavor::FLAVOR;       \
+            return p + EXT.size();              \
+        }
+
+        HANDLE_EXT(HalfAtlasExt, atlas, half)
+        HANDLE_EXT(QuarterAtlasExt, atlas, quarter)
+#undef HANDLE_EXT
+
         return nullptr;
     }
 
@@ -162,7 +186,9 @@ namespace {
                 switch (type) {
                 case TileFile::atlas:
                 case TileFile::ortho:
-                    return !(flavor && (*flavor != FileFlavor::regular));
+                    // raw files are whole archives, reduced atlas
+                    // variants are still served per image
+                    return !(flavor && (*flavor == FileFlavor::raw));
                     break;
 
                 default: break;
@@ -158,6 +158,21 @@ public:
      */
     void setSurrogateValue(const TileId &tileId, float value);
 
+    /** Removes tile's content. Node is kept as a virtual one if it has any
+     *  children. Tile data stay in the underlying storage until compacted.
+     */
+    void removeTile(const TileId &tileId);
+
+    /** Removes whole subtree rooted at given tile. Tile data stay in the
+     *  underlying storage until compacted.
+     */
+    void removeSubtree(const TileId &tileId);
+
+    /** Replaces whole subtree rooted at given tile with the content of the
+     *  same subtree in the source tileset.
+     */
+    void replaceSubtree(const TileId &tileId, const TileSet &src);
+
     /** Returns tile's metanode.
      */
     MetaNode getMetaNode(const TileId &tileId) const;
@@ -288,9 +303,14 @@ public:
     bool canContain(const NodeInfo &nodeInfo) const;
 
     /** Pastes other tileset into this one.
+     *
+     *  Only tiles from given LOD range and/or matching given spatial filter
+     *  are pasted.
      */
     void paste(const TileSet &src
-               , const boost::optional<LodRange> &lodRange = boost::none);
+               , const boost::optional<LodRange> &lodRange = boost::none
+               , const boost::optional<SpatialFilter> &spatialFilter
+               = boost::none);
 
     /** Returns type information.
      */
@@ -379,6 +399,47 @@ public:
     static void createGlue(TileSet &glue, const list &sets
                            , const GlueCreationOptions &options);
 
+    /** Tiles to be generated in glue.
+     */
+    struct GlueGenerateSet {
+        /** Mesh/atlas generate set.
+         */
+        TileIndex mesh;
+
+        /** Navtile generate set.
+         */
+        TileIndex navtile;
+
+        bool empty() const { return mesh.empty(); }
+    };
+
+    /** Calculates glue generate set for given sets.
+     *
+     * \param sets input tilesets
+     * \param options glue creation options
+     *
+     *  Priority grows from left to right.
+     */
+    static GlueGenerateSet glueGenerateSet(const list &sets
+                                           , const GlueCreationOptions
+                                           &options);
+
+    /** Creates glue from given sets using precalculated generate set.
+     *
+     *  Only tiles from generate set are stored in the glue; any existing
+     *  content of glue tileset is kept intact. Generate set can be a subset
+     *  of one returned by glueGenerateSet (i.e. glue can be generated
+     *  piece-by-piece).
+     *
+     * \param glue output tileset for glue tiles
+     * \param sets input tilesets
+     * \param generateSet generate set
+     * \param options glue creation options
+     */
+    static void createGlue(TileSet &glue, const list &sets
+                           , const GlueGenerateSet &generateSet
+                           , const GlueCreationOptions &options);
+
     /** Glue statistics returned by analyzeGlue.
      */
     struct GlueStatistics {
@@ -122,6 +122,28 @@ driver::PlainOptions parsePlainDriver(const Json::Value &value)
     Json::get(uuid, value, "uuid");
     driverOptions.uuid(boost::uuids::string_generator()(uuid));
 
+    if (value.isMember("contentStore")) {
+        std::string contentStore;
+        Json::get(contentStore, value, "contentStore");
+        driverOptions.contentStore(boost::filesystem::path(contentStore));
+    }
+
+    if (value.isMember("reclaimSpace")) {
+        bool reclaimSpace;
+        Json::get(reclaimSpace, value, "reclaimSpace");
+        driverOptions.reclaimSpace(reclaimSpace);
+    }
+
+    if (value.isMember("checksums")) {
+        bool checksums;
+        Json::get(checksums, value, "checksums");
+        driverOptions.checksums(checksums);
+    }
+
+    if (value.isMember("preallocate")) {
+        driverOptions.preallocate(value["preallocate"].asUInt64());
+    }
+
     return driverOptions;
 }
 
@@ -178,6 +200,24 @@ driver::LocalOptions parseLocalDriver(const Json::Value &value)
     return driverOptions;
 }
 
+driver::BundleOptions parseBundleDriver(const Json::Value&)
+{
+    return {};
+}
+
+driver::MemoryOptions parseMemoryDriver(const Json::Value &value)
+{
+    driver::MemoryOptions driverOptions;
+
+    if (value.isMember("budget")) {
+        driverOptions.budget = value["budget"].asUInt64();
+    }
+
+    driverOptions.spill = parsePlainDriver(value["spill"]);
+
+    return driverOptions;
+}
+
 boost::any parseDriver(const Json::Value &value)
 {
     // support for driver-less tileset (using by remote definition)
@@ -205,6 +245,10 @@ boost::any parseDriver(const Json::Value &value)
         return parseRemoteDriver(value);
     } else if (type == "local") {
         return parseLocalDriver(value);
+    } else if (type == "bundle") {
+        return parseBundleDriver(value);
+    } else if (type == "memory") {
+        return parseMemoryDriver(value);
     }
 
     LOGTHROW(err1, Json::Error)
@@ -217,6 +261,14 @@ void buildDriver(const driver::PlainOptions &options, Json::Value &value)
     value["binaryOrder"] = options.binaryOrder();
     value["metaUnusedBits"] = options.metaUnusedBits();
     value["uuid"] = to_string(options.uuid());
+    if (const auto &contentStore = options.contentStore()) {
+        value["contentStore"] = contentStore->string();
+    }
+    if (options.reclaimSpace()) { value["reclaimSpace"] = true; }
+    if (options.checksums()) { value["checksums"] = true; }
+    if (const auto preallocate = options.preallocate()) {
+        value["preallocate"] = Json::UInt64(preallocate);
+    }
 }
 
 Json::Value buildDriver(const boost::any &d)
@@ -259,6 +311,16 @@ Json::Value buildDriver(const boost::any &d)
         value["type"] = "local";
         value["path"] = opts->path.string();
         return value;
+    } else if (boost::any_cast<const driver::BundleOptions>(&d)) {
+        value["type"] = "bundle";
+        return value;
+    } else if (auto opts = boost::any_cast
+               <const driver::MemoryOptions>(&d))
+    {
+        value["type"] = "memory";
+        value["budget"] = Json::UInt64(opts->budget);
+        buildDriver(opts->spill, value["spill"] = Json::objectValue);
+        return value;
     }
 
     LOGTHROW(err1, Json::Error)
@@ -28,6 +28,8 @@
 
 #include <memory>
 
+#include <vector>
+
 #include <boost/noncopyable.hpp>
 
 #include "../../storage/streams.hpp"
@@ -67,6 +69,24 @@ public:
                            , FileFlavor flavor
                            , const NullWhenNotFound_t&) const;
 
+    /** Batched tile file access. Returns streams in request order, missing
+     *  files are returned as null pointers. Files served directly by the
+     *  driver are fetched in one batch (grouped by archive where supported),
+     *  generated files are handled one by one.
+     */
+    std::vector<IStream::pointer> input(const TileFileRequest::list &files
+                                        , const NullWhenNotFound_t&) const;
+
+    /** Batched tile file access packed into single framed stream:
+     *
+     *      header: magic "VB", uint16 version (1), uint32 file count
+     *      file:   uint8 found flag, uint8 content type length,
+     *              content type, uint32 size, data
+     *
+     *  Files follow request order. All numbers are little-endian.
+     */
+    IStream::pointer bundle(const TileFileRequest::list &files) const;
+
     FileStat stat(File type) const;
 
     FileStat stat(const TileId &tileId, TileFile type) const;
@@ -91,9 +111,14 @@ public:
 private:
     struct AccessToken {};
 
+    /** Bounded cache of generated reduced-resolution atlas variants.
+     */
+    struct AtlasVariants;
+
     std::shared_ptr<Driver> driver_;
     const FullTileSetProperties properties_;
     std::shared_ptr<tileset::Index> index_;
+    std::shared_ptr<AtlasVariants> atlasVariants_;
 
 public:
     /** Opens storage.
@@ -117,6 +117,11 @@ public:
     mutable bool metadataChanged;   // marks that metadata have been changed
     bool changed() const { return metadataChanged || propertiesChanged; }
 
+    /** Existing tileset opened for in-place update: revision is bumped by
+     *  first flush with any changes.
+     */
+    bool bumpRevision;
+
     registry::ReferenceFrame referenceFrame;
 
     mutable std::unique_ptr<MetaCache> metaTiles;
@@ -163,6 +168,14 @@ public:
 
     void setSurrogateValue(const TileId &tileId, float value);
 
+    void removeTile(const TileId &tileId);
+
+    /** Returns number of removed tiles.
+     */
+    std::size_t removeSubtree(const TileId &tileId);
+
+    void replaceSubtree(const TileId &tileId, const Detail &src);
+
     std::uint8_t metaOrder() const;
     TileId metaId(TileId tileId) const;
 
@@ -250,6 +263,17 @@ private:
                           , const MetaNode &oldMetanode);
     void updateProperties(const NodeInfo &nodeInfo);
     void updateProperties(const Mesh &mesh);
+
+    /** Builds virtual node with given children; extents are merged from
+     *  children's extents.
+     */
+    MetaNode virtualNode(const TileId &tileId
+                         , MetaNode::Flag::value_type childFlags) const;
+
+    /** Fixes nodes above (removed/changed) tile: unlinks removed node, drops
+     *  childless virtual nodes and shrinks virtual nodes' extents.
+     */
+    void updateAncestors(TileId tileId, bool unlink);
 };
 
 inline void TileSet::Detail::checkValidity() const {
@@ -29,6 +29,8 @@
 #include <set>
 #include <map>
 #include <memory>
+#include <vector>
+#include <functional>
 
 #include <boost/noncopyable.hpp>
 
@@ -123,6 +125,13 @@ public:
     IStream::pointer input(const TileId &tileId, TileFile type
                            , const NullWhenNotFound_t&) const;
 
+    /** Reads multiple tile files at once. Streams are returned in request
+     *  order, missing files are returned as null pointers. File flavor is
+     *  ignored.
+     */
+    std::vector<IStream::pointer> input(const TileFileRequest::list &files
+                                        , const NullWhenNotFound_t&) const;
+
     FileStat stat(File type) const;
 
     FileStat stat(const TileId &tileId, TileFile type) const;
@@ -142,6 +151,17 @@ public:
 
     Resources resources() const;
 
+    /** Tile file listing callback.
+     */
+    typedef std::function<void(const TileId &tileId, TileFile type)>
+        TileFileOp;
+
+    /** Calls op for every tile file physically stored by the driver, tile
+     *  index is not consulted. Used to recover lost tile index.
+     *  Throws if not supported by the driver.
+     */
+    void listTileFiles(const TileFileOp &op) const;
+
     void flush();
 
     bool externallyChanged() const;
@@ -263,6 +283,13 @@ private:
     input_impl(const TileId &tileId, TileFile type
                , const NullWhenNotFound_t&) const = 0;
 
+    /** Batched tile file read. Optional, defaults to one input_impl call per
+     *  file.
+     */
+    virtual std::vector<IStream::pointer>
+    input_impl(const TileFileRequest::list &files
+               , const NullWhenNotFound_t&) const;
+
     virtual void drop_impl() = 0;
 
     virtual void flush_impl() = 0;
@@ -287,6 +314,10 @@ private:
 
     virtual Resources resources_impl() const = 0;
 
+    /** Physical tile file listing. Optional.
+     */
+    virtual void listTileFiles_impl(const TileFileOp &op) const;
+
     virtual pointer clone_impl(const boost::filesystem::path &root
                                , const CloneOptions &cloneOptions) const = 0;
 
@@ -410,6 +441,14 @@ inline IStream::pointer Driver::input(const TileId &tileId, TileFile type
     return input_impl(tileId, type, NullWhenNotFound);
 }
 
+inline std::vector<IStream::pointer>
+Driver::input(const TileFileRequest::list &files
+              , const NullWhenNotFound_t&) const
+{
+    checkRunning();
+    return input_impl(files, NullWhenNotFound);
+}
+
 inline FileStat Driver::stat(File type) const
 {
     checkRunning();
@@ -427,6 +466,12 @@ inline storage::Resources Driver::resources() const
     return resources_impl();
 }
 
+inline void Driver::listTileFiles(const TileFileOp &op) const
+{
+    checkRunning();
+    return listTileFiles_impl(op);
+}
+
 inline void Driver::drop()
 {
     checkRunning();
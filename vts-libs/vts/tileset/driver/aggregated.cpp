@@ -183,7 +183,12 @@ void addTileIndex(unsigned int metaBinaryOrder
 
     // process tileindex
     tileset::Index work(metaBinaryOrder);
-    tileset::loadTileSetIndex(work, *de.driver);
+    if (de.onDemand) {
+        // glue not generated yet, use its estimated tile index
+        work.tileIndex = de.onDemand->expected();
+    } else {
+        tileset::loadTileSetIndex(work, *de.driver);
+    }
     ti.combine(work.tileIndex, combiner);
 
     // derive metatile index from tileset's tile index
@@ -277,6 +282,13 @@ buildMeta(const AggregatedDriver::DriverEntry::list &drivers
         }, QTree::Filter::white);
     }
 
+    // metatiles loaded since first on-demand glue; tile index of on-demand
+    // glue is just an estimate and these serve as a fallback for nodes the
+    // generated glue doesn't contain
+    typedef std::pair<MetaNode::SourceReference, MetaTile> FallbackMeta;
+    std::vector<FallbackMeta> fallback;
+    bool onDemand(false);
+
     // start from zero so first round gets 1
     int idx(0);
     for (const auto &de : drivers) {
@@ -287,7 +299,42 @@ buildMeta(const AggregatedDriver::DriverEntry::list &drivers
         if (!de.metaIndex.get(shrinkedId)) { continue; }
 
         // load metatile from this tileset and update output metatile
-        ometa.update(idx, loadMeta(tileId, de.driver));
+        auto meta(loadMeta(tileId, de.get(tileId)));
+        ometa.update(idx, meta);
+
+        onDemand |= bool(de.onDemand);
+        if (onDemand) { fallback.emplace_back(idx, std::move(meta)); }
+    }
+
+    if (onDemand) {
+        // redirect nodes missing in on-demand glue to first following
+        // surface containing them
+        bool redirected(false);
+        ometa.for_each([&](const TileId &nodeId, MetaNode &node)
+        {
+            const auto sr(node.sourceReference);
+            if (node.real() || !sr || (sr > drivers.size())
+                || !drivers[sr - 1].onDemand)
+            {
+                return;
+            }
+
+            for (const auto &fm : fallback) {
+                if (fm.first <= sr) { continue; }
+                const auto *fnode(fm.second.get(nodeId, std::nothrow));
+                if (fnode && fnode->real()) {
+                    node.sourceReference = fm.first;
+                    redirected = true;
+                    return;
+                }
+            }
+        });
+
+        if (redirected) {
+            for (const auto &fm : fallback) {
+                ometa.update(fm.first, fm.second);
+            }
+        }
     }
 
     if (ometa.empty()) {
@@ -425,10 +472,17 @@ TileSet::Properties AggregatedDriver::build(AggregatedOptions options
                                             , const CloneOptions &cloneOptions
                                             , bool onDisk)
 {
+    const auto &generator(openOptions().glueGenerator());
+
     auto pendingGlues = storage_.pendingGlues(&options.tilesets);
     if (!pendingGlues.empty()) {
-        LOG(err2) << "Cannot aggregate tilesets: pending glues.";
-        throw PendingGluesError(pendingGlues);
+        if (onDisk || !generator) {
+            LOG(err2) << "Cannot aggregate tilesets: pending glues.";
+            throw PendingGluesError(pendingGlues);
+        }
+
+        LOG(info2) << "Aggregating tilesets with " << pendingGlues.size()
+                   << " pending glue(s); these will be generated on demand.";
     }
 
     TileSet::Properties properties;
@@ -475,6 +529,14 @@ TileSet::Properties AggregatedDriver::build(AggregatedOptions options
                 return true;
             }));
 
+            // add pending glues with this tileset on top; they have no
+            // content yet
+            for (const auto &glueId : pendingGlues) {
+                if (glueId.back() == tilesetId) {
+                    tilesetInfo.back().glues.emplace_back(glueId);
+                }
+            }
+
             // remember tileset in back-map
             backMap.insert(BackMap::value_type
                            (tilesetId, &tilesetInfo.back()));
@@ -582,9 +644,18 @@ TileSet::Properties AggregatedDriver::build(AggregatedOptions options
         for (const auto &glue : tsg.glues) {
             bool alien(glue.id.back() != tsg.tilesetId);
             if (!alien) {
-                drivers_.emplace_back
-                    (Driver::open(storage_.path(glue))
-                     , glue2references(glue.id));
+                if (pendingGlues.count(glue.id)) {
+                    // pending glue: generated on demand
+                    drivers_.emplace_back(Driver::pointer()
+                                          , glue2references(glue.id));
+                    drivers_.back().onDemand
+                        = std::make_shared<OnDemandGlue>
+                        (generator, storage_, glue.id, mbo);
+                } else {
+                    drivers_.emplace_back
+                        (Driver::open(storage_.path(glue))
+                         , glue2references(glue.id));
+                }
 
                 auto &de(drivers_.back());
                 tsMap.push_back(de.tilesets);
@@ -712,12 +783,28 @@ AggregatedDriver::clone_impl(const boost::filesystem::path &root
                              , const CloneOptions &cloneOptions)
     const
 {
+    for (const auto &de : drivers_) {
+        if (de.onDemand) {
+            LOG(err2) << "Cannot clone aggregated tileset: pending glues.";
+            throw PendingGluesError({ de.onDemand->glueId });
+        }
+    }
+
     return std::make_shared<AggregatedDriver>
         (PrivateTag(), root, options(), cloneOptions, *this);
 }
 
 AggregatedDriver::~AggregatedDriver() {}
 
+Driver::pointer
+AggregatedDriver::OnDemandGlue::driver(const TileId &tileId) const
+{
+    const auto mbo(metaBinaryOrder);
+    const TileId metaId(tileId.lod, (tileId.x >> mbo) << mbo
+                        , (tileId.y >> mbo) << mbo);
+    return generator->generate(storage, glueId, metaId);
+}
+
 OStream::pointer AggregatedDriver::output_impl(File type)
 {
     if (readOnly()) {
@@ -823,7 +910,12 @@ IStream::pointer AggregatedDriver::input_impl(const TileId &tileId
 
     // NB: source reference is 1-based
     if (sourceReference && (sourceReference <= drivers_.size())) {
-        return drivers_[sourceReference - 1].driver->input(tileId, type);
+        const auto &de(drivers_[sourceReference - 1]);
+        if (!de.onDemand) { return de.driver->input(tileId, type); }
+
+        if (auto is = onDemandInput(sourceReference, tileId, type)) {
+            return is;
+        }
     }
 
     if (noSuchFile) {
@@ -835,6 +927,45 @@ IStream::pointer AggregatedDriver::input_impl(const TileId &tileId
     return {};
 }
 
+IStream::pointer
+AggregatedDriver::onDemandInput(MetaNode::SourceReference sourceReference
+                                , const TileId &tileId, TileFile type) const
+{
+    const auto mbo(referenceFrame_.metaBinaryOrder);
+    const TileId shrinkedId(tileId.lod, tileId.x >> mbo, tileId.y >> mbo);
+    const TileId metaId(tileId.lod, shrinkedId.x << mbo, shrinkedId.y << mbo);
+
+    // returns driver if its metatile has real node for given tile; loading
+    // glue's metatile generates it if not done yet
+    auto source([&](const DriverEntry &de) -> Driver::pointer
+    {
+        auto driver(de.get(tileId));
+        auto ms(driver->input(metaId, TileFile::meta, NullWhenNotFound));
+        if (!ms) { return {}; }
+
+        const auto meta(loadMetaTile(*ms, mbo, ms->name()));
+        const auto *node(meta.get(tileId, std::nothrow));
+        if (!node || !node->real()) { return {}; }
+        return driver;
+    });
+
+    if (auto driver = source(drivers_[sourceReference - 1])) {
+        return driver->input(tileId, type, NullWhenNotFound);
+    }
+
+    // node is not in the glue; metanode is redirected to following surface
+    for (std::size_t i(sourceReference), e(drivers_.size()); i < e; ++i) {
+        const auto &de(drivers_[i]);
+        if (!de.metaIndex.get(shrinkedId)) { continue; }
+
+        if (auto driver = source(de)) {
+            return driver->input(tileId, type, NullWhenNotFound);
+        }
+    }
+
+    return {};
+}
+
 FileStat AggregatedDriver::stat_impl(File type) const
 {
     const auto name(filePath(type));
@@ -871,7 +1002,12 @@ FileStat AggregatedDriver::stat_impl(const TileId &tileId, TileFile type) const
     const auto sourceReference(sourceReferenceFromFlags(flags));
 
     if (sourceReference && (sourceReference <= drivers_.size())) {
-        return drivers_[sourceReference - 1].driver->stat(tileId, type);
+        const auto &de(drivers_[sourceReference - 1]);
+        if (!de.onDemand) { return de.driver->stat(tileId, type); }
+
+        if (auto is = onDemandInput(sourceReference, tileId, type)) {
+            return is->stat();
+        }
     }
 
     LOGTHROW(err1, vs::NoSuchFile)
@@ -885,6 +1021,8 @@ storage::Resources AggregatedDriver::resources_impl() const
     storage::Resources resources;
     if (cache_) { resources += cache_->resources(); }
     for (const auto &driver : drivers_) {
+        // on-demand glue has no driver until generated
+        if (!driver.driver) { continue; }
         resources += driver.driver->resources();
     }
     return resources;
@@ -32,6 +32,7 @@
 
 #include "../driver.hpp"
 #include "../../storage.hpp"
+#include "../../gluegenerator.hpp"
 #include "./cache.hpp"
 
 namespace vtslibs { namespace vts { namespace driver {
@@ -73,11 +74,42 @@ public:
 
     typedef std::vector<TilesetReferences> TilesetReferencesList;
 
+    /** Pending glue generated on demand.
+     */
+    struct OnDemandGlue {
+        GlueGenerator::pointer generator;
+        const Storage &storage;
+        Glue::Id glueId;
+        unsigned int metaBinaryOrder;
+
+        OnDemandGlue(const GlueGenerator::pointer &generator
+                     , const Storage &storage, const Glue::Id &glueId
+                     , unsigned int metaBinaryOrder)
+            : generator(generator), storage(storage), glueId(glueId)
+            , metaBinaryOrder(metaBinaryOrder)
+        {}
+
+        /** Tiles this glue can contain.
+         */
+        TileIndex expected() const {
+            return generator->expected(storage, glueId);
+        }
+
+        /** Generates metatile containing given tile (if not generated yet)
+         *  and returns driver for generated content.
+         */
+        Driver::pointer driver(const TileId &tileId) const;
+    };
+
     struct DriverEntry {
-        /** Driver.
+        /** Driver. Null for on-demand glue.
          */
         Driver::pointer driver;
 
+        /** Set only for pending glue generated on demand.
+         */
+        std::shared_ptr<OnDemandGlue> onDemand;
+
         /** Derived metatile index.
          */
         TilesetReferences tilesets;
@@ -92,6 +124,14 @@ public:
                     , const TilesetReferences &tilesets)
             : driver(driver), tilesets(tilesets)
         {}
+
+        /** Returns driver able to serve given tile. For on-demand glue its
+         *  metatile containing given tile is generated first.
+         */
+        Driver::pointer get(const TileId &tileId) const {
+            if (!onDemand) { return driver; }
+            return onDemand->driver(tileId);
+        }
     };
 
     class Index : public tileset::Index {
@@ -203,6 +243,17 @@ private:
 
     void copyMetatiles(AggregatedOptions &options, Cache *srcCache);
 
+    /** Reads tile file referenced to an on-demand glue. On-demand glue's
+     *  tile index is just an estimate, therefore file is read from the
+     *  surface the generated metanode refers to (the same rule as in
+     *  buildMeta): the glue itself if it has real node for the tile,
+     *  otherwise first following surface that has. Never mixes files from
+     *  different surfaces.
+     */
+    IStream::pointer onDemandInput(MetaNode::SourceReference sourceReference
+                                   , const TileId &tileId, TileFile type)
+        const;
+
     inline IStream::pointer input_impl(const std::string &name) const {
         return input_impl(name, true);
     }
@@ -0,0 +1,668 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <tuple>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/stream_buffer.hpp>
+#include <boost/iostreams/device/array.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "utility/filedes.hpp"
+#include "utility/path.hpp"
+#include "utility/gccversion.hpp"
+#include "utility/raise.hpp"
+
+#include "../../../storage/error.hpp"
+#include "../../../storage/fstreams.hpp"
+#include "../../../storage/sstreams.hpp"
+#include "../../../storage/openfiles.hpp"
+#include "../../io.hpp"
+#include "../../tileop.hpp"
+#include "../config.hpp"
+#include "../tilesetindex.hpp"
+#include "./bundle.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+namespace fs = boost::filesystem;
+namespace bio = boost::iostreams;
+
+namespace vs = vtslibs::storage;
+
+namespace {
+
+const std::string ConfigName("tileset.conf");
+const std::string BundleName("tileset.bundle");
+
+const char Magic[4] = { 'V', 'T', 'S', 'B' };
+const std::uint16_t Version(1);
+
+struct Header {
+    char magic[4];
+    std::uint16_t version;
+    std::uint16_t reserved;
+    std::uint64_t indexOffset;
+    std::uint64_t indexSize;
+    std::int64_t lastModified;
+};
+
+static_assert(sizeof(Header) == 32, "Unexpected bundle header size.");
+
+enum class Kind : std::uint8_t { file = 0, tile = 1 };
+
+/** Index record. Key is (kind, type, lod, x, y).
+ */
+struct Record {
+    std::uint8_t kind;
+    std::uint8_t type;
+    std::uint16_t lod;
+    std::uint32_t x;
+    std::uint32_t y;
+    std::uint32_t reserved;
+    std::uint64_t start;
+    std::uint64_t size;
+
+    Record(File type)
+        : kind(std::uint8_t(Kind::file)), type(std::uint8_t(type))
+        , lod(), x(), y(), reserved(), start(), size()
+    {}
+
+    Record(const TileId &tileId, TileFile type)
+        : kind(std::uint8_t(Kind::tile)), type(std::uint8_t(type))
+        , lod(tileId.lod), x(tileId.x), y(tileId.y)
+        , reserved(), start(), size()
+    {}
+
+    bool operator<(const Record &o) const {
+        return (std::tie(kind, type, lod, x, y)
+                < std::tie(o.kind, o.type, o.lod, o.x, o.y));
+    }
+
+    bool operator==(const Record &o) const {
+        return (std::tie(kind, type, lod, x, y)
+                == std::tie(o.kind, o.type, o.lod, o.x, o.y));
+    }
+};
+
+static_assert(sizeof(Record) == 32, "Unexpected bundle record size.");
+
+/** Writes bundle file. Data are appended as they come, index is written at
+ *  finish.
+ */
+class Writer {
+public:
+    Writer(const fs::path &path)
+        : path_(path), lastModified_()
+    {
+        f_.exceptions(std::ios::badbit | std::ios::failbit);
+        f_.open(path_.string(), std::ios_base::out | std::ios_base::trunc
+                | std::ios_base::binary);
+
+        // placeholder, rewritten at finish
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        f_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    }
+
+    void add(Record record, const IStream::pointer &is) {
+        if (!is) { return; }
+
+        record.start = f_.tellp();
+        std::vector<char> buf(1 << 16);
+        // read via buffer to be independent on stream's exception mask
+        auto *in(is->get().rdbuf());
+        while (auto size = in->sgetn(buf.data(), buf.size())) {
+            f_.write(buf.data(), size);
+        }
+        record.size = std::uint64_t(f_.tellp()) - record.start;
+
+        lastModified_ = std::max(lastModified_, is->stat().lastModified);
+        is->close();
+
+        records_.push_back(record);
+    }
+
+    void add(const Record &record, const std::string &data
+             , std::time_t lastModified)
+    {
+        add(record, vs::memIStream("application/octet-stream", data
+                                   , lastModified, path_));
+    }
+
+    void finish() {
+        // align index
+        while (f_.tellp() % alignof(Record)) { f_.put('\0'); }
+
+        std::sort(records_.begin(), records_.end());
+        if (std::adjacent_find(records_.begin(), records_.end())
+            != records_.end())
+        {
+            LOGTHROW(err2, storage::Error)
+                << "Duplicate file in bundle " << path_ << ".";
+        }
+
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = Version;
+        header.indexOffset = f_.tellp();
+        header.indexSize = records_.size();
+        header.lastModified = lastModified_;
+
+        f_.write(reinterpret_cast<const char*>(records_.data())
+                 , records_.size() * sizeof(Record));
+        f_.seekp(0);
+        f_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        f_.close();
+    }
+
+    std::size_t count() const { return records_.size(); }
+
+private:
+    const fs::path path_;
+    std::ofstream f_;
+    std::vector<Record> records_;
+    std::time_t lastModified_;
+};
+
+void writeBundle(const fs::path &path, const Driver &source
+                 , const FullTileSetProperties &properties)
+{
+    const auto tmpPath(utility::addExtension(path, ".tmp"));
+    Writer writer(tmpPath);
+
+    // use tile index provided by source driver if available
+    tileset::Index ownIndex(registry::system.referenceFrames
+                            (properties.referenceFrame).metaBinaryOrder);
+    const auto *tsi(source.getTileIndex());
+    if (!tsi) {
+        tileset::loadTileSetIndex(ownIndex, source);
+        tsi = &ownIndex;
+    }
+
+    // metadata; tile index is serialized from memory since not every driver
+    // provides it as a file
+    {
+        std::ostringstream os;
+        tileset::saveTileSetIndex(*tsi, os);
+        writer.add(Record(File::tileIndex), os.str()
+                   , source.lastModified());
+    }
+    writer.add(Record(File::extraConfig)
+               , source.input(File::extraConfig, NullWhenNotFound));
+    writer.add(Record(File::registry)
+               , source.input(File::registry, NullWhenNotFound));
+
+    // tiles
+    traverse(tsi->tileIndex, [&](const TileId &tileId
+                                 , QTree::value_type flags)
+    {
+        if (flags & TileIndex::Flag::mesh) {
+            writer.add(Record(tileId, TileFile::mesh)
+                       , source.input(tileId, TileFile::mesh));
+        }
+        if (flags & TileIndex::Flag::atlas) {
+            writer.add(Record(tileId, TileFile::atlas)
+                       , source.input(tileId, TileFile::atlas));
+        }
+        if (flags & TileIndex::Flag::navtile) {
+            writer.add(Record(tileId, TileFile::navtile)
+                       , source.input(tileId, TileFile::navtile));
+        }
+    });
+
+    // metatiles
+    const auto mbo(tsi->metaBinaryOrder());
+    traverse(tsi->deriveMetaIndex(), [&](TileId tileId, QTree::value_type)
+    {
+        // expand shrinked metatile identifiers
+        tileId.x <<= mbo;
+        tileId.y <<= mbo;
+        writer.add(Record(tileId, TileFile::meta)
+                   , source.input(tileId, TileFile::meta
+                                  , NullWhenNotFound));
+    });
+
+    writer.finish();
+    fs::rename(tmpPath, path);
+
+    LOG(info3) << "Written " << writer.count() << " files to bundle "
+               << path << ".";
+}
+
+} // namespace
+
+/** Memory mapped bundle.
+ */
+struct BundleDriver::Bundle : boost::noncopyable {
+    typedef std::shared_ptr<Bundle> pointer;
+
+    Bundle(const fs::path &path);
+    ~Bundle();
+
+    const Record* find(const Record &key) const {
+        auto frecord(std::lower_bound(begin, end, key));
+        if ((frecord == end) || !(*frecord == key)) { return nullptr; }
+        return frecord;
+    }
+
+    std::time_t lastModified() const { return header->lastModified; }
+
+    std::size_t count() const { return end - begin; }
+
+    void validate(const fs::path &path);
+
+    utility::Filedes fd;
+    const char *data;
+    std::size_t size;
+    const Header *header;
+    const Record *begin;
+    const Record *end;
+};
+
+BundleDriver::Bundle::Bundle(const fs::path &path)
+    : fd(::open(path.string().c_str(), O_RDONLY | O_CLOEXEC), path)
+    , data(), size(), header(), begin(), end()
+{
+    if (!fd) {
+        if (errno == ENOENT) {
+            LOGTHROW(err2, storage::NoSuchFile)
+                << "Bundle " << path << " doesn't exist.";
+        }
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError("Failed to open bundle %s.", path));
+        LOG(err2) << e.what();
+        throw e;
+    }
+
+    struct ::stat st;
+    if (-1 == ::fstat(fd.get(), &st)) {
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError("Failed to stat bundle %s.", path));
+        LOG(err2) << e.what();
+        throw e;
+    }
+    size = st.st_size;
+
+    if (size < sizeof(Header)) {
+        LOGTHROW(err2, storage::BadFileFormat)
+            << "Bundle " << path << " is too short.";
+    }
+
+    auto *mem(::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd.get(), 0));
+    if (mem == MAP_FAILED) {
+        std::system_error e
+            (errno, std::system_category()
+             , utility::formatError("Failed to map bundle %s.", path));
+        LOG(err2) << e.what();
+        throw e;
+    }
+    data = static_cast<const char*>(mem);
+    vs::OpenFiles::inc();
+
+    // destructor is not called when constructor throws
+    try {
+        validate(path);
+    } catch (...) {
+        ::munmap(mem, size);
+        vs::OpenFiles::dec();
+        throw;
+    }
+}
+
+void BundleDriver::Bundle::validate(const fs::path &path)
+{
+    header = reinterpret_cast<const Header*>(data);
+    if (std::memcmp(header->magic, Magic, sizeof(Magic))) {
+        LOGTHROW(err2, storage::BadFileFormat)
+            << "File " << path << " is not a VTS bundle.";
+    }
+
+    if (header->version > Version) {
+        LOGTHROW(err2, storage::VersionError)
+            << "File " << path << " has unsupported version "
+            << header->version << ".";
+    }
+
+    if ((header->indexOffset % alignof(Record))
+        || (header->indexOffset > size)
+        || (header->indexSize > ((size - header->indexOffset)
+                                 / sizeof(Record))))
+    {
+        LOGTHROW(err2, storage::BadFileFormat)
+            << "Bundle " << path << " has invalid index.";
+    }
+
+    begin = reinterpret_cast<const Record*>(data + header->indexOffset);
+    end = begin + header->indexSize;
+
+    // every record must lie between header and index; streams access mapped
+    // data directly
+    const std::uint64_t dataEnd(header->indexOffset);
+    for (const auto *record(begin); record != end; ++record) {
+        if ((record->start < sizeof(Header))
+            || (record->start > dataEnd)
+            || (record->size > (dataEnd - record->start)))
+        {
+            LOGTHROW(err2, storage::BadFileFormat)
+                << "Bundle " << path << " has invalid index record #"
+                << (record - begin) << " (start=" << record->start
+                << ", size=" << record->size << ").";
+        }
+
+        // find() relies on sorted index
+        if ((record != begin) && !(record[-1] < *record)) {
+            LOGTHROW(err2, storage::BadFileFormat)
+                << "Bundle " << path << " has unsorted index.";
+        }
+    }
+}
+
+BundleDriver::Bundle::~Bundle()
+{
+    if (data) {
+        ::munmap(const_cast<char*>(data), size);
+        vs::OpenFiles::dec();
+    }
+}
+
+namespace {
+
+/** Stream reading directly from mapped bundle.
+ */
+class BundleIStream : public IStream {
+public:
+    template <typename Type>
+    BundleIStream(Type type, const BundleDriver::Bundle::pointer &bundle
+                  , const Record &record, const std::string &name)
+        : IStream(type), bundle_(bundle)
+        , start_(record.start), size_(record.size)
+        , buffer_(bundle->data + start_, bundle->data + start_ + size_)
+        , stream_(&buffer_), name_(name)
+    {
+        stream_.exceptions(std::ios::badbit | std::ios::failbit);
+    }
+
+    virtual std::istream& get() UTILITY_OVERRIDE { return stream_; }
+
+    virtual void close() UTILITY_OVERRIDE {}
+
+    virtual std::string name() const UTILITY_OVERRIDE { return name_; }
+
+    virtual FileStat stat_impl() const UTILITY_OVERRIDE {
+        return FileStat(size_, bundle_->lastModified());
+    }
+
+    virtual std::size_t read(char *buf, std::size_t size
+                             , std::istream::pos_type off)
+        UTILITY_OVERRIDE
+    {
+        const std::size_t pos(off);
+        if (pos >= size_) { return 0; }
+        size = std::min(size, size_ - pos);
+        std::memcpy(buf, bundle_->data + start_ + pos, size);
+        return size;
+    }
+
+    virtual boost::optional<vs::ReadOnlyFd> fd() UTILITY_OVERRIDE {
+        return vs::ReadOnlyFd(bundle_->fd.get(), start_, start_ + size_
+                              , true);
+    }
+
+private:
+    BundleDriver::Bundle::pointer bundle_;
+    std::size_t start_;
+    std::size_t size_;
+    bio::stream_buffer<bio::array_source> buffer_;
+    std::istream stream_;
+    std::string name_;
+};
+
+const std::string filePath(File type)
+{
+    switch (type) {
+    case File::config: return ConfigName;
+    case File::tileIndex: return "tileset.index";
+    case File::extraConfig: return "extra.conf";
+    case File::registry: return "tileset.registry";
+    default: break;
+    }
+    throw "unknown file type";
+}
+
+} // namespace
+
+BundleDriverBase::BundleDriverBase(const CloneOptions &cloneOptions)
+{
+    if (cloneOptions.lodRange()) {
+        LOGTHROW(err2, storage::Error)
+            << "BUNDLE tileset driver doesn't support LOD sub ranging.";
+    }
+}
+
+BundleDriver::BundleDriver(const boost::filesystem::path &root
+                           , const BundleOptions &options
+                           , const CloneOptions &cloneOptions
+                           , const Driver &source)
+    : BundleDriverBase(cloneOptions)
+    , Driver(root, cloneOptions.openOptions(), options, cloneOptions.mode())
+{
+    auto properties(tileset::loadConfig(source.input(File::config)));
+    if (cloneOptions.tilesetId()) {
+        properties.id = *cloneOptions.tilesetId();
+    }
+    properties.driverOptions = options;
+
+    writeBundle(this->root() / BundleName, source, properties);
+    tileset::saveConfig(this->root() / ConfigName, properties);
+
+    bundle_ = std::make_shared<Bundle>(this->root() / BundleName);
+
+    // make me read-only
+    readOnly(true);
+}
+
+BundleDriver::BundleDriver(const boost::filesystem::path &root
+                           , const OpenOptions &openOptions
+                           , const BundleOptions &options)
+    : Driver(root, openOptions, options)
+    , bundle_(std::make_shared<Bundle>(this->root() / BundleName))
+{}
+
+Driver::pointer
+BundleDriver::clone_impl(const boost::filesystem::path &root
+                         , const CloneOptions &cloneOptions)
+    const
+{
+    // bundle this bundle again
+    return std::make_shared<BundleDriver>(root, options(), cloneOptions
+                                          , *this);
+}
+
+BundleDriver::~BundleDriver() {}
+
+OStream::pointer BundleDriver::output_impl(File)
+{
+    LOGTHROW(err2, storage::ReadOnlyError)
+        << "This driver supports read access only.";
+    return {};
+}
+
+IStream::pointer BundleDriver::input_impl(File type) const
+{
+    if (type == File::config) {
+        auto path(root() / filePath(type));
+        LOG(info1) << "Loading from " << path << ".";
+        return fileIStream(type, path);
+    }
+
+    if (auto *record = bundle_->find(Record(type))) {
+        return std::make_shared<BundleIStream>
+            (type, bundle_, *record, (root() / filePath(type)).string());
+    }
+
+    LOGTHROW(err1, storage::NoSuchFile)
+        << "File " << filePath(type) << " not found in bundle.";
+    return {};
+}
+
+IStream::pointer BundleDriver::input_impl(File type, const NullWhenNotFound_t&)
+    const
+{
+    if (type == File::config) {
+        auto path(root() / filePath(type));
+        LOG(info1) << "Loading from " << path << ".";
+        return fileIStream(type, path, NullWhenNotFound);
+    }
+
+    if (auto *record = bundle_->find(Record(type))) {
+        return std::make_shared<BundleIStream>
+            (type, bundle_, *record, (root() / filePath(type)).string());
+    }
+    return {};
+}
+
+OStream::pointer BundleDriver::output_impl(const TileId&, TileFile)
+{
+    LOGTHROW(err2, storage::ReadOnlyError)
+        << "This driver supports read access only.";
+    return {};
+}
+
+IStream::pointer BundleDriver::input_impl(const TileId &tileId
+                                          , TileFile type)
+    const
+{
+    if (auto is = input_impl(tileId, type, NullWhenNotFound)) {
+        return is;
+    }
+
+    LOGTHROW(err1, storage::NoSuchFile)
+        << "Tile " << tileId << " file <" << type
+        << "> not found in bundle.";
+    return {};
+}
+
+IStream::pointer BundleDriver::input_impl(const TileId &tileId, TileFile type
+                                          , const NullWhenNotFound_t&)
+    const
+{
+    if (auto *record = bundle_->find(Record(tileId, type))) {
+        return std::make_shared<BundleIStream>
+            (type, bundle_, *record
+             , (root() / asFilename(tileId, type)).string());
+    }
+    return {};
+}
+
+FileStat BundleDriver::stat_impl(File type) const
+{
+    if (type == File::config) {
+        const auto path(root() / filePath(type));
+        LOG(info1) << "Statting " << path << ".";
+        return FileStat::stat(path);
+    }
+
+    if (auto *record = bundle_->find(Record(type))) {
+        return FileStat(record->size, bundle_->lastModified()
+                        , vs::contentType(type));
+    }
+
+    LOGTHROW(err1, storage::NoSuchFile)
+        << "File " << filePath(type) << " not found in bundle.";
+    throw;
+}
+
+FileStat BundleDriver::stat_impl(const TileId &tileId, TileFile type) const
+{
+    if (auto *record = bundle_->find(Record(tileId, type))) {
+        return FileStat(record->size, bundle_->lastModified()
+                        , vs::contentType(type));
+    }
+
+    LOGTHROW(err1, storage::NoSuchFile)
+        << "Tile " << tileId << " file <" << type
+        << "> not found in bundle.";
+    throw;
+}
+
+storage::Resources BundleDriver::resources_impl() const
+{
+    // one file, mapped memory is not counted
+    return { 1, 0 };
+}
+
+void BundleDriver::flush_impl() {
+    LOGTHROW(err2, storage::ReadOnlyError)
+        << "This driver supports read access only.";
+}
+
+void BundleDriver::drop_impl()
+{
+    LOGTHROW(err2, storage::ReadOnlyError)
+        << "This driver supports read access only.";
+}
+
+std::string BundleDriver::info_impl() const
+{
+    std::ostringstream os;
+    os << "bundle (files=" << bundle_->count()
+       << ", size=" << bundle_->size << ")";
+    return os.str();
+}
+
+boost::any BundleOptions::relocate(const RelocateOptions&
+                                   , const std::string &prefix) const
+{
+    LOG(info3) << prefix << "Nothing to relocate in bundle.";
+    return {};
+}
+
+bool BundleDriver::reencode(const boost::filesystem::path &root
+                            , const BundleOptions&
+                            , const ReencodeOptions&
+                            , const std::string &prefix)
+{
+    LOG(info3) << prefix << "Nothing to reencode in bundle " << root << ".";
+    return false;
+}
+
+} } } // namespace vtslibs::vts::driver
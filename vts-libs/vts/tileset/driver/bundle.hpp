@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef vtslibs_vts_tileset_driver_bundle_hpp_included_
+#define vtslibs_vts_tileset_driver_bundle_hpp_included_
+
+#include <memory>
+
+#include "../driver.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+/** Helper class.
+ */
+struct BundleDriverBase {
+    BundleDriverBase() {}
+    BundleDriverBase(const CloneOptions &cloneOptions);
+};
+
+/** Read-only driver serving whole tileset from single bundle file.
+ *
+ *  Tileset directory holds only tileset.conf and tileset.bundle. Bundle layout
+ *  (native byte order, bundle is memory mapped):
+ *
+ *      header: magic "VTSB", uint16 version, uint16 reserved,
+ *              uint64 index offset, uint64 index size (number of records),
+ *              int64 last modified
+ *      data:   file contents
+ *      index:  array of fixed-size records sorted by (kind, type, lod, x, y),
+ *              each holds position and size of one file
+ *
+ *  Only one file descriptor is held open while serving.
+ */
+class BundleDriver : private BundleDriverBase, public Driver {
+public:
+    typedef std::shared_ptr<BundleDriver> pointer;
+
+    /** Creates new bundle from source dataset. Existing tileset is
+     *  overwritten only if mode == CreateMode::overwrite.
+     */
+    BundleDriver(const boost::filesystem::path &root
+                 , const BundleOptions &options
+                 , const CloneOptions &cloneOptions
+                 , const Driver &source);
+
+    /** Opens storage.
+     */
+    BundleDriver(const boost::filesystem::path &root
+                 , const OpenOptions &openOptions
+                 , const BundleOptions &options);
+
+    virtual ~BundleDriver();
+
+    /** Nothing to reencode in bundle.
+     */
+    static bool reencode(const boost::filesystem::path &root
+                         , const BundleOptions &driverOptions
+                         , const ReencodeOptions &options
+                         , const std::string &prefix = "");
+
+    struct Bundle;
+
+private:
+    virtual OStream::pointer output_impl(const File type);
+
+    virtual IStream::pointer input_impl(File type) const;
+
+    virtual IStream::pointer input_impl(File type, const NullWhenNotFound_t&)
+        const;
+
+    virtual OStream::pointer
+    output_impl(const TileId &tileId, TileFile type);
+
+    virtual IStream::pointer
+    input_impl(const TileId &tileId, TileFile type) const;
+
+    virtual IStream::pointer
+    input_impl(const TileId &tileId, TileFile type, const NullWhenNotFound_t&)
+        const;
+
+    virtual void drop_impl();
+
+    virtual void flush_impl();
+
+    virtual FileStat stat_impl(File type) const;
+
+    virtual FileStat stat_impl(const TileId &tileId, TileFile type) const;
+
+    virtual Resources resources_impl() const;
+
+    Driver::pointer clone_impl(const boost::filesystem::path &root
+                               , const CloneOptions &cloneOptions) const;
+
+    virtual std::string info_impl() const;
+
+    inline const BundleOptions& options() const {
+        return Driver::options<const BundleOptions&>();
+    }
+
+    std::shared_ptr<Bundle> bundle_;
+};
+
+} } } // namespace vtslibs::vts::driver
+
+#endif // vtslibs_vts_tileset_driver_bundle_hpp_included_
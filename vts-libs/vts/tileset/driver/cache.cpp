@@ -24,6 +24,14 @@
  * POSSIBILITY OF SUCH DAMAGE.
  */
 #include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <map>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
 
 #include <boost/filesystem.hpp>
 #include <boost/format.hpp>
@@ -38,10 +46,16 @@
 #include "dbglog/dbglog.hpp"
 
 #include "utility/time.hpp"
+#include "utility/path.hpp"
+#include "utility/binaryio.hpp"
 
 #include "../../../storage/openfiles.hpp"
+#include "../../../storage/sstreams.hpp"
+#include "../../../storage/fstreams.hpp"
 #include "../../io.hpp"
+#include "../../tileop.hpp"
 #include "./cache.hpp"
+#include "./contentstore.hpp"
 
 namespace vtslibs { namespace vts { namespace driver {
 
@@ -115,6 +129,14 @@ struct Cache::Archives
 
     fs::path filePath(const TileId &index) const;
 
+    typedef std::function<void(const TileId &archive
+                               , const Tilar::FileIndex &file)> FileOp;
+
+    /** Scans archive directories and calls op for every file in every
+     *  archive.
+     */
+    void list(const FileOp &op) const;
+
     void flush() {
         finish([](Tilar &tilar) { tilar.commit(); });
     }
@@ -167,6 +189,8 @@ private:
     const std::string extension_;
     const Tilar::Options options_;
     const bool readOnly_;
+    const bool reclaimSpace_;
+    const std::size_t preallocate_;
     Map map_;
     const Tilar::ContentTypes &contentTypes_;
 
@@ -179,7 +203,9 @@ Cache::Archives::Archives(const fs::path &root, const std::string &extension
                           , const Tilar::ContentTypes &contentTypes)
     : root_(root), extension_(extension)
     , options_(options.tilar(filesPerTile))
-    , readOnly_(readOnly), contentTypes_(contentTypes)
+    , readOnly_(readOnly), reclaimSpace_(options.reclaimSpace())
+    , preallocate_(options.preallocate())
+    , contentTypes_(contentTypes)
 {}
 
 fs::path Cache::Archives::filePath(const TileId &index) const
@@ -195,6 +221,338 @@ fs::path Cache::Archives::filePath(const TileId &index) const
     return parent / filename;
 }
 
+void Cache::Archives::list(const FileOp &op) const
+{
+    if (!exists(root_)) { return; }
+
+    const std::string suffix("." + extension_);
+
+    for (fs::directory_iterator idir(root_), edir; idir != edir; ++idir) {
+        if (!is_directory(idir->status())) { continue; }
+
+        for (fs::directory_iterator ifile(idir->path()), efile
+                 ; ifile != efile; ++ifile)
+        {
+            // parse archive ID from filename: lod-x-y.extension
+            const auto filename(ifile->path().filename().string());
+            unsigned int lod, x, y;
+            int consumed(0);
+            if ((std::sscanf(filename.c_str(), "%u-%u-%u%n"
+                             , &lod, &x, &y, &consumed) != 3)
+                || (filename.compare(consumed, std::string::npos, suffix)))
+            {
+                continue;
+            }
+            const TileId archive(lod, x, y);
+
+            Tilar::Entry::list entries;
+            try {
+                auto tilar(Tilar::open(ifile->path()
+                                       , Tilar::OpenMode::readOnly));
+                if (tilar.options() != options_) {
+                    LOG(warn2)
+                        << "Skipping archive " << ifile->path()
+                        << ": different configuration (expected: "
+                        << options_ << ", encountered: "
+                        << tilar.options() << ").";
+                    continue;
+                }
+                entries = tilar.list();
+            } catch (const std::exception &e) {
+                LOG(warn2)
+                    << "Skipping unreadable archive " << ifile->path()
+                    << ": <" << e.what() << ">.";
+                continue;
+            }
+
+            for (const auto &entry : entries) {
+                op(archive, entry.index);
+            }
+        }
+    }
+}
+
+/** Tile files stored in content-addressed store. Tileset keeps mapping
+ *  from (tileId, type) to content digest in binary index tileset.content:
+ *
+ *  magic "TC", uint8 version, uint64 count and count records sorted by key:
+ *  uint8 type, uint8 lod, uint32 x, uint32 y, 20-byte SHA-1 digest
+ *
+ *  Loaded index is kept as a sorted vector; entries for tiles not present in
+ *  the loaded index are kept aside until flush.
+ */
+struct Cache::Content {
+    Content(const fs::path &root, const PlainOptions &options);
+
+    IStream::pointer input(const TileId &tileId, TileFile type
+                           , bool noSuchFile);
+
+    OStream::pointer output(const TileId &tileId, TileFile type);
+
+    FileStat stat(const TileId &tileId, TileFile type);
+
+    std::size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return index_.size() + added_.size();
+    }
+
+    void flush();
+
+    void drop() { store_.releaseAll(); }
+
+    void list(const FileOp &op) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto &record : index_) {
+            op(record.key.first, record.key.second);
+        }
+        for (const auto &item : added_) {
+            op(item.first.first, item.first.second);
+        }
+    }
+
+private:
+    typedef std::pair<TileId, TileFile> Key;
+    typedef ContentStore::Digest Digest;
+
+    struct Record {
+        Key key;
+        Digest digest;
+
+        bool operator<(const Key &k) const { return key < k; }
+    };
+
+    typedef std::vector<Record> Index;
+    typedef std::map<Key, Digest> Added;
+
+    /** Finds digest for given key, returns null if not found.
+     */
+    Digest* findDigest(const Key &key);
+
+    const Digest* findDigest(const Key &key) const {
+        return const_cast<Content*>(this)->findDigest(key);
+    }
+
+    fs::path find(const TileId &tileId, TileFile type, bool noSuchFile)
+        const;
+
+    void store(const Key &key, std::string &&data);
+
+    void load();
+
+    const fs::path indexPath_;
+    ContentStore store_;
+
+    /** Index sorted by key.
+     */
+    Index index_;
+
+    /** Entries not found in index_.
+     */
+    Added added_;
+
+    /** Digests that lost some reference since last flush.
+     */
+    std::set<Digest> replaced_;
+    bool changed_;
+
+    mutable std::mutex mutex_;
+};
+
+namespace {
+
+const char CONTENT_INDEX_IO_MAGIC[2] = { 'T', 'C' };
+const std::uint8_t CONTENT_INDEX_IO_VERSION(1);
+
+} // namespace
+
+Cache::Content::Content(const fs::path &root, const PlainOptions &options)
+    : indexPath_(root / "tileset.content")
+    , store_(*options.contentStore(), root)
+    , changed_(false)
+{
+    load();
+}
+
+void Cache::Content::load()
+{
+    using utility::binaryio::read;
+
+    std::ifstream f;
+    f.open(indexPath_.string(), std::ios_base::in | std::ios_base::binary);
+    if (!f) { return; }
+    f.exceptions(std::ios::badbit | std::ios::failbit);
+
+    try {
+        char magic[sizeof(CONTENT_INDEX_IO_MAGIC)];
+        read(f, magic);
+        if (std::memcmp(magic, CONTENT_INDEX_IO_MAGIC
+                        , sizeof(CONTENT_INDEX_IO_MAGIC)))
+        {
+            LOGTHROW(err2, storage::BadFileFormat)
+                << "Content index " << indexPath_ << " has wrong magic.";
+        }
+
+        std::uint8_t version;
+        read(f, version);
+        if (version > CONTENT_INDEX_IO_VERSION) {
+            LOGTHROW(err2, storage::VersionError)
+                << "Content index " << indexPath_
+                << " has unsupported version " << int(version) << ".";
+        }
+
+        std::uint64_t count;
+        read(f, count);
+
+        std::uint8_t type, lod;
+        std::uint32_t x, y;
+        index_.resize(count);
+        for (auto &record : index_) {
+            read(f, type);
+            read(f, lod);
+            read(f, x);
+            read(f, y);
+            read(f, record.digest.data(), record.digest.size());
+            record.key = Key(TileId(lod, x, y), TileFile(type));
+        }
+    } catch (const std::ios_base::failure &e) {
+        LOGTHROW(err2, storage::BadFileFormat)
+            << "Invalid content index " << indexPath_ << ": <"
+            << e.what() << ">.";
+    }
+}
+
+void Cache::Content::flush()
+{
+    using utility::binaryio::write;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!changed_) { return; }
+
+    // merge new entries into index
+    if (!added_.empty()) {
+        Index merged;
+        merged.reserve(index_.size() + added_.size());
+        auto iadded(added_.begin());
+        for (const auto &record : index_) {
+            for (; (iadded != added_.end()) && (iadded->first < record.key)
+                     ; ++iadded)
+            {
+                merged.push_back({ iadded->first, iadded->second });
+            }
+            merged.push_back(record);
+        }
+        for (; iadded != added_.end(); ++iadded) {
+            merged.push_back({ iadded->first, iadded->second });
+        }
+        index_.swap(merged);
+        added_.clear();
+    }
+
+    // write index atomically
+    const auto tmp(utility::addExtension(indexPath_, ".tmp"));
+    {
+        std::ofstream f;
+        f.exceptions(std::ios::badbit | std::ios::failbit);
+        f.open(tmp.string(), std::ios_base::out | std::ios_base::trunc
+               | std::ios_base::binary);
+        write(f, CONTENT_INDEX_IO_MAGIC);
+        write(f, CONTENT_INDEX_IO_VERSION);
+        write(f, std::uint64_t(index_.size()));
+        for (const auto &record : index_) {
+            const auto &tileId(record.key.first);
+            write(f, std::uint8_t(record.key.second));
+            write(f, std::uint8_t(tileId.lod));
+            write(f, std::uint32_t(tileId.x));
+            write(f, std::uint32_t(tileId.y));
+            write(f, record.digest.data(), record.digest.size());
+        }
+        f.close();
+    }
+    fs::rename(tmp, indexPath_);
+
+    // release references that are not used anymore
+    if (!replaced_.empty()) {
+        for (const auto &record : index_) { replaced_.erase(record.digest); }
+        for (const auto &digest : replaced_) {
+            store_.release(ContentStore::hash(digest));
+        }
+        replaced_.clear();
+    }
+
+    changed_ = false;
+}
+
+Cache::Content::Digest* Cache::Content::findDigest(const Key &key)
+{
+    const auto iindex(std::lower_bound(index_.begin(), index_.end(), key));
+    if ((iindex != index_.end()) && (iindex->key == key)) {
+        return &iindex->digest;
+    }
+
+    const auto iadded(added_.find(key));
+    if (iadded != added_.end()) { return &iadded->second; }
+    return nullptr;
+}
+
+fs::path Cache::Content::find(const TileId &tileId, TileFile type
+                              , bool noSuchFile)
+    const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto *digest(findDigest(Key(tileId, type)));
+    if (!digest) {
+        if (noSuchFile) {
+            LOGTHROW(err1, storage::NoSuchFile)
+                << "No file <" << type << "> for tile " << tileId
+                << " in content index " << indexPath_ << ".";
+        }
+        return {};
+    }
+    return store_.reference(ContentStore::hash(*digest));
+}
+
+IStream::pointer Cache::Content::input(const TileId &tileId, TileFile type
+                                       , bool noSuchFile)
+{
+    const auto path(find(tileId, type, noSuchFile));
+    if (path.empty()) { return {}; }
+    return storage::fileIStream(type, path);
+}
+
+OStream::pointer Cache::Content::output(const TileId &tileId, TileFile type)
+{
+    const Key key(tileId, type);
+    return storage::memOStream
+        (type, [this, key](std::string &&data)
+         {
+             store(key, std::move(data));
+         }, indexPath_.parent_path() / asFilename(tileId, type));
+}
+
+void Cache::Content::store(const Key &key, std::string &&data)
+{
+    const auto digest(ContentStore::digest(data));
+
+    // store data outside lock, store itself is safe
+    store_.put(ContentStore::hash(digest), data);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (auto *slot = findDigest(key)) {
+        if (*slot != digest) { replaced_.insert(*slot); }
+        *slot = digest;
+    } else {
+        added_.insert(Added::value_type(key, digest));
+    }
+    changed_ = true;
+}
+
+FileStat Cache::Content::stat(const TileId &tileId, TileFile type)
+{
+    auto fs(FileStat::stat(find(tileId, type, true)));
+    fs.contentType = storage::contentType(type);
+    return fs;
+}
+
 Cache::Cache(const fs::path &root, const PlainOptions &options
              , bool readOnly)
     : root_(root), options_(options), readOnly_(readOnly)
@@ -204,6 +562,7 @@ Cache::Cache(const fs::path &root, const PlainOptions &options
                               , metatileContentTypes))
     , navtiles_(new Archives(root, "navtiles", readOnly, 1, options
                              , navtileContentTypes))
+    , content_(options.contentStore() ? new Content(root, options) : nullptr)
 {}
 
 namespace {
@@ -326,6 +685,11 @@ Tilar Cache::Archives::open(const TileId &archive, bool noSuchFile)
     auto file(tilar(path, options_, readOnly_, noSuchFile));
     if (!file) { return file; }
     file.setContentTypes(contentTypes_);
+    if (!readOnly_) {
+        // NB: reclaiming is opt-in since it invalidates older index revisions
+        file.reclaimSpace(reclaimSpace_);
+        file.preallocate(preallocate_);
+    }
 
     return map_.insert
         (Record(archive, std::move(file))).first->tilar();
@@ -333,6 +697,8 @@ Tilar Cache::Archives::open(const TileId &archive, bool noSuchFile)
 
 IStream::pointer Cache::input(const TileId tileId, TileFile type)
 {
+    if (content_) { return content_->input(tileId, type, true); }
+
     const auto index(options_.index(tileId, type, fileType(type)));
     return getArchives(type).open(index.archive).input(index.file);
 }
@@ -340,26 +706,110 @@ IStream::pointer Cache::input(const TileId tileId, TileFile type)
 IStream::pointer Cache::input(const TileId tileId, TileFile type
                               , const NullWhenNotFound_t&)
 {
+    if (content_) { return content_->input(tileId, type, false); }
+
     const auto index(options_.index(tileId, type, fileType(type)));
     auto file(getArchives(type).open(index.archive, false));
     if (!file) { return {}; }
     return file.input(index.file, NullWhenNotFound);
 }
 
+std::vector<IStream::pointer>
+Cache::input(const TileFileRequest::list &files, const NullWhenNotFound_t&)
+{
+    struct Read {
+        std::size_t slot;
+        Tilar::FileIndex file;
+        std::uint32_t start;
+        std::uint32_t size;
+
+        Read(std::size_t slot, const Tilar::FileIndex &file)
+            : slot(slot), file(file), start(), size()
+        {}
+
+        bool operator<(const Read &o) const { return start < o.start; }
+    };
+
+    if (content_) {
+        // every file is standalone, nothing to group
+        std::vector<IStream::pointer> streams;
+        for (const auto &file : files) {
+            streams.push_back(content_->input(file.tileId, file.type, false));
+        }
+        return streams;
+    }
+
+    typedef std::pair<Archives*, TileId> Key;
+    std::map<Key, std::vector<Read>> groups;
+
+    for (std::size_t i(0), e(files.size()); i != e; ++i) {
+        const auto &file(files[i]);
+        const auto index(options_.index(file.tileId, file.type
+                                        , fileType(file.type)));
+        groups[Key(&getArchives(file.type), index.archive)]
+            .emplace_back(i, index.file);
+    }
+
+    std::vector<IStream::pointer> streams(files.size());
+
+    for (auto &group : groups) {
+        auto archive(group.first.first->open(group.first.second, false));
+        if (!archive) { continue; }
+
+        auto &reads(group.second);
+        for (auto &read : reads) {
+            const auto entry(archive.entry(read.file));
+            read.start = entry.start;
+            read.size = entry.size;
+        }
+        std::sort(reads.begin(), reads.end());
+
+        for (const auto &read : reads) {
+            // start is zero for non-existent files
+            if (!read.start) { continue; }
+
+            auto is(archive.input(read.file));
+            std::string data(read.size, '\0');
+            for (std::size_t off(0); off < data.size(); ) {
+                const auto r(is->read(&data[off], data.size() - off, off));
+                if (!r) {
+                    LOGTHROW(err2, storage::Error)
+                        << "Unexpected end of file in " << is->name()
+                        << ".";
+                }
+                off += r;
+            }
+
+            // NB: content type is owned by the tilar stream, use file type
+            streams[read.slot] = storage::memIStream
+                (files[read.slot].type, std::move(data)
+                 , is->stat().lastModified, is->name());
+        }
+    }
+
+    return streams;
+}
+
 OStream::pointer Cache::output(const TileId tileId, TileFile type)
 {
+    if (content_) { return content_->output(tileId, type); }
+
     const auto index(options_.index(tileId, type, fileType(type)));
     return getArchives(type).open(index.archive).output(index.file);
 }
 
 std::size_t Cache::size(const TileId tileId, TileFile type)
 {
+    if (content_) { return content_->stat(tileId, type).size; }
+
     const auto index(options_.index(tileId, type, fileType(type)));
     return getArchives(type).open(index.archive).size(index.file);
 }
 
 FileStat Cache::stat(const TileId tileId, TileFile type)
 {
+    if (content_) { return content_->stat(tileId, type); }
+
     const auto index(options_.index(tileId, type, fileType(type)));
     return getArchives(type).open(index.archive).stat(index.file);
 }
@@ -372,12 +822,40 @@ storage::Resources Cache::resources()
             , 0 };
 }
 
+void Cache::list(const FileOp &op) const
+{
+    if (content_) { return content_->list(op); }
+
+    tiles_->list([&](const TileId &archive, const Tilar::FileIndex &file)
+    {
+        const auto type(file.type ? TileFile::atlas : TileFile::mesh);
+        op(options_.tileId(archive, file, type), type);
+    });
+
+    metatiles_->list([&](const TileId &archive, const Tilar::FileIndex &file)
+    {
+        op(options_.tileId(archive, file, TileFile::meta), TileFile::meta);
+    });
+
+    navtiles_->list([&](const TileId &archive, const Tilar::FileIndex &file)
+    {
+        op(options_.tileId(archive, file, TileFile::navtile)
+           , TileFile::navtile);
+    });
+}
+
 void Cache::flush()
 {
     if (readOnly_) { return; }
     tiles_->flush();
     metatiles_->flush();
     navtiles_->flush();
+    if (content_) { content_->flush(); }
+}
+
+void Cache::drop()
+{
+    if (content_) { content_->drop(); }
 }
 
 } } } // namespace vtslibs::vts::driver
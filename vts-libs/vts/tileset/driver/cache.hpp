@@ -28,6 +28,8 @@
 
 #include <set>
 #include <map>
+#include <vector>
+#include <functional>
 
 #include <boost/noncopyable.hpp>
 #include <boost/optional.hpp>
@@ -70,6 +72,13 @@ public:
     IStream::pointer input(const TileId tileId, TileFile type
                            , const NullWhenNotFound_t&);
 
+    /** Batched read. Files are grouped by archive, each archive is looked up
+     *  once and its files are read in on-disk order. Returned streams are
+     *  in-memory and match request order; missing files are null.
+     */
+    std::vector<IStream::pointer> input(const TileFileRequest::list &files
+                                        , const NullWhenNotFound_t&);
+
     OStream::pointer output(const TileId tileId, TileFile type);
 
     std::size_t size(const TileId tileId, TileFile type);
@@ -78,14 +87,27 @@ public:
 
     storage::Resources resources();
 
+    typedef std::function<void(const TileId &tileId, TileFile type)> FileOp;
+
+    /** Calls op for every stored file. Only archive indices are read;
+     *  archives are opened read-only and bypass the archive cache.
+     */
+    void list(const FileOp &op) const;
+
     void flush();
 
+    /** Releases content store references (if any). Called before tileset's
+     *  data are removed.
+     */
+    void drop();
+
     bool readOnly() const { return readOnly_; }
 
     void makeReadOnly() { readOnly_ = true; }
 
 private:
     struct Archives;
+    struct Content;
 
     Archives& getArchives(TileFile type);
 
@@ -96,6 +118,10 @@ private:
     std::unique_ptr<Archives> tiles_;
     std::unique_ptr<Archives> metatiles_;
     std::unique_ptr<Archives> navtiles_;
+
+    /** Content-addressed tile files, replaces archives when set.
+     */
+    std::unique_ptr<Content> content_;
 };
 
 inline Cache::Archives& Cache::getArchives(TileFile type)
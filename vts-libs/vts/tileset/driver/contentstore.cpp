@@ -0,0 +1,369 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <array>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <system_error>
+#include <vector>
+
+#include <boost/filesystem.hpp>
+#include <boost/format.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "utility/path.hpp"
+#include "utility/raise.hpp"
+
+#include "../../../storage/error.hpp"
+#include "../config.hpp"
+#include "./options.hpp"
+#include "./contentstore.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+namespace fs = boost::filesystem;
+
+namespace {
+
+const std::string ReferenceRootName("content");
+const std::string ConfigName("tileset.conf");
+
+std::atomic<unsigned int> tmpCounter(0);
+
+void writeFile(const fs::path &path, const std::string &data)
+{
+    std::ofstream f;
+    f.exceptions(std::ios::badbit | std::ios::failbit);
+    f.open(path.string(), std::ios_base::out | std::ios_base::trunc
+           | std::ios_base::binary);
+    f.write(data.data(), data.size());
+    f.close();
+}
+
+void systemError(const char *what, const fs::path &path)
+{
+    std::system_error e
+        (errno, std::system_category()
+         , utility::formatError("%s %s.", what, path));
+    LOG(err2) << e.what();
+    throw e;
+}
+
+/** Minimal SHA-1 (FIPS 180-4) digest of a memory block.
+ *
+ *  Implementation is verified against FIPS 180 test vectors before first use
+ *  (see selfCheck()); broken hashing would silently merge unrelated tiles.
+ */
+class Sha1 {
+public:
+    typedef ContentStore::Digest Digest;
+
+    static Digest digest(const std::string &data) {
+        static const bool checked(selfCheck());
+        (void) checked;
+        return compute(data);
+    }
+
+private:
+    static Digest compute(const std::string &data) {
+        Sha1 sha1;
+        sha1.process(reinterpret_cast<const unsigned char*>(data.data())
+                     , data.size());
+        return sha1.finish();
+    }
+
+    /** Known-answer test, throws on mismatch.
+     */
+    static bool selfCheck() {
+        const std::pair<std::string, std::string> vectors[] = {
+            { "", "da39a3ee5e6b4b0d3255bfef95601890afd80709" }
+            , { "abc", "a9993e364706816aba3e25717850c26c9cd0d89d" }
+            , { "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"
+                , "84983e441c3bd26ebaae4aa1f95129e5e54670f1" }
+            , { std::string(1000000, 'a')
+                , "34aa973cd4c4daa4f61eeb2bdbad27316534016f" }
+        };
+
+        for (const auto &vector : vectors) {
+            const auto hash(ContentStore::hash(compute(vector.first)));
+            if (hash != vector.second) {
+                LOGTHROW(err3, storage::Error)
+                    << "SHA-1 self-check failed: got " << hash
+                    << ", expected " << vector.second << ".";
+            }
+        }
+        return true;
+    }
+
+    Sha1()
+        : h_{{ 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476
+               , 0xc3d2e1f0 }}
+        , size_(), used_()
+    {}
+
+    static std::uint32_t rol(std::uint32_t v, int bits) {
+        return (v << bits) | (v >> (32 - bits));
+    }
+
+    void process(const unsigned char *data, std::size_t size) {
+        size_ += size;
+        while (size) {
+            const auto chunk(std::min(size, block_.size() - used_));
+            std::copy(data, data + chunk, block_.begin() + used_);
+            used_ += chunk;
+            data += chunk;
+            size -= chunk;
+            if (used_ == block_.size()) { compress(); }
+        }
+    }
+
+    Digest finish() {
+        const std::uint64_t bits(size_ * 8);
+        block_[used_++] = 0x80;
+        if (used_ > 56) {
+            std::fill(block_.begin() + used_, block_.end(), 0);
+            used_ = block_.size();
+            compress();
+        }
+        std::fill(block_.begin() + used_, block_.begin() + 56, 0);
+        for (int i(0); i < 8; ++i) {
+            block_[56 + i] = (bits >> (56 - 8 * i)) & 0xff;
+        }
+        compress();
+
+        Digest digest;
+        auto *out(digest.data());
+        for (const auto part : h_) {
+            *out++ = (part >> 24) & 0xff;
+            *out++ = (part >> 16) & 0xff;
+            *out++ = (part >> 8) & 0xff;
+            *out++ = part & 0xff;
+        }
+        return digest;
+    }
+
+    void compress() {
+        std::uint32_t w[80];
+        for (int i(0); i < 16; ++i) {
+            w[i] = ((std::uint32_t(block_[4 * i]) << 24)
+                    | (std::uint32_t(block_[4 * i + 1]) << 16)
+                    | (std::uint32_t(block_[4 * i + 2]) << 8)
+                    | std::uint32_t(block_[4 * i + 3]));
+        }
+        for (int i(16); i < 80; ++i) {
+            w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+
+        auto a(h_[0]), b(h_[1]), c(h_[2]), d(h_[3]), e(h_[4]);
+        for (int i(0); i < 80; ++i) {
+            std::uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d); k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d; k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d); k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d; k = 0xca62c1d6;
+            }
+            const auto tmp(rol(a, 5) + f + e + k + w[i]);
+            e = d; d = c; c = rol(b, 30); b = a; a = tmp;
+        }
+
+        h_[0] += a; h_[1] += b; h_[2] += c; h_[3] += d; h_[4] += e;
+        used_ = 0;
+    }
+
+    std::array<std::uint32_t, 5> h_;
+    std::array<unsigned char, 64> block_;
+    std::uint64_t size_;
+    std::size_t used_;
+};
+
+/** Removes object if the store holds the last link.
+ */
+void releaseObject(const fs::path &object)
+{
+    struct ::stat st;
+    if (-1 == ::stat(object.string().c_str(), &st)) {
+        if (errno == ENOENT) { return; }
+        systemError("Failed to stat content object", object);
+    }
+
+    if (st.st_nlink > 1) { return; }
+
+    LOG(info1) << "Removing unreferenced content object " << object << ".";
+    if ((-1 == ::unlink(object.string().c_str())) && (errno != ENOENT)) {
+        systemError("Failed to remove content object", object);
+    }
+}
+
+} // namespace
+
+ContentStore::ContentStore(const fs::path &store
+                           , const fs::path &tilesetRoot)
+    : store_(fs::absolute(store, fs::absolute(tilesetRoot)))
+    , refRoot_(referenceRoot(tilesetRoot))
+{}
+
+ContentStore::Digest ContentStore::digest(const std::string &data)
+{
+    return Sha1::digest(data);
+}
+
+std::string ContentStore::hash(const Digest &digest)
+{
+    std::ostringstream os;
+    os << std::hex << std::setfill('0');
+    for (const auto byte : digest) {
+        os << std::setw(2) << int(byte);
+    }
+    return os.str();
+}
+
+std::string ContentStore::hash(const std::string &data)
+{
+    return hash(digest(data));
+}
+
+fs::path ContentStore::objectPath(const fs::path &store
+                                  , const std::string &hash)
+{
+    return store / hash.substr(0, 2) / hash;
+}
+
+fs::path ContentStore::referenceRoot(const fs::path &tilesetRoot)
+{
+    return tilesetRoot / ReferenceRootName;
+}
+
+fs::path ContentStore::reference(const std::string &hash) const
+{
+    return objectPath(refRoot_, hash);
+}
+
+void ContentStore::put(const std::string &hash, const std::string &data)
+{
+    const auto ref(reference(hash));
+    if (fs::exists(ref)) { return; }
+    fs::create_directories(ref.parent_path());
+
+    const auto object(objectPath(store_, hash));
+
+    // two rounds: link existing object or create it and link again
+    for (int round(0); round < 2; ++round) {
+        if (!::link(object.string().c_str(), ref.string().c_str())) {
+            return;
+        }
+
+        switch (errno) {
+        case EEXIST: return;
+
+        case EXDEV:
+            // store on different filesystem -> no sharing possible; fail
+            // instead of silently making private copies of all files
+            LOGTHROW(err2, storage::Error)
+                << "Content store " << store_ << " lives on different "
+                << "filesystem than " << refRoot_
+                << "; cannot deduplicate (is temporary directory on the "
+                << "same filesystem as the storage?).";
+
+        case ENOENT: break;
+
+        default:
+            systemError("Failed to link content object", object);
+        }
+
+        // no such object, create it atomically
+        fs::create_directories(object.parent_path());
+        const auto tmp(utility::addExtension
+                       (object, str(boost::format(".tmp.%d.%d")
+                                    % ::getpid() % tmpCounter++)));
+        writeFile(tmp, data);
+        if (::link(tmp.string().c_str(), object.string().c_str())
+            && (errno != EEXIST))
+        {
+            ::unlink(tmp.string().c_str());
+            systemError("Failed to store content object", object);
+        }
+        ::unlink(tmp.string().c_str());
+    }
+
+    LOGTHROW(err2, storage::Error)
+        << "Unable to store content object " << object << ".";
+}
+
+void ContentStore::release(const std::string &hash)
+{
+    const auto ref(reference(hash));
+    if ((-1 == ::unlink(ref.string().c_str())) && (errno != ENOENT)) {
+        systemError("Failed to remove content reference", ref);
+    }
+
+    releaseObject(objectPath(store_, hash));
+}
+
+void ContentStore::releaseAll()
+{
+    if (!fs::exists(refRoot_)) { return; }
+
+    std::vector<std::string> hashes;
+    for (fs::recursive_directory_iterator i(refRoot_), e; i != e; ++i) {
+        if (fs::is_regular_file(i->status())) {
+            hashes.push_back(i->path().filename().string());
+        }
+    }
+
+    LOG(info2) << "Releasing " << hashes.size()
+               << " content references from " << refRoot_ << ".";
+    for (const auto &hash : hashes) { release(hash); }
+}
+
+void ContentStore::releaseTileSet(const fs::path &tilesetRoot)
+{
+    if (!fs::exists(referenceRoot(tilesetRoot))) { return; }
+
+    const auto properties(tileset::loadConfig
+                          (tilesetRoot / ConfigName));
+    if (const auto *po = boost::any_cast<const PlainOptions>
+        (&properties.driverOptions))
+    {
+        if (const auto &store = po->contentStore()) {
+            ContentStore(*store, tilesetRoot).releaseAll();
+        }
+    }
+}
+
+} } } // namespace vtslibs::vts::driver
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef vtslibs_vts_tileset_driver_contentstore_hpp_included_
+#define vtslibs_vts_tileset_driver_contentstore_hpp_included_
+
+#include <array>
+#include <string>
+
+#include <boost/filesystem/path.hpp>
+
+namespace vtslibs { namespace vts { namespace driver {
+
+/** Content-addressed store of tile files shared by tilesets.
+ *
+ *  Each distinct content is stored once as store/xx/<sha1>. Tileset refers to
+ *  stored object by a hardlink root/content/xx/<sha1>, therefore object's link
+ *  count minus one is its reference count and tileset's files are readable
+ *  without knowing where the store lives.
+ *
+ *  Objects are immutable. Tileset and store must live on the same
+ *  filesystem.
+ *
+ *  Store path saved in tileset config should be absolute; relative path is
+ *  resolved against tileset root.
+ */
+class ContentStore {
+public:
+    /** Binary (SHA-1) content digest.
+     */
+    typedef std::array<unsigned char, 20> Digest;
+
+    /** Binds store to tileset root. Relative store path is relative to
+     *  tileset root.
+     */
+    ContentStore(const boost::filesystem::path &store
+                 , const boost::filesystem::path &tilesetRoot);
+
+    /** Computes content digest.
+     */
+    static Digest digest(const std::string &data);
+
+    /** Content hash (hex-encoded digest) used to name stored objects.
+     */
+    static std::string hash(const Digest &digest);
+
+    /** Computes content hash.
+     */
+    static std::string hash(const std::string &data);
+
+    /** Path to tileset's reference to given object.
+     */
+    boost::filesystem::path reference(const std::string &hash) const;
+
+    /** Makes sure object with given content exists and is referenced by this
+     *  tileset.
+     */
+    void put(const std::string &hash, const std::string &data);
+
+    /** Drops tileset's reference to given object. Object is removed from the
+     *  store when it is not referenced anymore.
+     */
+    void release(const std::string &hash);
+
+    /** Drops all tileset's references.
+     */
+    void releaseAll();
+
+    /** Releases all references held by tileset at given path if it uses
+     *  content store. Used before tileset is removed from the disk.
+     */
+    static void releaseTileSet(const boost::filesystem::path &tilesetRoot);
+
+    /** Path to object in store.
+     */
+    static boost::filesystem::path
+    objectPath(const boost::filesystem::path &store, const std::string &hash);
+
+    /** Path to tileset's reference root.
+     */
+    static boost::filesystem::path
+    referenceRoot(const boost::filesystem::path &tilesetRoot);
+
+private:
+    const boost::filesystem::path store_;
+    const boost::filesystem::path refRoot_;
+};
+
+} } } // namespace vtslibs::vts::driver
+
+#endif // vtslibs_vts_tileset_driver_contentstore_hpp_included_
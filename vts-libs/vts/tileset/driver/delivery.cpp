@@ -26,11 +26,15 @@
 #include <set>
 #include <map>
 #include <memory>
+#include <sstream>
+#include <list>
+#include <mutex>
 
 #include <boost/noncopyable.hpp>
 #include <boost/format.hpp>
 
 #include "utility/runnable.hpp"
+#include "utility/binaryio.hpp"
 
 #include "imgproc/png.hpp"
 
@@ -39,6 +43,8 @@
 
 #include "../../io.hpp"
 #include "../../2d.hpp"
+#include "../../atlas.hpp"
+#include "../../tileop.hpp"
 #include "../../tileset.hpp"
 #include "../../debug.hpp"
 
@@ -51,6 +57,7 @@ namespace vtslibs { namespace vts {
 
 namespace fs = boost::filesystem;
 namespace vs = vtslibs::storage;
+namespace bin = utility::binaryio;
 
 namespace {
 
@@ -103,6 +110,8 @@ namespace constants {
 
 const auto EmptyMask = imgproc::png::serialize(emptyDebugMask(), 9);
 
+const char BundleMagic[2] = { 'V', 'B' };
+
 } // namespace constants
 
 IStream::pointer mask(const Driver &driver, const TileId &tileId
@@ -277,13 +286,117 @@ IStream::pointer filterConfig(const IStream::pointer &raw)
     return s;
 }
 
+bool atlasVariant(TileFile type, FileFlavor flavor)
+{
+    if (type != TileFile::atlas) { return false; }
+    switch (flavor) {
+    case FileFlavor::half: case FileFlavor::quarter: return true;
+    default: break;
+    }
+    return false;
+}
+
+int downscaleFactor(FileFlavor flavor)
+{
+    return (flavor == FileFlavor::quarter) ? 4 : 2;
+}
+
 } // namespace
 
+struct Delivery::AtlasVariants {
+    AtlasVariants(const OpenOptions &openOptions)
+        : quality_(openOptions.atlasVariantQuality())
+        , capacity_(openOptions.atlasVariantCache() << 20)
+        , size_()
+    {}
+
+    IStream::pointer input(const Driver &driver, const TileId &tileId
+                           , FileFlavor flavor, bool noSuchFile);
+
+private:
+    typedef std::pair<TileId, FileFlavor> Key;
+    typedef std::list<Key> Lru;
+
+    struct Record {
+        std::string data;
+        std::time_t lastModified;
+        Lru::iterator lru;
+    };
+
+    typedef std::map<Key, Record> Records;
+
+    const int quality_;
+    const std::size_t capacity_;
+
+    std::mutex mutex_;
+    Records records_;
+    Lru lru_;
+    std::size_t size_;
+};
+
+IStream::pointer
+Delivery::AtlasVariants::input(const Driver &driver, const TileId &tileId
+                               , FileFlavor flavor, bool noSuchFile)
+{
+    const Key key(tileId, flavor);
+    const auto name((driver.root()
+                     / asFilename(tileId, TileFile::atlas, flavor)).string());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto frecords(records_.find(key));
+        if (frecords != records_.end()) {
+            // move to front
+            lru_.splice(lru_.begin(), lru_, frecords->second.lru);
+            return vs::memIStream(TileFile::atlas, frecords->second.data
+                                  , frecords->second.lastModified, name);
+        }
+    }
+
+    auto is(noSuchFile
+            ? driver.input(tileId, TileFile::atlas)
+            : driver.input(tileId, TileFile::atlas, NullWhenNotFound));
+    if (!is) { return {}; }
+
+    // decode, shrink and encode again
+    RawAtlas atlas;
+    atlas.deserialize(is->get(), is->name());
+    const auto lastModified(is->stat().lastModified);
+    is->close();
+
+    std::ostringstream os;
+    downscale(atlas, downscaleFactor(flavor), quality_)->serialize(os);
+    auto data(os.str());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if ((data.size() <= capacity_) && !records_.count(key)) {
+            lru_.push_front(key);
+            records_.insert(Records::value_type
+                            (key, Record{ data, lastModified
+                                    , lru_.begin() }));
+            size_ += data.size();
+
+            // drop least recently used variants
+            while (size_ > capacity_) {
+                auto frecords(records_.find(lru_.back()));
+                size_ -= frecords->second.data.size();
+                records_.erase(frecords);
+                lru_.pop_back();
+            }
+        }
+    }
+
+    return vs::memIStream(TileFile::atlas, std::move(data), lastModified
+                          , name);
+}
+
 Delivery::Delivery(AccessToken, const boost::filesystem::path &root
                    , const OpenOptions &openOptions)
     : driver_(Driver::open(root, openOptions))
     , properties_(tileset::loadConfig(*driver_))
     , index_(indexFromDriver(properties_, driver_))
+    , atlasVariants_(std::make_shared<AtlasVariants>(openOptions))
 {}
 
 Delivery::pointer
@@ -329,6 +442,12 @@ IStream::pointer Delivery::input(const TileId &tileId, TileFile type
     case TileFile::meta:
         return meta(*driver_, *index_, properties_, tileId, flavor, true);
 
+    case TileFile::atlas:
+        if (atlasVariant(type, flavor)) {
+            return atlasVariants_->input(*driver_, tileId, flavor, true);
+        }
+        return driver_->input(tileId, type);
+
     default:
         return driver_->input(tileId, type);
     }
@@ -351,11 +470,106 @@ IStream::pointer Delivery::input(const TileId &tileId, TileFile type
     case TileFile::meta:
         return meta(*driver_, *index_, properties_, tileId, flavor, false);
 
+    case TileFile::atlas:
+        if (atlasVariant(type, flavor)) {
+            return atlasVariants_->input(*driver_, tileId, flavor, false);
+        }
+        return driver_->input(tileId, type, NullWhenNotFound);
+
     default:
         return driver_->input(tileId, type, NullWhenNotFound);
     }
 }
 
+std::vector<IStream::pointer>
+Delivery::input(const TileFileRequest::list &files
+                , const NullWhenNotFound_t&) const
+{
+    std::vector<IStream::pointer> streams(files.size());
+
+    // files served by driver as-is go in one batch
+    TileFileRequest::list direct;
+    std::vector<std::size_t> slots;
+
+    for (std::size_t i(0), e(files.size()); i != e; ++i) {
+        const auto &file(files[i]);
+        switch (file.type) {
+        case TileFile::meta2d:
+        case TileFile::mask:
+        case TileFile::credits:
+            streams[i] = input(file.tileId, file.type, file.flavor
+                               , NullWhenNotFound);
+            continue;
+
+        case TileFile::atlas:
+            if (atlasVariant(file.type, file.flavor)) {
+                streams[i] = input(file.tileId, file.type, file.flavor
+                                   , NullWhenNotFound);
+                continue;
+            }
+            break;
+
+        case TileFile::meta:
+            if (file.flavor == FileFlavor::debug) {
+                streams[i] = input(file.tileId, file.type, file.flavor
+                                   , NullWhenNotFound);
+                continue;
+            }
+            break;
+
+        default: break;
+        }
+
+        direct.push_back(file);
+        slots.push_back(i);
+    }
+
+    auto fetched(driver_->input(direct, NullWhenNotFound));
+    for (std::size_t i(0), e(fetched.size()); i != e; ++i) {
+        streams[slots[i]] = std::move(fetched[i]);
+    }
+
+    return streams;
+}
+
+IStream::pointer Delivery::bundle(const TileFileRequest::list &files) const
+{
+    const auto streams(input(files, NullWhenNotFound));
+
+    std::ostringstream os;
+    bin::write(os, constants::BundleMagic);
+    bin::write(os, std::uint16_t(1));
+    bin::write(os, std::uint32_t(streams.size()));
+
+    std::time_t lastModified(0);
+    for (const auto &is : streams) {
+        if (!is) {
+            bin::write(os, std::uint8_t(0));
+            continue;
+        }
+
+        std::ostringstream data;
+        vs::copyFile(is, data);
+        const auto content(data.str());
+
+        const auto stat(is->stat());
+        const std::string contentType(stat.contentType);
+        if (stat.lastModified > lastModified) {
+            lastModified = stat.lastModified;
+        }
+
+        bin::write(os, std::uint8_t(1));
+        bin::write(os, std::uint8_t(contentType.size()));
+        bin::write(os, contentType.data(), contentType.size());
+        bin::write(os, std::uint32_t(content.size()));
+        bin::write(os, content.data(), content.size());
+    }
+
+    return vs::memIStream("application/octet-stream", os.str()
+                          , lastModified
+                          , (driver_->root() / "bundle").string());
+}
+
 FileStat Delivery::stat(File type) const
 {
     return driver_->stat(type);
@@ -51,6 +51,8 @@
 #include "./aggregated.hpp"
 #include "./remote.hpp"
 #include "./local.hpp"
+#include "./bundle.hpp"
+#include "./memory.hpp"
 
 namespace vtslibs { namespace vts {
 
@@ -202,6 +204,17 @@ Driver::pointer Driver::create(const boost::filesystem::path &root
     {
         return std::make_shared<driver::LocalDriver>
             (root, *o, cloneOptions);
+    } else if (boost::any_cast<const driver::BundleOptions>
+               (&genericOptions))
+    {
+        LOGTHROW(err2, storage::Unimplemented)
+            << "Cannot create tileset at " << root
+            << ": bundle can be created only from an existing tileset.";
+    } else if (auto o = boost::any_cast<const driver::MemoryOptions>
+               (&genericOptions))
+    {
+        return std::make_shared<driver::MemoryDriver>
+            (root, *o, cloneOptions);
     }
 
     LOGTHROW(err2, storage::BadFileFormat)
@@ -248,6 +261,14 @@ Driver::pointer Driver::open(const boost::filesystem::path &root
                              , const boost::any &genericOptions
                              , const OpenOptions &openOptions)
 {
+    if ((openOptions.openMode() == OpenMode::readWrite)
+        && !boost::any_cast<const driver::PlainOptions>(&genericOptions))
+    {
+        LOGTHROW(err2, storage::ReadOnlyError)
+            << "Cannot open tileset at " << root
+            << " for update: only plain tilesets can be updated in place.";
+    }
+
     if (auto o = boost::any_cast<const driver::PlainOptions>
         (&genericOptions))
     {
@@ -267,6 +288,17 @@ Driver::pointer Driver::open(const boost::filesystem::path &root
     {
         return std::make_shared<driver::LocalDriver>
             (root, openOptions, *o);
+    } else if (auto o = boost::any_cast<const driver::BundleOptions>
+               (&genericOptions))
+    {
+        return std::make_shared<driver::BundleDriver>
+            (root, openOptions, *o);
+    } else if (boost::any_cast<const driver::MemoryOptions>
+               (&genericOptions))
+    {
+        LOGTHROW(err2, storage::Unimplemented)
+            << "Cannot open tileset at " << root
+            << ": in-memory tileset cannot be reopened.";
     }
 
     LOGTHROW(err2, storage::BadFileFormat)
@@ -298,6 +330,14 @@ boost::any relocateOptions(const boost::any &options
                (&options))
     {
         return o->relocate(relocateOptions, prefix);
+    } else if (auto o = boost::any_cast<const driver::BundleOptions>
+               (&options))
+    {
+        return o->relocate(relocateOptions, prefix);
+    } else if (auto o = boost::any_cast<const driver::MemoryOptions>
+               (&options))
+    {
+        return o->relocate(relocateOptions, prefix);
     }
 
     LOGTHROW(err2, storage::BadFileFormat)
@@ -440,6 +480,16 @@ void Driver::reencode(const boost::filesystem::path &root
     {
         bumpRevision
             = driver::LocalDriver::reencode(root, *o, ro, prefix);
+    } else if (auto o = boost::any_cast<const driver::BundleOptions>
+               (&options))
+    {
+        bumpRevision
+            = driver::BundleDriver::reencode(root, *o, ro, prefix);
+    } else if (auto o = boost::any_cast<const driver::MemoryOptions>
+               (&options))
+    {
+        bumpRevision
+            = driver::MemoryDriver::reencode(root, *o, ro, prefix);
     }
 
     if (bumpRevision) {
@@ -476,6 +526,19 @@ IStream::pointer Driver::input_impl(const std::string &name
     return {};
 }
 
+std::vector<IStream::pointer>
+Driver::input_impl(const TileFileRequest::list &files
+                   , const NullWhenNotFound_t&) const
+{
+    std::vector<IStream::pointer> streams;
+    streams.reserve(files.size());
+    for (const auto &file : files) {
+        streams.push_back(input_impl(file.tileId, file.type
+                                     , NullWhenNotFound));
+    }
+    return streams;
+}
+
 FileStat Driver::stat_impl(const std::string &name) const
 {
     LOGTHROW(err1, storage::NoSuchFile)
@@ -483,6 +546,13 @@ FileStat Driver::stat_impl(const std::string &name) const
     throw;
 }
 
+void Driver::listTileFiles_impl(const TileFileOp&) const
+{
+    LOGTHROW(err1, storage::Unimplemented)
+        << "This driver cannot list its tile files.";
+    throw;
+}
+
 namespace driver {
 
 MapConfigOverride::MapConfigOverride(const boost::any &options)
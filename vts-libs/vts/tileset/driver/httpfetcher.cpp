@@ -22,12 +22,20 @@
  * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
- */
 #include <algorithm>
 #include <iterator>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <future>
+#include <random>
+#include <map>
+#include <vector>
+#include <cmath>
 
 #include <boost/format.hpp>
+#include <boost/optional.hpp>
 #include <boost/iostreams/device/array.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 
@@ -47,6 +55,174 @@ namespace ba = boost::algorithm;
 
 namespace vtslibs { namespace vts { namespace driver {
 
+typedef std::chrono::steady_clock Clock;
+
+class HttpFetcher::HostState {
+public:
+    typedef std::shared_ptr<HostState> pointer;
+    typedef std::function<void()> Task;
+
+    HostState() : next_(), failures_() {}
+
+    /** Returns false if circuit is open, i.e. the host is considered to be
+     *  down and request should fail immediately.
+     */
+    bool allow(const OpenOptions &options);
+
+    /** Records successful request. Runs all recovery tasks.
+     */
+    void success(Clock::duration latency);
+
+    /** Records failed request.
+     */
+    void failure(const OpenOptions &options);
+
+    /** Registers task to be run on next successful request to the host
+     *  (i.e. there is no need to wait anymore). Owner can have only one
+     *  registered task, task of expired owner is dropped.
+     */
+    void onRecovery(const std::weak_ptr<void> &owner, const Task &task);
+
+    /** Latency at given percentile. Returns boost::none if there is not
+     *  enough samples collected yet.
+     */
+    boost::optional<Clock::duration> percentile(int percentile) const;
+
+    /** Process-wide registry of host states. State lives as long as any
+     *  fetcher uses it.
+     */
+    static pointer get(const std::string &host);
+
+private:
+    /** Number of latency samples to keep.
+     */
+    static constexpr std::size_t WindowSize = 128;
+
+    /** Minimal number of samples needed to compute percentile.
+     */
+    static constexpr std::size_t MinSamples = 16;
+
+    typedef std::vector<std::pair<std::weak_ptr<void>, Task>> Waiters;
+
+    mutable std::mutex mutex_;
+    std::vector<Clock::duration> latencies_;
+    std::size_t next_;
+    int failures_;
+    Clock::time_point openUntil_;
+    Waiters waiters_;
+};
+
+constexpr std::size_t HttpFetcher::HostState::WindowSize;
+constexpr std::size_t HttpFetcher::HostState::MinSamples;
+
+bool HttpFetcher::HostState::allow(const OpenOptions &options)
+{
+    if (options.ioBreaker() <= 0) { return true; }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (failures_ < options.ioBreaker()) { return true; }
+
+    const auto now(Clock::now());
+    if (now < openUntil_) { return false; }
+
+    // half-open: let this one through and give the host another cooldown
+    // period to prove itself
+    openUntil_ = now + std::chrono::milliseconds(options.ioBreakerCooldown());
+    return true;
+}
+
+void HttpFetcher::HostState::success(Clock::duration latency)
+{
+    Waiters waiters;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        failures_ = 0;
+
+        if (latencies_.size() < WindowSize) {
+            latencies_.push_back(latency);
+        } else {
+            latencies_[next_] = latency;
+        }
+        next_ = (next_ + 1) % WindowSize;
+
+        std::swap(waiters, waiters_);
+    }
+
+    // run outside the lock, tasks only issue new requests
+    for (const auto &waiter : waiters) {
+        if (!waiter.first.expired()) { waiter.second(); }
+    }
+}
+
+void HttpFetcher::HostState::failure(const OpenOptions &options)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if ((++failures_ == options.ioBreaker()) && (options.ioBreaker() > 0)) {
+        openUntil_ = (Clock::now()
+                      + std::chrono::milliseconds
+                      (options.ioBreakerCooldown()));
+    }
+}
+
+void HttpFetcher::HostState::onRecovery(const std::weak_ptr<void> &owner
+                                        , const Task &task)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // drop tasks of expired owners and previous task of this owner
+    waiters_.erase(std::remove_if(waiters_.begin(), waiters_.end()
+                                  , [&](const Waiters::value_type &waiter)
+    {
+        return (waiter.first.expired()
+                || (!waiter.first.owner_before(owner)
+                    && !owner.owner_before(waiter.first)));
+    }), waiters_.end());
+
+    waiters_.emplace_back(owner, task);
+}
+
+boost::optional<Clock::duration>
+HttpFetcher::HostState::percentile(int percentile) const
+{
+    std::vector<Clock::duration> latencies;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (latencies_.size() < MinSamples) { return boost::none; }
+        latencies = latencies_;
+    }
+
+    const auto index((latencies.size() - 1) * percentile / 100);
+    std::nth_element(latencies.begin(), latencies.begin() + index
+                     , latencies.end());
+    return latencies[index];
+}
+
+HttpFetcher::HostState::pointer
+HttpFetcher::HostState::get(const std::string &host)
+{
+    static std::mutex mutex;
+    static std::map<std::string, std::weak_ptr<HostState>> states;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // evict states of hosts no fetcher uses anymore
+    for (auto istates(states.begin()); istates != states.end(); ) {
+        if (istates->second.expired()) {
+            istates = states.erase(istates);
+        } else {
+            ++istates;
+        }
+    }
+
+    auto &slot(states[host]);
+    auto state(slot.lock());
+    if (!state) {
+        state = std::make_shared<HostState>();
+        slot = state;
+    }
+    return state;
+}
+
 namespace {
 
 const std::string ConfigName("tileset.conf");
@@ -85,62 +261,435 @@ const std::string remotePath(const TileId &tileId, TileFile type
                % tileId.lod % tileId.x % tileId.y % ext % revision);
 }
 
-http::OnDemandClient sharedClient(4);
+/** Runs short tasks (issuing retries and hedged requests, failing requests
+ *  past deadline) at given time in single owned thread.
+ */
+class Timer {
+public:
+    typedef std::function<void()> Task;
 
-IStream::pointer fetchAsStream(const std::string rootUrl
-                               , const std::string &filename
-                               , const char *contentType
-                               , const OpenOptions &options
-                               , bool noSuchFile)
+    Timer() : stop_(false), thread_(&Timer::run, this) {}
+
+    ~Timer() { stop(); }
+
+    /** Schedules task. Task is dropped if timer has been stopped.
+     */
+    void schedule(Clock::time_point when, const Task &task) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stop_) { return; }
+        queue_.insert(Queue::value_type(when, task));
+        cond_.notify_all();
+    }
+
+    /** Stops and joins timer thread. Pending tasks are dropped.
+     */
+    void stop() {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            stop_ = true;
+            queue_.clear();
+            cond_.notify_all();
+        }
+        if (thread_.joinable()) { thread_.join(); }
+    }
+
+private:
+    void run();
+
+    typedef std::multimap<Clock::time_point, Task> Queue;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    Queue queue_;
+    bool stop_;
+    std::thread thread_;
+};
+
+void Timer::run()
 {
-    const auto &fetcher(sharedClient.fetcher());
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_) {
+        if (queue_.empty()) {
+            cond_.wait(lock);
+            continue;
+        }
 
-    const std::string url(rootUrl + "/" + filename);
+        auto first(queue_.begin());
+        if (Clock::now() < first->first) {
+            // NB: copy, wait_until references it while the lock is released
+            const auto when(first->first);
+            cond_.wait_until(lock, when);
+            continue;
+        }
 
-    auto tryFetch([&]() -> IStream::pointer
-    {
-        auto q(fetcher.perform
-               (utility::ResourceFetcher::Query(url)
-                .timeout(options.ioWait())));
-
-        if (q.ec()) {
-            if (q.check(make_error_code(utility::HttpCode::NotFound))) {
-                if (noSuchFile) {
-                    LOGTHROW(err2, storage::NoSuchFile)
-                        << "File at URL <" << url << "> doesn't exist.";
-                }
-                return {};
-            }
+        auto task(std::move(first->second));
+        queue_.erase(first);
 
-            LOGTHROW(err1, storage::IOError)
-                << "Failed to download tile data from <"
-                << url << ">: Unexpected HTTP status code: <"
-                << q.ec() << ">.";
+        lock.unlock();
+        try {
+            task();
+        } catch (const std::exception &e) {
+            LOG(err2) << "Timer task failed: <" << e.what() << ">.";
         }
+        lock.lock();
+    }
+}
 
+/** Asynchronous machinery shared by all fetchers: HTTP client and timer.
+ *
+ *  Timer is stopped first; then client is destroyed (its threads joined)
+ *  before timer since it is declared later. Client callbacks cannot touch
+ *  destroyed timer.
+ */
+struct Async {
+    Timer timer;
+    http::OnDemandClient client;
+
+    Async() : client(4) {}
+    ~Async() { timer.stop(); }
+};
+
+Async sharedAsync;
+
+/** Converts finished HTTP query into fetch result. Throws on error.
+ */
+IStream::pointer queryResult(utility::ResourceFetcher::Query &q
+                             , const std::string &url
+                             , const char *contentType, bool noSuchFile)
+{
+    if (q.ec()) {
+        if (q.check(make_error_code(utility::HttpCode::NotFound))) {
+            if (noSuchFile) {
+                LOGTHROW(err2, storage::NoSuchFile)
+                    << "File at URL <" << url << "> doesn't exist.";
+            }
+            return {};
+        }
+
+        LOGTHROW(err1, storage::IOError)
+            << "Failed to download tile data from <"
+            << url << ">: Unexpected HTTP status code: <"
+            << q.ec() << ">.";
+    }
+
+    try {
+        auto body(q.moveOut());
+        return storage::memIStream(contentType, std::move(body.data)
+                                   , body.lastModified, url);
+    } catch (const http::Error &e) {
+        LOGTHROW(err1, storage::IOError)
+            << "Failed to download tile data from <"
+            << url << ">: Unexpected error code <"
+            << e.what() << ">.";
+    }
+    return {};
+}
+
+/** Default transport: single asynchronous request via shared HTTP client.
+ */
+void httpFetch(const std::string &url, const char *contentType
+               , long timeout, bool noSuchFile
+               , const HttpFetcher::Done &done)
+{
+    sharedAsync.client.fetcher().perform
+        (utility::ResourceFetcher::Query(url).timeout(timeout)
+         , [=](utility::ResourceFetcher::Query &&q) -> void
+    {
+        IStream::pointer is;
+        std::exception_ptr error;
         try {
-            auto body(q.moveOut());
-            return storage::memIStream(contentType, std::move(body.data)
-                                       , body.lastModified, url);
-        } catch (const http::Error &e) {
-            LOGTHROW(err1, storage::IOError)
-                << "Failed to download tile data from <"
-                << url << ">: Unexpected error code <"
-                << e.what() << ">.";
+            is = queryResult(q, url, contentType, noSuchFile);
+        } catch (...) {
+            error = std::current_exception();
         }
-        return {};
+        done(is, error);
     });
+}
 
-    for (auto tries(options.ioRetries()); tries; (tries > 0) ? --tries : 0) {
-        try {
-            return tryFetch();
-        } catch (const storage::IOError &e) {
-            LOG(warn2) << "Failed to fetch file from <" << url
-                       << ">; retrying in a while.";
-            ::sleep(1);
+/** Makes IOError for given URL.
+ */
+std::exception_ptr ioError(const std::string &url, const char *what)
+{
+    try {
+        LOGTHROW(err1, storage::IOError)
+            << "Failed to download tile data from <"
+            << url << ">: " << what;
+    } catch (...) {
+        return std::current_exception();
+    }
+    return {};
+}
+
+bool retryable(const std::exception_ptr &error)
+{
+    if (!error) { return false; }
+    try {
+        std::rethrow_exception(error);
+    } catch (const storage::IOError&) {
+        return true;
+    } catch (...) {}
+    return false;
+}
+
+/** Computes delay before next retry for given (zero-based) attempt.
+ *
+ *  Fixed delay unless growth is enabled (ioBackoffMax > ioBackoff), then
+ *  jittered exponential backoff capped by ioBackoffMax.
+ */
+Clock::duration backoff(const OpenOptions &options, int attempt)
+{
+    const auto base(std::max(0L, options.ioBackoff()));
+    if (options.ioBackoffMax() <= base) {
+        return std::chrono::milliseconds(base);
+    }
+
+    thread_local std::mt19937 engine(std::random_device{}());
+
+    const auto delay(std::min(double(options.ioBackoffMax())
+                              , std::ldexp(double(base)
+                                           , std::min(attempt, 30))));
+
+    // equal jitter: half of the delay is fixed, the other half is random
+    std::uniform_real_distribution<double> jitter(0.0, delay / 2.0);
+    return std::chrono::duration_cast<Clock::duration>
+        (std::chrono::duration<double, std::milli>
+         (delay / 2.0 + jitter(engine)));
+}
+
+/** One fetch: sequence of attempts, each possibly hedged (i.e. another
+ *  request is sent when the first one takes too long; first finished
+ *  request wins and failure is reported only if both fail).
+ *
+ *  Everything is driven by transport callbacks and timer; no thread waits
+ *  for a response, hedging timeout or retry backoff. The fetch is kept
+ *  alive by pending requests and scheduled retry only.
+ */
+class Fetch : public std::enable_shared_from_this<Fetch> {
+public:
+    typedef std::shared_ptr<Fetch> pointer;
+
+    Fetch(const std::string &url, const char *contentType, bool noSuchFile
+          , const OpenOptions &options
+          , const HttpFetcher::Transport &transport
+          , const HttpFetcher::HostState::pointer &host
+          , const HttpFetcher::Done &done)
+        : url_(url), contentType_(contentType), noSuchFile_(noSuchFile)
+        , options_(options), transport_(transport), host_(host)
+        , done_(done), finished_(false), attempt_(-1), pending_()
+    {
+        if (options_.ioDeadline() >= 0) {
+            deadline_ = (Clock::now()
+                         + std::chrono::milliseconds(options_.ioDeadline()));
         }
     }
-    return tryFetch();
+
+    void start();
+
+private:
+    /** Starts given attempt.
+     */
+    void attempt(int attempt);
+
+    /** Sends one request of given attempt.
+     */
+    void send(int attempt, long timeout);
+
+    /** Request of given attempt finished.
+     */
+    void received(int attempt, const IStream::pointer &is
+                  , const std::exception_ptr &error);
+
+    /** Schedules next attempt after failed one.
+     */
+    void retry(int attempt, const std::exception_ptr &error);
+
+    /** Reports result (only the first call has any effect).
+     */
+    void finish(const IStream::pointer &is, const std::exception_ptr &error);
+
+    const std::string url_;
+    const char *contentType_;
+    const bool noSuchFile_;
+    const OpenOptions options_;
+    const HttpFetcher::Transport transport_;
+    const HttpFetcher::HostState::pointer host_;
+    const HttpFetcher::Done done_;
+    boost::optional<Clock::time_point> deadline_;
+
+    std::mutex mutex_;
+    bool finished_;
+    int attempt_;
+    int pending_;
+    Clock::time_point attemptStart_;
+};
+
+void Fetch::start()
+{
+    if (deadline_) {
+        // weak: finished fetch must not be kept alive until deadline
+        std::weak_ptr<Fetch> weak(shared_from_this());
+        sharedAsync.timer.schedule(*deadline_, [weak]() -> void
+        {
+            if (auto self = weak.lock()) {
+                self->finish({}, ioError(self->url_, "deadline exceeded."));
+            }
+        });
+    }
+
+    attempt(0);
+}
+
+void Fetch::attempt(int attempt)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // already finished or started by other trigger (recovery/timer)
+        if (finished_ || (attempt <= attempt_)) { return; }
+        attempt_ = attempt;
+        pending_ = 0;
+        attemptStart_ = Clock::now();
+    }
+
+    if (!host_->allow(options_)) {
+        finish({}, ioError(url_, "host is failing, not trying."));
+        return;
+    }
+
+    // limit single attempt by remaining time
+    long timeout(options_.ioWait());
+    if (deadline_) {
+        const auto remaining
+            (std::chrono::duration_cast<std::chrono::milliseconds>
+             (*deadline_ - Clock::now()).count());
+        if (remaining <= 0) {
+            finish({}, ioError(url_, "deadline exceeded."));
+            return;
+        }
+        if ((timeout < 0) || (timeout > remaining)) { timeout = remaining; }
+    }
+
+    boost::optional<Clock::duration> hedgeAfter;
+    if (options_.ioHedge() > 0) {
+        hedgeAfter = host_->percentile(options_.ioHedge());
+    }
+
+    send(attempt, timeout);
+
+    if (!hedgeAfter) { return; }
+
+    const auto hedgeAt(Clock::now() + *hedgeAfter);
+    if (deadline_ && (hedgeAt >= *deadline_)) { return; }
+
+    std::weak_ptr<Fetch> weak(shared_from_this());
+    sharedAsync.timer.schedule(hedgeAt, [weak, attempt, timeout]() -> void
+    {
+        auto self(weak.lock());
+        if (!self) { return; }
+        {
+            std::unique_lock<std::mutex> lock(self->mutex_);
+            if (self->finished_ || (self->attempt_ != attempt)
+                || !self->pending_)
+            {
+                return;
+            }
+        }
+
+        LOG(info1) << "Sending hedged request to <" << self->url_ << ">.";
+        self->send(attempt, timeout);
+    });
+}
+
+void Fetch::send(int attempt, long timeout)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ++pending_;
+    }
+
+    auto self(shared_from_this());
+    try {
+        transport_(url_, contentType_, timeout, noSuchFile_
+                   , [self, attempt](const IStream::pointer &is
+                                     , const std::exception_ptr &error)
+                   {
+                       self->received(attempt, is, error);
+                   });
+    } catch (...) {
+        received(attempt, {}, std::current_exception());
+    }
+}
+
+void Fetch::received(int attempt, const IStream::pointer &is
+                     , const std::exception_ptr &error)
+{
+    const bool retry(retryable(error));
+
+    Clock::duration latency;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // finished or loser of an already decided attempt
+        if (finished_ || (attempt != attempt_)) { return; }
+
+        --pending_;
+        // failed request; wait for the other one (if any)
+        if (retry && pending_) { return; }
+
+        latency = Clock::now() - attemptStart_;
+    }
+
+    if (!retry) {
+        if (!error) { host_->success(latency); }
+        finish(is, error);
+        return;
+    }
+
+    host_->failure(options_);
+    this->retry(attempt, error);
+}
+
+void Fetch::retry(int attempt, const std::exception_ptr &error)
+{
+    if ((options_.ioRetries() >= 0) && (attempt >= options_.ioRetries())) {
+        finish({}, error);
+        return;
+    }
+
+    const auto delay(backoff(options_, attempt));
+    if (deadline_ && ((Clock::now() + delay) >= *deadline_)) {
+        finish({}, ioError(url_, "deadline exceeded."));
+        return;
+    }
+
+    LOG(warn2) << "Failed to fetch file from <" << url_
+               << ">; retrying in "
+               << std::chrono::duration_cast<std::chrono::milliseconds>
+        (delay).count() << " ms.";
+
+    // next attempt after backoff or as soon as other request to the same
+    // host proves it is alive, whichever comes first
+    auto self(shared_from_this());
+    const auto next(attempt + 1);
+    sharedAsync.timer.schedule(Clock::now() + delay, [self, next]() -> void
+    {
+        self->attempt(next);
+    });
+
+    std::weak_ptr<Fetch> weak(self);
+    host_->onRecovery(weak, [weak, next]() -> void
+    {
+        if (auto self = weak.lock()) { self->attempt(next); }
+    });
+}
+
+void Fetch::finish(const IStream::pointer &is
+                   , const std::exception_ptr &error)
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (finished_) { return; }
+        finished_ = true;
+    }
+    done_(is, error);
 }
 
 std::string fixUrl(const std::string &input, const OpenOptions &options)
@@ -181,28 +730,76 @@ std::string fixUrl(const std::string &input, const OpenOptions &options)
 } // namespace
 
 HttpFetcher::HttpFetcher(const std::string &rootUrl
-                         , const OpenOptions &options)
+                         , const OpenOptions &options
+                         , const Transport &transport)
     : rootUrl_(fixUrl(rootUrl, options))
     , options_(options)
+    , transport_(transport ? transport : Transport(&httpFetch))
+    , host_(HostState::get(utility::Uri(rootUrl_).host()))
 {
     LOG(info1) << "Using URI: <" << rootUrl_ << ">.";
 }
 
+void HttpFetcher::fetch(const std::string &filename
+                        , const char *contentType
+                        , bool noSuchFile, const Done &done)
+    const
+{
+    std::make_shared<Fetch>(rootUrl_ + "/" + filename, contentType
+                            , noSuchFile, options_, transport_, host_
+                            , done)->start();
+}
+
+IStream::pointer HttpFetcher::fetch(const std::string &filename
+                                    , const char *contentType
+                                    , bool noSuchFile)
+    const
+{
+    // NB: shared, callback can still be inside set_value when get returns
+    auto promise(std::make_shared<std::promise<IStream::pointer>>());
+    auto future(promise->get_future());
+
+    fetch(filename, contentType, noSuchFile
+          , [promise](const IStream::pointer &is
+                      , const std::exception_ptr &error)
+    {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(is);
+        }
+    });
+
+    return future.get();
+}
+
 IStream::pointer HttpFetcher::input(File type, bool noSuchFile)
     const
 {
-    return fetchAsStream(rootUrl_, filePath(type)
-                         , contentType(type), options_
-                         , noSuchFile);
+    return fetch(filePath(type), contentType(type), noSuchFile);
 }
 
 IStream::pointer HttpFetcher::input(const TileId &tileId, TileFile type
                                     , unsigned int revision, bool noSuchFile)
     const
 {
-    return fetchAsStream(rootUrl_, remotePath(tileId, type, revision)
-                         , contentType(type), options_
-                         , noSuchFile);
+    return fetch(remotePath(tileId, type, revision), contentType(type)
+                 , noSuchFile);
+}
+
+void HttpFetcher::input(File type, const Done &done, bool noSuchFile)
+    const
+{
+    fetch(filePath(type), contentType(type), noSuchFile, done);
+}
+
+void HttpFetcher::input(const TileId &tileId, TileFile type
+                        , unsigned int revision, const Done &done
+                        , bool noSuchFile)
+    const
+{
+    fetch(remotePath(tileId, type, revision), contentType(type)
+          , noSuchFile, done);
 }
 
 } } } // namespace vtslibs::vts::driver
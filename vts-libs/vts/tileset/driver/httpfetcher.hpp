@@ -26,6 +26,10 @@
 #ifndef vtslibs_vts_tileset_driver_httpfetcher_hpp_included_
 #define vtslibs_vts_tileset_driver_httpfetcher_hpp_included_
 
+#include <memory>
+#include <functional>
+#include <exception>
+
 #include "../driver.hpp"
 #include "../../options.hpp"
 
@@ -33,17 +37,77 @@ namespace vtslibs { namespace vts { namespace driver {
 
 class HttpFetcher {
 public:
-    HttpFetcher(const std::string &rootUrl, const OpenOptions &options);
+    /** Fetch completion: fetched data or error (exactly one of them is set
+     *  unless file doesn't exist and noSuchFile is false; then both are
+     *  null).
+     */
+    typedef std::function<void(const IStream::pointer &is
+                               , const std::exception_ptr &error)> Done;
+
+    /** Single asynchronous fetch attempt.
+     *
+     *  Must eventually call done exactly once with fetched data, null
+     *  pointer if file doesn't exist and noSuchFile is false or
+     *  storage::NoSuchFile if file doesn't exist and noSuchFile is true. Any
+     *  other failure must be reported as storage::IOError; such an attempt
+     *  is retried. Throwing from the call itself is the same as reporting
+     *  the exception via done.
+     *
+     *  \param url URL to fetch
+     *  \param contentType content type of returned stream
+     *  \param timeout timeout in ms (-1 = no timeout)
+     *  \param noSuchFile report storage::NoSuchFile when file doesn't exist
+     *  \param done completion callback
+     */
+    typedef std::function<void(const std::string &url
+                               , const char *contentType
+                               , long timeout
+                               , bool noSuchFile
+                               , const Done &done)> Transport;
 
+    /** Creates fetcher.
+     *
+     *  \param rootUrl root URL of remote tileset
+     *  \param options open options (retries, deadline, hedging...)
+     *  \param transport fetch attempt implementation; HTTP client is used
+     *                   when empty; provided for testing
+     */
+    HttpFetcher(const std::string &rootUrl, const OpenOptions &options
+                , const Transport &transport = Transport());
+
+    /** Synchronous interface: waits for the result in the calling thread.
+     */
     IStream::pointer input(File type, bool noSuchFile = true) const;
 
     IStream::pointer input(const TileId &tileId, TileFile type
                            , unsigned int revision
                            , bool noSuchFile = true) const;
 
+    /** Asynchronous interface: done is called from HTTP client or timer
+     *  thread. Neither retries nor hedging block any thread.
+     */
+    void input(File type, const Done &done, bool noSuchFile = true) const;
+
+    void input(const TileId &tileId, TileFile type, unsigned int revision
+               , const Done &done, bool noSuchFile = true) const;
+
+    /** Per-host state (latency statistics, circuit breaker). Shared by all
+     *  fetchers accessing the same host.
+     */
+    class HostState;
+
 private:
+    IStream::pointer fetch(const std::string &filename
+                           , const char *contentType
+                           , bool noSuchFile) const;
+
+    void fetch(const std::string &filename, const char *contentType
+               , bool noSuchFile, const Done &done) const;
+
     const std::string rootUrl_;
     OpenOptions options_;
+    Transport transport_;
+    std::shared_ptr<HostState> host_;
 };
 
 } } } // namespace vtslibs::vts::driver
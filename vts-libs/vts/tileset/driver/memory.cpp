@@ -0,0 +1,342 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <ctime>
+#include <sstream>
+
+#include <boost/filesystem.hpp>
+#include <boost/iostreams/stream_buffer.hpp>
+#include <boost/iostreams/device/array.hpp>
+
+#include "dbglog/dbglog.hpp"
+
+#include "utility/gccversion.hpp"
+
+#include "../../../storage/error.hpp"
+#include "../../../storage/sstreams.hpp"
+#include "../../io.hpp"
+#include "../../tileop.hpp"
+#include "./memory.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+namespace fs = boost::filesystem;
+namespace bio = boost::iostreams;
+
+namespace {
+
+const std::string SpillName("spill");
+
+const std::string filePath(File type)
+{
+    switch (type) {
+    case File::config: return "tileset.conf";
+    case File::extraConfig: return "extra.conf";
+    case File::tileIndex: return "tileset.index";
+    case File::registry: return "tileset.registry";
+    default: break;
+    }
+    throw "unknown file type";
+}
+
+/** Reads from shared in-memory data without copying them.
+ */
+class MemoryIStream : public IStream {
+public:
+    typedef std::shared_ptr<const std::string> Data;
+
+    template <typename Type>
+    MemoryIStream(Type type, const Data &data, std::time_t lastModified
+                  , const std::string &name)
+        : IStream(type), data_(data), lastModified_(lastModified)
+        , buffer_(data_->data(), data_->size())
+        , stream_(&buffer_), name_(name)
+    {
+        stream_.exceptions(std::ios::badbit | std::ios::failbit);
+    }
+
+    virtual std::istream& get() UTILITY_OVERRIDE { return stream_; }
+
+    virtual void close() UTILITY_OVERRIDE {}
+
+    virtual std::string name() const UTILITY_OVERRIDE { return name_; }
+
+    virtual FileStat stat_impl() const UTILITY_OVERRIDE {
+        return FileStat(data_->size(), lastModified_);
+    }
+
+    virtual std::size_t read(char *buf, std::size_t size
+                             , std::istream::pos_type off)
+        UTILITY_OVERRIDE
+    {
+        const std::size_t pos(off);
+        if (pos >= data_->size()) { return 0; }
+        return data_->copy(buf, size, pos);
+    }
+
+private:
+    Data data_;
+    std::time_t lastModified_;
+    bio::stream_buffer<bio::array_source> buffer_;
+    std::istream stream_;
+    std::string name_;
+};
+
+} // namespace
+
+MemoryDriver::MemoryDriver(const boost::filesystem::path &root
+                           , const MemoryOptions &options
+                           , const CloneOptions &cloneOptions)
+    : Driver(root, cloneOptions.openOptions(), options, cloneOptions.mode())
+    , used_(), spilled_()
+    , spillRoot_(this->root() / SpillName)
+    , spillCache_(spillRoot_, PlainOptions(options.spill, true), false)
+{}
+
+MemoryDriver::~MemoryDriver()
+{
+    // spilled data are useless without in-memory metadata
+    boost::system::error_code ec;
+    fs::remove_all(spillRoot_, ec);
+    // remove root only when empty
+    fs::remove(root(), ec);
+}
+
+void MemoryDriver::store(File type, std::string &&data)
+{
+    auto shared(std::make_shared<const std::string>(std::move(data)));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    files_[type] = Record(shared, std::time(nullptr));
+}
+
+void MemoryDriver::store(const TileKey &key, std::string &&data)
+{
+    auto shared(std::make_shared<const std::string>(std::move(data)));
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    auto ftiles(tiles_.find(key));
+    if (ftiles != tiles_.end()) {
+        // replace existing record
+        used_ -= ftiles->second.data->size();
+        lru_.erase(ftiles->second.lru);
+        tiles_.erase(ftiles);
+    }
+
+    lru_.push_front(key);
+    tiles_.insert(std::make_pair
+                  (key, TileRecord(shared, std::time(nullptr)
+                                   , lru_.begin())));
+    used_ += shared->size();
+
+    spill();
+}
+
+void MemoryDriver::spill()
+{
+    const auto budget(options().budget);
+
+    while ((used_ > budget) && !lru_.empty()) {
+        const auto key(lru_.back());
+        auto ftiles(tiles_.find(key));
+        const auto &data(*ftiles->second.data);
+
+        auto os(spillCache_.output(key.first, key.second));
+        os->get().write(data.data(), data.size());
+        os->close();
+
+        LOG(info1) << "Spilled tile " << key.first << " file <"
+                   << key.second << "> (" << data.size() << " bytes).";
+
+        used_ -= data.size();
+        ++spilled_;
+        tiles_.erase(ftiles);
+        lru_.pop_back();
+    }
+}
+
+OStream::pointer MemoryDriver::output_impl(File type)
+{
+    return storage::memOStream
+        (type, [this, type](std::string &&data)
+         {
+             store(type, std::move(data));
+         }, root() / filePath(type));
+}
+
+IStream::pointer MemoryDriver::input_impl(File type) const
+{
+    if (auto is = input_impl(type, NullWhenNotFound)) { return is; }
+
+    LOGTHROW(err1, storage::NoSuchFile)
+        << "File " << filePath(type) << " not found in in-memory tileset "
+        << root() << ".";
+    return {};
+}
+
+IStream::pointer MemoryDriver::input_impl(File type, const NullWhenNotFound_t&)
+    const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto ffiles(files_.find(type));
+    if (ffiles == files_.end()) { return {}; }
+
+    return std::make_shared<MemoryIStream>
+        (type, ffiles->second.data, ffiles->second.lastModified
+         , (root() / filePath(type)).string());
+}
+
+OStream::pointer MemoryDriver::output_impl(const TileId &tileId
+                                           , TileFile type)
+{
+    const TileKey key(tileId, type);
+    return storage::memOStream
+        (type, [this, key](std::string &&data)
+         {
+             store(key, std::move(data));
+         }, root() / asFilename(tileId, type));
+}
+
+IStream::pointer MemoryDriver::input_impl(const TileId &tileId
+                                          , TileFile type)
+    const
+{
+    if (auto is = input_impl(tileId, type, NullWhenNotFound)) { return is; }
+
+    LOGTHROW(err1, storage::NoSuchFile)
+        << "Tile " << tileId << " file <" << type
+        << "> not found in in-memory tileset " << root() << ".";
+    return {};
+}
+
+IStream::pointer MemoryDriver::input_impl(const TileId &tileId, TileFile type
+                                          , const NullWhenNotFound_t&)
+    const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    auto ftiles(tiles_.find(TileKey(tileId, type)));
+    if (ftiles != tiles_.end()) {
+        // mark as most recently used
+        lru_.splice(lru_.begin(), lru_, ftiles->second.lru);
+        return std::make_shared<MemoryIStream>
+            (type, ftiles->second.data, ftiles->second.lastModified
+             , (root() / asFilename(tileId, type)).string());
+    }
+
+    if (!spilled_) { return {}; }
+    return spillCache_.input(tileId, type, NullWhenNotFound);
+}
+
+FileStat MemoryDriver::stat_impl(File type) const
+{
+    return input_impl(type)->stat();
+}
+
+FileStat MemoryDriver::stat_impl(const TileId &tileId, TileFile type) const
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto ftiles(tiles_.find(TileKey(tileId, type)));
+        if (ftiles != tiles_.end()) {
+            return FileStat(ftiles->second.data->size()
+                            , ftiles->second.lastModified
+                            , storage::contentType(type));
+        }
+
+        if (spilled_) { return spillCache_.stat(tileId, type); }
+    }
+
+    LOGTHROW(err1, storage::NoSuchFile)
+        << "Tile " << tileId << " file <" << type
+        << "> not found in in-memory tileset " << root() << ".";
+    throw;
+}
+
+storage::Resources MemoryDriver::resources_impl() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto resources(spillCache_.resources());
+    resources.memory += used_;
+    for (const auto &item : files_) {
+        resources.memory += item.second.data->size();
+    }
+    return resources;
+}
+
+void MemoryDriver::flush_impl()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    spillCache_.flush();
+}
+
+void MemoryDriver::drop_impl()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        files_.clear();
+        tiles_.clear();
+        lru_.clear();
+        used_ = 0;
+    }
+
+    // remove whole root directory
+    remove_all(root());
+}
+
+Driver::pointer MemoryDriver::clone_impl(const boost::filesystem::path&
+                                         , const CloneOptions&)
+    const
+{
+    // generic clone copies content into persistent tileset
+    return {};
+}
+
+std::string MemoryDriver::info_impl() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::ostringstream os;
+    os << "memory (budget=" << options().budget
+       << ", used=" << used_ << ", spilled=" << spilled_ << ")";
+    return os.str();
+}
+
+boost::any MemoryOptions::relocate(const RelocateOptions&
+                                   , const std::string &prefix) const
+{
+    LOG(info3) << prefix << "Memory driver has nothing to relocate.";
+    return {};
+}
+
+bool MemoryDriver::reencode(const boost::filesystem::path&
+                            , const MemoryOptions&
+                            , const ReencodeOptions&
+                            , const std::string&)
+{
+    return false;
+}
+
+} } } // namespace vtslibs::vts::driver
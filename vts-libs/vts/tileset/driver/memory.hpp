@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+#ifndef vtslibs_vts_tileset_driver_memory_hpp_included_
+#define vtslibs_vts_tileset_driver_memory_hpp_included_
+
+#include <map>
+#include <list>
+#include <mutex>
+#include <memory>
+
+#include "../driver.hpp"
+#include "./cache.hpp"
+
+namespace vtslibs { namespace vts { namespace driver {
+
+/** Driver for transient tilesets.
+ *
+ *  All files are kept in memory. Once memory occupied by tile files exceeds
+ *  configured budget least recently used tile files are spilled into plain
+ *  tilar storage under root/spill. Metadata are never spilled.
+ *
+ *  Content lives only as long as the driver itself (spill storage is removed
+ *  on destruction); clone tileset into persistent one to keep the data.
+ */
+class MemoryDriver : public Driver {
+public:
+    typedef std::shared_ptr<MemoryDriver> pointer;
+
+    /** Creates new storage. Existing storage is overwritten only if mode ==
+     *  CreateMode::overwrite.
+     */
+    MemoryDriver(const boost::filesystem::path &root
+                 , const MemoryOptions &options
+                 , const CloneOptions &cloneOptions);
+
+    virtual ~MemoryDriver();
+
+    /** Nothing to reencode, in-memory tileset is never persistent.
+     */
+    static bool reencode(const boost::filesystem::path &root
+                         , const MemoryOptions &driverOptions
+                         , const ReencodeOptions &options
+                         , const std::string &prefix = "");
+
+private:
+    virtual OStream::pointer output_impl(const File type);
+
+    virtual IStream::pointer input_impl(File type) const;
+
+    virtual IStream::pointer input_impl(File type, const NullWhenNotFound_t&)
+        const;
+
+    virtual OStream::pointer
+    output_impl(const TileId &tileId, TileFile type);
+
+    virtual IStream::pointer
+    input_impl(const TileId &tileId, TileFile type) const;
+
+    virtual IStream::pointer
+    input_impl(const TileId &tileId, TileFile type, const NullWhenNotFound_t&)
+        const;
+
+    virtual void drop_impl();
+
+    virtual void flush_impl();
+
+    virtual FileStat stat_impl(File type) const;
+
+    virtual FileStat stat_impl(const TileId &tileId, TileFile type) const;
+
+    virtual Resources resources_impl() const;
+
+    virtual Driver::pointer
+    clone_impl(const boost::filesystem::path &root
+               , const CloneOptions &cloneOptions) const;
+
+    virtual std::string info_impl() const;
+
+    inline const MemoryOptions& options() const {
+        return Driver::options<const MemoryOptions&>();
+    }
+
+    struct Record {
+        typedef std::shared_ptr<const std::string> Data;
+        Data data;
+        std::time_t lastModified;
+
+        Record(const Data &data = Data(), std::time_t lastModified = 0)
+            : data(data), lastModified(lastModified)
+        {}
+    };
+
+    typedef std::pair<TileId, TileFile> TileKey;
+
+    struct TileRecord : Record {
+        std::list<TileKey>::iterator lru;
+
+        TileRecord(const Data &data, std::time_t lastModified
+                   , std::list<TileKey>::iterator lru)
+            : Record(data, lastModified), lru(lru)
+        {}
+    };
+
+    /** Stores file content.
+     */
+    void store(File type, std::string &&data);
+
+    /** Stores tile file content, spills when over budget.
+     */
+    void store(const TileKey &key, std::string &&data);
+
+    /** Spills least recently used tile files until memory fits into budget.
+     *  Must be called under lock.
+     */
+    void spill();
+
+    mutable std::mutex mutex_;
+    std::map<File, Record> files_;
+    std::map<TileKey, TileRecord> tiles_;
+
+    /** Tile files, most recently used first.
+     */
+    mutable std::list<TileKey> lru_;
+
+    /** Memory occupied by tile files.
+     */
+    std::size_t used_;
+
+    /** Number of spilled tile files.
+     */
+    std::size_t spilled_;
+
+    const boost::filesystem::path spillRoot_;
+    mutable driver::Cache spillCache_;
+};
+
+} } } // namespace vtslibs::vts::driver
+
+#endif // vtslibs_vts_tileset_driver_memory_hpp_included_
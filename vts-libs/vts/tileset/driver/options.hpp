@@ -55,7 +55,8 @@ class PlainOptions {
 public:
     PlainOptions()
         : binaryOrder_(0), tileMask_(0)
-        , metaUnusedBits_(0)
+        , metaUnusedBits_(0), reclaimSpace_(false), checksums_(false)
+        , preallocate_(0)
     {}
 
     PlainOptions(std::uint8_t binaryOrder
@@ -63,7 +64,8 @@ public:
         : binaryOrder_(binaryOrder)
         , uuid_(generateUuid())
         , tileMask_(calculateMask(binaryOrder))
-        , metaUnusedBits_(metaUnusedBits)
+        , metaUnusedBits_(metaUnusedBits), reclaimSpace_(false)
+        , checksums_(false), preallocate_(0)
     {}
 
     /** Copy ctor with force uuid generation option
@@ -73,6 +75,10 @@ public:
         , uuid_(generateUuid ? PlainOptions::generateUuid() : other.uuid_)
         , tileMask_(calculateMask(binaryOrder_))
         , metaUnusedBits_(other.metaUnusedBits_)
+        , contentStore_(other.contentStore_)
+        , reclaimSpace_(other.reclaimSpace_)
+        , checksums_(other.checksums_)
+        , preallocate_(other.preallocate_)
     {}
 
     std::uint8_t binaryOrder() const { return binaryOrder_; }
@@ -92,6 +98,22 @@ public:
 
     long tileMask() const { return tileMask_; }
 
+    const boost::optional<boost::filesystem::path>& contentStore() const {
+        return contentStore_;
+    }
+    void contentStore(const boost::optional<boost::filesystem::path> &value) {
+        contentStore_ = value;
+    }
+
+    bool reclaimSpace() const { return reclaimSpace_; }
+    void reclaimSpace(bool value) { reclaimSpace_ = value; }
+
+    bool checksums() const { return checksums_; }
+    void checksums(bool value) { checksums_ = value; }
+
+    std::size_t preallocate() const { return preallocate_; }
+    void preallocate(std::size_t value) { preallocate_ = value; }
+
     /** Tilar options derived from the above for tiles.
      */
     Tilar::Options tilar(unsigned int filesPerTile) const;
@@ -106,6 +128,12 @@ public:
      */
     Index index(TileId tileId, storage::TileFile fileType, int type) const;
 
+    /** Inverse of index(): converts tilar file index in the super grid and a
+     *  file index inside this archive back into tileId.
+     */
+    TileId tileId(const TileId &archive, const Tilar::FileIndex &file
+                  , storage::TileFile fileType) const;
+
     /** Tries to relocate resources. Returns valid result in case of relocation.
      */
     boost::any relocate(const RelocateOptions &options
@@ -134,6 +162,27 @@ private:
      */
     std::uint8_t metaUnusedBits_;
 
+    /** Content-addressed store shared by tilesets. Tile files are stored
+     *  there (once per content) instead of in tilar archives if set.
+     */
+    boost::optional<boost::filesystem::path> contentStore_;
+
+    /** Release disk space of replaced tile files on commit. Off by default:
+     *  readers holding older index of an archive (another driver instance,
+     *  delivery) or hardlinked copies of the archive would read zeros.
+     */
+    bool reclaimSpace_;
+
+    /** Store checksum of every tile file in newly created tilar archives.
+     *  Existing archives keep their own format.
+     */
+    bool checksums_;
+
+    /** Preallocation chunk size (in bytes) for archives opened for writing;
+     *  keeps data written during encoding contiguous. 0 = off.
+     */
+    std::size_t preallocate_;
+
     static long calculateMask(std::uint8_t order);
     static boost::uuids::uuid generateUuid();
 };
@@ -179,12 +228,40 @@ struct LocalOptions {
                         , const std::string &prefix) const;
 };
 
+/** Read-only single file bundle. Bundle lives in tileset root.
+ */
+struct BundleOptions {
+    boost::any relocate(const RelocateOptions &options
+                        , const std::string &prefix) const;
+};
+
+/** Transient in-memory tileset.
+ */
+struct MemoryOptions {
+    /** Memory budget (in bytes) for tile data. Least recently used tile files
+     *  are spilled to disk when exceeded.
+     */
+    std::size_t budget;
+
+    /** Options of on-disk spill storage.
+     */
+    PlainOptions spill;
+
+    MemoryOptions(std::size_t budget = (std::size_t(256) << 20)
+                  , const PlainOptions &spill = PlainOptions(5))
+        : budget(budget), spill(spill)
+    {}
+
+    boost::any relocate(const RelocateOptions &options
+                        , const std::string &prefix) const;
+};
+
 // inlines
 
 inline Tilar::Options PlainOptions::tilar(unsigned int filesPerTile)
     const
 {
-    return { binaryOrder_, filesPerTile, uuid_ };
+    return { binaryOrder_, filesPerTile, uuid_, checksums_ };
 }
 
 inline PlainOptions::Index
@@ -202,6 +279,22 @@ PlainOptions::index(TileId i, storage::TileFile fileType, int type) const
     };
 }
 
+inline TileId PlainOptions::tileId(const TileId &archive
+                                   , const Tilar::FileIndex &file
+                                   , storage::TileFile fileType) const
+{
+    TileId i(archive.lod, (archive.x << binaryOrder_) | file.col
+             , (archive.y << binaryOrder_) | file.row);
+
+    if (fileType == storage::TileFile::meta) {
+        // expand metatile space
+        i.x <<= metaUnusedBits_;
+        i.y <<= metaUnusedBits_;
+    }
+
+    return i;
+}
+
 } } } // namespace vtslibs::vts::driver
 
 #endif // vtslibs_vts_tileset_driver_options_hpp_included_
@@ -102,8 +102,11 @@ PlainDriver::PlainDriver(const boost::filesystem::path &root
                          , const OpenOptions &openOptions
                          , const PlainOptions &options)
     : Driver(root, openOptions, options)
-    , cache_(this->root(), this->options<PlainOptions>(), true)
+    , cache_(this->root(), this->options<PlainOptions>()
+             , (openOptions.openMode() == OpenMode::readOnly))
 {
+    // in-place update: archives are opened in append mode
+    readOnly(openOptions.openMode() == OpenMode::readOnly);
 }
 
 PlainDriver::~PlainDriver() {}
@@ -148,6 +151,14 @@ IStream::pointer PlainDriver::input_impl(const TileId &tileId, TileFile type
     return cache_.input(tileId, type, NullWhenNotFound);
 }
 
+std::vector<IStream::pointer>
+PlainDriver::input_impl(const TileFileRequest::list &files
+                        , const NullWhenNotFound_t&)
+    const
+{
+    return cache_.input(files, NullWhenNotFound);
+}
+
 FileStat PlainDriver::stat_impl(File type) const
 {
     const auto name(filePath(type));
@@ -166,6 +177,11 @@ storage::Resources PlainDriver::resources_impl() const
     return cache_.resources();
 }
 
+void PlainDriver::listTileFiles_impl(const TileFileOp &op) const
+{
+    cache_.list(op);
+}
+
 
 void PlainDriver::flush_impl()
 {
@@ -174,6 +190,9 @@ void PlainDriver::flush_impl()
 
 void PlainDriver::drop_impl()
 {
+    // release shared content first
+    cache_.drop();
+
     // remove whole root directory
     remove_all(root());
 }
@@ -195,6 +214,14 @@ std::string PlainDriver::info_impl() const
     if (int metaUnusedBits = o.metaUnusedBits()) {
         os << ", metaUnusedBits=" << metaUnusedBits;
     }
+    if (const auto &contentStore = o.contentStore()) {
+        os << ", contentStore=" << *contentStore;
+    }
+    if (o.reclaimSpace()) { os << ", reclaimSpace"; }
+    if (o.checksums()) { os << ", checksums"; }
+    if (const auto preallocate = o.preallocate()) {
+        os << ", preallocate=" << preallocate;
+    }
 
     os << ")";
     return os.str();
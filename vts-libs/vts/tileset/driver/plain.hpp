@@ -80,6 +80,10 @@ private:
     input_impl(const TileId &tileId, TileFile type, const NullWhenNotFound_t&)
         const;
 
+    virtual std::vector<IStream::pointer>
+    input_impl(const TileFileRequest::list &files
+               , const NullWhenNotFound_t&) const;
+
     virtual void drop_impl();
 
     virtual void flush_impl();
@@ -90,6 +94,8 @@ private:
 
     virtual Resources resources_impl() const;
 
+    virtual void listTileFiles_impl(const TileFileOp &op) const;
+
     virtual Driver::pointer
     clone_impl(const boost::filesystem::path &root
                , const CloneOptions &cloneOptions) const;
@@ -137,6 +137,8 @@ public:
     {
         // update merge options
         mergeOptions_.clip = options.clip;
+        // single-sourced tiles can be copied as is unless we re-texture them
+        mergeOptions_.passthrough = !options.textureQuality;
 
         // make world complete
         world_.complete();
@@ -297,10 +299,17 @@ void Merger::mergeTile(const NodeInfo &nodeInfo, const TileId &tileId
     auto tile(processTile(nodeInfo, tileId, parentSource
                               , Constraints(*this, g, ng)));
 
-    if (tile) {
+    registry::IdSet textureLayers;
+    if (auto raw = tile.rawTile(textureLayers)) {
+        // place pass-through tile to glue
+        raw->metanode.alien(isAlienTile(tile));
+        glue_.setTile(tileId, *raw, &nodeInfo);
+        glue_.addBoundLayers(textureLayers);
+    } else if (tile) {
         // place tile to glue
         glue_.setTile(tileId
-                      , tile.tile(options_.textureQuality)
+                      , tile.tile(options_.textureQuality
+                                  , options_.adaptiveQuality)
                       .setAlien(isAlienTile(tile))
                       , &nodeInfo);
     }
@@ -490,16 +499,13 @@ TileSet::analyzeGlue(const list &sets, const GlueCreationOptions&)
     return stat;
 }
 
-void TileSet::createGlue(TileSet &glue, const list &sets
+TileSet::GlueGenerateSet
+TileSet::glueGenerateSet(const list &sets
                          , const GlueCreationOptions &options)
 {
-    if (sets.size() < 2) {
-        LOG(info3) << "(glue) Too few sets to glue together ("
-                   << sets.size() << ").";
-        return;
-    }
+    GlueGenerateSet gs;
 
-    LOG(info3) << "(glue) Calculating generate set.";
+    if (sets.size() < 2) { return gs; }
 
     const auto *dumpRoot(getDumpDir());
 
@@ -507,17 +513,12 @@ void TileSet::createGlue(TileSet &glue, const list &sets
     const LodRange lr(range(sets));
     LOG(info2) << "LOD range: " << lr;
 
-    Lod glueCeiling(0);
+    gs.mesh = buildGenerateSet(sets, lr, options.generateSetManipulator);
 
-    auto generate(buildGenerateSet(sets, lr, options.generateSetManipulator));
+    dumpTileIndex(dumpRoot, "generate", gs.mesh);
+    LOG(info1) << "generate: " << gs.mesh.count();
 
-    dumpTileIndex(dumpRoot, "generate", generate);
-    LOG(info1) << "generate: " << generate.count();
-
-    if (generate.empty()) {
-        LOG(warn3) << "(glue) Nothing to generate. Bailing out.";
-        return;
-    }
+    if (gs.mesh.empty()) { return gs; }
 
     LOG(info3) << "(glue) Generate set calculated.";
 
@@ -526,18 +527,49 @@ void TileSet::createGlue(TileSet &glue, const list &sets
 
     LOG(info2) << "Navtile LOD range: " << navLr;
 
+    Lod glueCeiling(0);
     auto navtileGenerateRaw
         (buildGenerateSet(dumpRoot, navLr, sets
                           , TileIndex::Flag::navtile, glueCeiling));
     dumpTileIndex(dumpRoot, "generate-navtile-raw", navtileGenerateRaw);
 
-    auto navtileGenerate(optimizeGenerateSet(navtileGenerateRaw, dumpRoot
-                                             , navLr, sets, glueCeiling));
-    dumpTileIndex(dumpRoot, "generate-navtile", navtileGenerate);
+    gs.navtile = optimizeGenerateSet(navtileGenerateRaw, dumpRoot
+                                     , navLr, sets, glueCeiling);
+    dumpTileIndex(dumpRoot, "generate-navtile", gs.navtile);
+
+    return gs;
+}
+
+void TileSet::createGlue(TileSet &glue, const list &sets
+                         , const GlueCreationOptions &options)
+{
+    if (sets.size() < 2) {
+        LOG(info3) << "(glue) Too few sets to glue together ("
+                   << sets.size() << ").";
+        return;
+    }
+
+    createGlue(glue, sets, glueGenerateSet(sets, options), options);
+}
+
+void TileSet::createGlue(TileSet &glue, const list &sets
+                         , const GlueGenerateSet &generateSet
+                         , const GlueCreationOptions &options)
+{
+    if (sets.size() < 2) {
+        LOG(info3) << "(glue) Too few sets to glue together ("
+                   << sets.size() << ").";
+        return;
+    }
+
+    if (generateSet.empty()) {
+        LOG(warn3) << "(glue) Nothing to generate. Bailing out.";
+        return;
+    }
 
     // run merge
     Merger(glue.detail()
-           , generate, navtileGenerate, sets, options);
+           , generateSet.mesh, generateSet.navtile, sets, options);
 
     // copy position from top dataset
     glue.setPosition(sets.back().getProperties().position);
@@ -1065,23 +1065,37 @@ void mergeNavtile(Output &output)
     output.forceNavtile().data(nt, mask);
 }
 
+/** Copies same-lod input as is into the output.
+ */
+void copyInput(Output &result, const Input &input)
+{
+    result.mesh = input.mesh();
+    result.geomExtents = input.node().geomExtents;
+
+    // update surface references of all submeshes
+    for (auto &sm : *result.mesh) {
+        sm.surfaceReference = input.id() + 1;
+    }
+
+    if (input.hasAtlas()) { result.atlas = input.atlas(); }
+    if (input.hasNavtile()) { result.navtile = input.navtile(); }
+}
+
 Output singleSourced(const TileId &tileId, const NodeInfo &nodeInfo
                      , const Input &input, const Input::list &navtileSource
-                     , bool generateNavtile)
+                     , bool generateNavtile, const MergeOptions &options)
 {
     Output result(tileId, input, navtileSource);
     if (input.tileId().lod == tileId.lod) {
-        // as is -> copy
-        result.mesh = input.mesh();
-        result.geomExtents = input.node().geomExtents;
-
-        // update surface references of all submeshes
-        for (auto &sm : *result.mesh) {
-            sm.surfaceReference = input.id() + 1;
+        if (options.passthrough && !generateNavtile) {
+            // as is -> do not even load data
+            result.passthrough = input;
+            result.geomExtents = input.node().geomExtents;
+            return result;
         }
 
-        if (input.hasAtlas()) { result.atlas = input.atlas(); }
-        if (input.hasNavtile()) { result.navtile = input.navtile(); }
+        // as is -> copy
+        copyInput(result, input);
         if (generateNavtile) { mergeNavtile(result); }
         return result;
     }
@@ -1220,7 +1234,8 @@ Output mergeTile(const TileId &tileId
         // just one source
         return singleSourced(tileId, nodeInfo, source.front()
                              , filterSources(source, navtileSource)
-                             , constraints.generateNavtile());
+                             , constraints.generateNavtile()
+                             , options);
     }
 
     // merge result
@@ -1251,7 +1266,8 @@ Output mergeTile(const TileId &tileId
         // process single source
         return singleSourced(tileId, nodeInfo, result.source.mesh.front()
                              , result.source.navtile
-                             , constraints.generateNavtile());
+                             , constraints.generateNavtile()
+                             , options);
     }
 
     // merge meshes
@@ -1331,8 +1347,12 @@ Output mergeTile(const TileId &tileId
     return result;
 }
 
-Tile Output::tile(int textureQuality)
+Tile Output::tile(int textureQuality
+                  , const boost::optional<AdaptiveQuality> &adaptiveQuality)
 {
+    // pass-through tile -> materialize
+    if (passthrough && !mesh) { copyInput(*this, *passthrough); }
+
     Tile tile;
 
     if (textureQuality && mesh) {
@@ -1346,7 +1366,10 @@ Tile Output::tile(int textureQuality)
 
         if (textureQuality) {
             // optimize
-            auto optimized(mergeSubmeshes(tileId, m, a, textureQuality));
+            SubmeshMergeOptions options;
+            options.adaptiveQuality = adaptiveQuality;
+            auto optimized(mergeSubmeshes(tileId, m, a, textureQuality
+                                          , options));
             // assign output
             tile.mesh = std::get<0>(optimized);
             tile.atlas = std::get<1>(optimized);
@@ -1375,4 +1398,45 @@ Tile Output::tile(int textureQuality)
     return tile;
 }
 
+boost::optional<vts::TileSource>
+Output::rawTile(registry::IdSet &textureLayers) const
+{
+    if (!passthrough) { return boost::none; }
+
+    const auto &input(*passthrough);
+    const auto &owner(*input.owner());
+    const auto &node(input.node());
+
+    auto raw(owner.getTileSource(input.tileId()));
+
+    // rewrite surface references in mesh
+    auto mesh(std::make_shared<storage::StringIStream>(*raw.mesh));
+    if (!copyMesh(*raw.mesh, mesh->sink(), input.id() + 1, raw.mesh->name()
+                  , &textureLayers))
+    {
+        return boost::none;
+    }
+    mesh->updateSize();
+    raw.mesh = mesh;
+
+    // build metanode the same way as TileSet::setTile(Tile) does
+    MetaNode metanode;
+    metanode.geometry(true);
+    metanode.extents = node.extents;
+    metanode.geomExtents = geomExtents;
+    metanode.applyTexelSize(node.applyTexelSize());
+    metanode.texelSize = node.texelSize;
+    metanode.internalTextureCount(node.internalTextureCount());
+    metanode.updateCredits(node.credits());
+    if (node.navtile()) {
+        metanode.navtile(true);
+        metanode.heightRange = node.heightRange;
+    }
+
+    raw.metanode = metanode;
+    raw.extraFlags = owner.extraFlags(input.tileId());
+
+    return raw;
+}
+
 } } } // namespace vtslibs::vts::merge
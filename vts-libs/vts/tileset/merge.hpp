@@ -40,6 +40,7 @@
 #include "../atlas.hpp"
 #include "../opencv/navtile.hpp"
 #include "../meshopinput.hpp"
+#include "../tilesource.hpp"
 #include "./detail.hpp"
 
 namespace vtslibs { namespace vts { namespace merge {
@@ -75,6 +76,12 @@ struct Output {
     // list of tiles this tile was generated from
     TileSource source;
 
+    /** Set when tile is an unmodified copy of this (same-lod) input. Such
+     *  tile can be copied as is, only surface references need to be updated
+     *  (see rawTile). Mesh, atlas and navtile are not loaded in such case.
+     */
+    boost::optional<Input> passthrough;
+
     explicit Output(const TileId &tileId) : tileId(tileId) {}
 
     Output(const TileId &tileId, const Input &input
@@ -87,7 +94,7 @@ struct Output {
     {}
 
     operator bool() const {
-        return mesh || atlas || navtile;
+        return mesh || atlas || navtile || passthrough;
     }
 
     const Mesh* getMesh() const { return mesh ? &*mesh : nullptr; }
@@ -100,8 +107,23 @@ struct Output {
      *
      *  NB: all shared pointers in returned Tile point to data inside this
      *  Output instance. Do not use tile after this instance destruction!
+     *
+     *  Repacked textures are encoded with adaptive quality if given.
      */
-    Tile tile(int textureQuality);
+    Tile tile(int textureQuality
+              , const boost::optional<AdaptiveQuality> &adaptiveQuality
+              = boost::none);
+
+    /** Takes pass-through content as a raw tile: data streams are copied from
+     *  the input, mesh has its surface references updated at byte level.
+     *
+     *  Returns boost::none if this is not a pass-through tile or the
+     *  pass-through mesh cannot be rewritten; use tile() in such case.
+     *
+     * \param textureLayers external texture layers used by mesh are added here
+     */
+    boost::optional<vts::TileSource>
+    rawTile(registry::IdSet &textureLayers) const;
 
     Mesh& forceMesh();
     RawAtlas& forceAtlas();
@@ -127,7 +149,13 @@ struct Output {
 struct MergeOptions {
     bool clip;
 
-    MergeOptions() : clip(true) {}
+    /** Single-sourced same-lod tiles are not decoded but marked as
+     *  pass-through (see Output::passthrough). Caller must be able to handle
+     *  raw output.
+     */
+    bool passthrough;
+
+    MergeOptions() : clip(true), passthrough(false) {}
 };
 
 /** Various merging constraints.
@@ -0,0 +1,189 @@
+/**
+ * Copyright (c) 2017 Melown Technologies SE
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * *  Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+/**
+ * \file vts/tileset/recover.cpp
+ *
+ * Tile index recovery from tileset's archives.
+ */
+
+#include <vector>
+
+#include "dbglog/dbglog.hpp"
+
+#include "../../vts.hpp"
+#include "../mesh.hpp"
+#include "../metatile.hpp"
+#include "./driver.hpp"
+#include "./config.hpp"
+#include "./tilesetindex.hpp"
+
+namespace fs = boost::filesystem;
+
+namespace vtslibs { namespace vts {
+
+namespace {
+
+typedef TileIndex::Flag TiFlag;
+
+TiFlag::value_type flagsFromNode(const MetaNode &node)
+{
+    TiFlag::value_type m(0);
+    if (node.geometry()) {
+        m |= TiFlag::mesh;
+        if (node.alien()) { m |= TiFlag::alien; }
+    }
+    if (node.navtile()) { m |= TiFlag::navtile; }
+    if (node.internalTextureCount()) { m |= TiFlag::atlas; }
+    return m;
+}
+
+TiFlag::value_type fileFlag(TileFile type)
+{
+    switch (type) {
+    case TileFile::mesh: return TiFlag::mesh;
+    case TileFile::atlas: return TiFlag::atlas;
+    case TileFile::navtile: return TiFlag::navtile;
+    default: break;
+    }
+    return TiFlag::none;
+}
+
+} // namespace
+
+TileIndex recoverTileSetIndex(const fs::path &path
+                              , const RecoverIndexOptions &options)
+{
+    LOG(info3) << "Recovering tile index of tileset " << path << ".";
+
+    // read-only access: archives are never touched
+    auto driver(Driver::open(path));
+    const auto properties(tileset::loadConfig(*driver));
+    const auto &referenceFrame(registry::system.referenceFrames
+                               (properties.referenceFrame));
+    const auto mbo(referenceFrame.metaBinaryOrder);
+
+    // collect content of archives
+    TileIndex files;
+    std::vector<TileId> metaIds;
+    driver->listTileFiles([&](const TileId &tileId, TileFile type)
+    {
+        if (type == TileFile::meta) {
+            metaIds.push_back(tileId);
+            return;
+        }
+        files.setMask(tileId, fileFlag(type));
+    });
+
+    LOG(info3) << "Found " << files.count() << " tiles and "
+               << metaIds.size() << " metatiles.";
+
+    // metatiles are authoritative for tiles they cover; files not mentioned
+    // there are left as they are
+    TileIndex index(files);
+    std::size_t mismatches(0);
+    for (const auto &metaId : metaIds) {
+        MetaTile::pointer meta;
+        try {
+            auto f(driver->input(metaId, TileFile::meta));
+            meta = loadMetaTile(&f->get(), mbo, f->name());
+        } catch (const std::exception &e) {
+            LOG(warn2) << "Unable to load metatile " << metaId
+                       << ", using files only: <" << e.what() << ">.";
+            continue;
+        }
+
+        meta->for_each([&](const TileId &tileId, const MetaNode &node)
+        {
+            const auto present(files.get(tileId) & TiFlag::content);
+            const auto expected(flagsFromNode(node));
+
+            if ((expected & TiFlag::content) != present) {
+                LOG(info1) << "Tile " << tileId << ": metatile flags 0x"
+                           << std::hex << expected << " differ from files 0x"
+                           << present << std::dec << ".";
+                ++mismatches;
+            }
+
+            // advertise only files that really exist
+            auto flags(expected & present);
+            if (flags & TiFlag::mesh) { flags |= (expected & TiFlag::alien); }
+            index.setMask(tileId, TiFlag::content | TiFlag::alien, flags);
+        });
+    }
+
+    if (mismatches) {
+        LOG(warn2) << mismatches << " tile(s) differ between metatiles and "
+                   "archive content; metatiles have been obeyed.";
+    }
+
+    if (options.meshFlags) {
+        // watertight/multimesh are not stored in metatiles, fetch them from
+        // mesh headers
+        TileIndex extra;
+        traverse(index, [&](const TileId &tileId, QTree::value_type flags)
+        {
+            if (!(flags & TiFlag::mesh)) { return; }
+
+            TiFlag::value_type value(0);
+            try {
+                const auto mm(loadMeshMask
+                              (driver->input(tileId, TileFile::mesh)));
+                if (mm.coverageMask.full()) { value |= TiFlag::watertight; }
+                if (mm.surfaceReferences.size() > 1) {
+                    value |= TiFlag::multimesh;
+                }
+            } catch (const std::exception &e) {
+                LOG(warn2) << "Unable to load mesh mask of tile " << tileId
+                           << ": <" << e.what() << ">.";
+            }
+            if (value) { extra.set(tileId, value); }
+        });
+
+        index.combine(extra, [](QTree::value_type o, QTree::value_type n)
+                      -> QTree::value_type
+        {
+            return o | n;
+        });
+    } else {
+        LOG(info3) << "Watertight and multimesh flags not recovered "
+            "(mesh flags not requested).";
+    }
+
+    if (options.dryRun) {
+        LOG(info3) << "Dry run: recovered tile index not saved.";
+        return index;
+    }
+
+    tileset::Index tsi(mbo);
+    tsi.tileIndex = index;
+    tileset::saveTileSetIndex
+        (tsi, *Driver::open(path, OpenOptions().openMode(OpenMode::readWrite)));
+
+    LOG(info3) << "Recovered tile index of tileset " << path << " saved.";
+    return index;
+}
+
+} } // namespace vtslibs::vts
@@ -23,6 +23,9 @@
  * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  */
+#include <atomic>
+#include <sstream>
+
 #include <boost/format.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/range/adaptor/reversed.hpp>
@@ -39,6 +42,7 @@
 #include "./detail.hpp"
 #include "./driver.hpp"
 #include "./config.hpp"
+#include "./driver/bundle.hpp"
 
 namespace fs = boost::filesystem;
 
@@ -133,6 +137,21 @@ void TileSet::setSurrogateValue(const TileId &tileId, float value)
     detail().setSurrogateValue(tileId, value);
 }
 
+void TileSet::removeTile(const TileId &tileId)
+{
+    detail().removeTile(tileId);
+}
+
+void TileSet::removeSubtree(const TileId &tileId)
+{
+    detail().removeSubtree(tileId);
+}
+
+void TileSet::replaceSubtree(const TileId &tileId, const TileSet &src)
+{
+    detail().replaceSubtree(tileId, src.detail());
+}
+
 MetaNode TileSet::getMetaNode(const TileId &tileId) const
 {
     auto node(detail().findNode(tileId));
@@ -226,6 +245,16 @@ driver::PlainOptions plainOptions(const TileSetProperties &properties)
     return driver::PlainOptions(5, referenceFrame.metaBinaryOrder);
 }
 
+/** Content store path is saved in tileset config, make it independent on
+ *  current working directory.
+ */
+boost::optional<fs::path>
+absoluteContentStore(const boost::optional<fs::path> &store)
+{
+    if (!store) { return store; }
+    return fs::absolute(*store);
+}
+
 GeomExtents geomExtents(const NodeInfo &ni, const Mesh &mesh)
 {
     // re-compute geom extents
@@ -347,12 +376,24 @@ struct TileSet::Factory
             copyFile(is, dd.output(tileId, type));
     }
 
+    /** Atlas repacking statistics.
+     */
+    struct RepackStat {
+        std::atomic<std::size_t> before;
+        std::atomic<std::size_t> after;
+
+        RepackStat() : before(0), after(0) {}
+    };
+
     static void reencode(const TileId &tileId, const NodeInfo &ni
                          , const Driver &sd, Driver &dd
                          , bool hasMesh, bool hasAtlas
                          , CloneOptions::EncodeFlag::value_type eflags
                          , MetaNode &metanode
-                         , int textureQuality)
+                         , int textureQuality
+                         , const boost::optional<AdaptiveQuality>
+                         &adaptiveQuality
+                         , RepackStat &repackStat)
     {
         Mesh mesh;
         RawAtlas atlas;
@@ -366,6 +407,45 @@ struct TileSet::Factory
             atlas.deserialize(is->get(), is->name());
         }
 
+        if (hasMesh && hasAtlas
+            && (eflags & CloneOptions::EncodeFlag::repack))
+        {
+            if (const auto repacked
+                = repack(atlas, mesh, textureQuality, adaptiveQuality))
+            {
+                // repacked, both mesh and atlas must be written
+                std::ostringstream tmp;
+                repacked->serialize(tmp);
+                const auto data(tmp.str());
+
+                repackStat.before
+                    += sd.stat(tileId, storage::TileFile::atlas).size;
+                repackStat.after += data.size();
+
+                UTILITY_OMP(critical(clone_dd))
+                {
+                    auto os(dd.output(tileId, storage::TileFile::mesh));
+                    saveMesh(os, mesh, &*repacked);
+                    os->close();
+                }
+
+                UTILITY_OMP(critical(clone_dd))
+                {
+                    auto os(dd.output(tileId, storage::TileFile::atlas));
+                    os->get().write(data.data(), data.size());
+                    os->close();
+                }
+
+                if ((eflags & CloneOptions::EncodeFlag::meta)
+                    && vts::empty(metanode.geomExtents))
+                {
+                    metanode.geomExtents = geomExtents(ni, mesh);
+                    metanode.geomExtents.makeAverageSurrogate();
+                }
+                return;
+            }
+        }
+
         if (hasMesh) {
             if (eflags & CloneOptions::EncodeFlag::mesh) {
                 UTILITY_OMP(critical(clone_dd))
@@ -409,6 +489,64 @@ struct TileSet::Factory
         }
     }
 
+    /** Clips tile's mesh (and atlas) to spatial filter's extents and writes
+     *  result to destination driver.
+     *
+     *  Returns number of submeshes left in the tile (zero if nothing is left).
+     */
+    static std::size_t clip(const TileId &tileId, const NodeInfo &ni
+                     , const Driver &sd, Driver &dd
+                     , bool hasAtlas, MetaNode &metanode
+                     , const SpatialFilterMatcher &matcher)
+    {
+        Mesh mesh(loadMesh(sd.input(tileId, storage::TileFile::mesh)));
+        RawAtlas atlas;
+
+        if (hasAtlas) {
+            auto is(sd.input(tileId, storage::TileFile::atlas));
+            atlas.deserialize(is->get(), is->name());
+        }
+
+        const auto &physicalSrs(ni.referenceFrame().model.physicalSrs);
+        const CsConvertor phys2sds(physicalSrs, ni.srs());
+        clipMesh(mesh, (hasAtlas ? &atlas : nullptr)
+                 , phys2sds, CsConvertor(ni.srs(), physicalSrs)
+                 , ni.extents(), matcher.extents(ni.srs()));
+
+        if (mesh.submeshes.empty()) { return 0; }
+
+        UTILITY_OMP(critical(clone_dd))
+        {
+            auto os(dd.output(tileId, storage::TileFile::mesh));
+            saveMesh(os, mesh, (hasAtlas ? &atlas : nullptr));
+            os->close();
+        }
+
+        if (hasAtlas && atlas.size()) {
+            UTILITY_OMP(critical(clone_dd))
+            {
+                auto os(dd.output(tileId, storage::TileFile::atlas));
+                atlas.serialize(os->get());
+                os->close();
+            }
+        }
+
+        // update metanode to reflect clipped geometry
+        metanode.extents = normalizedExtents(ni.referenceFrame()
+                                             , extents(mesh));
+
+        const auto surrogate(metanode.geomExtents.surrogate);
+        metanode.geomExtents = geomExtents(phys2sds, mesh);
+        if (GeomExtents::validSurrogate(surrogate)) {
+            metanode.geomExtents.surrogate = surrogate;
+        } else {
+            metanode.geomExtents.makeAverageSurrogate();
+        }
+
+        metanode.internalTextureCount(hasAtlas ? atlas.size() : 0);
+        return mesh.submeshes.size();
+    }
+
     static void clone(const std::string &reportName
                       , const Detail *src, Detail *dst
                       , const CloneOptions *cloneOptions)
@@ -416,7 +554,8 @@ struct TileSet::Factory
         // simple case? use fully optimized version
         if (!(cloneOptions->lodRange()
               || cloneOptions->metaNodeManipulator()
-              || cloneOptions->encodeFlags()))
+              || cloneOptions->encodeFlags()
+              || cloneOptions->spatialFilter()))
         {
             return clone(reportName, *src, *dst);
         }
@@ -435,6 +574,15 @@ struct TileSet::Factory
 
         auto eflags(cloneOptions->encodeFlags());
 
+        RepackStat repackStat;
+        auto *rs(&repackStat);
+
+        boost::optional<SpatialFilterMatcher> matcher_;
+        if (const auto &sf = cloneOptions->spatialFilter()) {
+            matcher_ = boost::in_place(*sf, src->referenceFrame);
+        }
+        const auto *matcher(matcher_ ? &*matcher_ : nullptr);
+
         if (eflags) {
             // renencoding, update revision if needed
             if (dst->properties.revision <= src->properties.revision) {
@@ -453,6 +601,16 @@ struct TileSet::Factory
                 return;
             }
 
+            // skip tiles outside spatial filter
+            auto sclass(SpatialClass::inside);
+            if (matcher) {
+                sclass = (*matcher)(NodeInfo(src->referenceFrame, tid));
+                if (sclass == SpatialClass::outside) {
+                    report();
+                    return;
+                }
+            }
+
             const MetaNode *metanode;
             UTILITY_OMP(critical(clone_sd))
                 metanode = src->findMetaNode(tid);
@@ -488,10 +646,30 @@ struct TileSet::Factory
                     return mn ? *mn : *metanode;
                 });
 
-                if (eflags) {
+                auto extraFlags(mask & TileIndex::Flag::nonmeta);
+
+                if (mesh && (sclass == SpatialClass::boundary)
+                    && (matcher->boundary() == SpatialFilter::Boundary::clip))
+                {
+                    // clip tile to filter, clipped mesh is not watertight
+                    extraFlags &= ~TileIndex::Flag::watertight;
+                    const auto submeshes
+                        (clip(tid, NodeInfo(src->referenceFrame, tid)
+                              , *sd, *dd, atlas, copyMetanode(), *matcher));
+                    if (!submeshes) {
+                        // nothing left
+                        mesh = false;
+                        LOG(info1) << "Tile " << tid
+                                   << " clipped out completely.";
+                    } else if (submeshes == 1) {
+                        // clipping could drop submeshes
+                        extraFlags &= ~TileIndex::Flag::multimesh;
+                    }
+                } else if (eflags) {
                     reencode(tid, NodeInfo(src->referenceFrame, tid)
                              , *sd, *dd, mesh, atlas, eflags, copyMetanode()
-                             , cloneOptions->textureQuality());
+                             , cloneOptions->textureQuality()
+                             , cloneOptions->adaptiveQuality(), *rs);
                 } else {
                     if (mesh) {
                         // copy mesh
@@ -505,27 +683,46 @@ struct TileSet::Factory
                     }
                 }
 
-                if (mask & TileIndex::Flag::navtile) {
-                    // copy navtile if allowed
-                    copyFileLocked(*sd, *dd, tid, storage::TileFile::navtile);
-                }
-
-                UTILITY_OMP(critical(clone_dd))
-                    if (*mnm) {
-                        // filter metanode
-                        dst->updateNode(tid, (*mnm)(useMetanode())
-                                        , (mask & TileIndex::Flag::nonmeta));
-                    } else {
-                        // pass metanode as-is
-                        dst->updateNode(tid, useMetanode()
-                                        , (mask & TileIndex::Flag::nonmeta));
+                // clipped out tile is dropped completely
+                if (mesh || !(mask & TileIndex::Flag::mesh)) {
+                    if (mask & TileIndex::Flag::navtile) {
+                        // copy navtile if allowed
+                        copyFileLocked(*sd, *dd, tid
+                                       , storage::TileFile::navtile);
                     }
 
-                LOG(info1) << "Stored tile " << tid << ".";
+                    UTILITY_OMP(critical(clone_dd))
+                        if (*mnm) {
+                            // filter metanode
+                            dst->updateNode(tid, (*mnm)(useMetanode())
+                                            , extraFlags);
+                        } else {
+                            // pass metanode as-is
+                            dst->updateNode(tid, useMetanode(), extraFlags);
+                        }
+
+                    LOG(info1) << "Stored tile " << tid << ".";
+                }
+
                 report();
             }
         });
 
+        if (eflags & CloneOptions::EncodeFlag::repack) {
+            const std::size_t before(repackStat.before);
+            const std::size_t after(repackStat.after);
+            LOG(info3)
+                << "Atlas repacking of <" << src->properties.id << "> saved "
+                << (before - after) << " bytes (" << before << " -> "
+                << after << " bytes in repacked atlases).";
+
+            const auto &aq(cloneOptions->adaptiveQuality());
+            if (aq && aq->report) {
+                LOG(info3) << "Adaptive texture encoding of <"
+                           << src->properties.id << ">: " << *aq->report;
+            }
+        }
+
         // properties have been changed
         dst->propertiesChanged = true;
     }
@@ -539,7 +736,7 @@ struct TileSet::Factory
             properties.id = *cloneOptions.tilesetId();
         }
 
-        if (cloneOptions.sameType()) {
+        if (cloneOptions.sameType() && !cloneOptions.spatialFilter()) {
             if (auto driver = src.driver().clone(path, cloneOptions)) {
                 return open(driver);
             }
@@ -548,7 +745,9 @@ struct TileSet::Factory
         // assisted cloning must be performed
 
         // regular type
-        properties.driverOptions = plainOptions(src.getProperties());
+        auto po(plainOptions(src.getProperties()));
+        po.contentStore(absoluteContentStore(cloneOptions.contentStore()));
+        properties.driverOptions = po;
 
         auto dst(TileSet::Factory::create(path, properties, cloneOptions));
 
@@ -582,6 +781,8 @@ struct TileSet::Factory
               , CloneOptions()
               .mode(CreateMode::overwrite)
               .encodeFlags(options.encodeFlags)
+              .textureQuality(options.textureQuality)
+              .adaptiveQuality(options.adaptiveQuality)
               );
 
         // swap srcPath and dstPath
@@ -604,6 +805,19 @@ TileSet createTileSet(const boost::filesystem::path &path
          , CloneOptions().mode(mode).tilesetId(properties.id));
 }
 
+TileSet createTileSet(const boost::filesystem::path &path
+                      , const TileSetProperties &properties
+                      , const CloneOptions &createOptions)
+{
+    TileSet::Properties tsprop(properties);
+    auto po(plainOptions(properties));
+    po.contentStore(absoluteContentStore(createOptions.contentStore()));
+    tsprop.driverOptions = po;
+
+    return TileSet::Factory::create
+        (path, tsprop, CloneOptions(createOptions).tilesetId(properties.id));
+}
+
 TileSet createTileSet(const boost::filesystem::path &path
                       , const TileSet::Properties &properties
                       , CreateMode mode)
@@ -685,6 +899,30 @@ TileSet createRemoteTileSet(const boost::filesystem::path &path
     return TileSet::Factory::open(driver);
 }
 
+TileSet createMemoryTileSet(const boost::filesystem::path &path
+                            , const TileSetProperties &properties
+                            , std::size_t budget
+                            , CreateMode mode)
+{
+    TileSet::Properties tsprop(properties);
+    tsprop.driverOptions = driver::MemoryOptions
+        (budget, plainOptions(properties));
+
+    return TileSet::Factory::create
+        (path, tsprop, CloneOptions().mode(mode).tilesetId(properties.id));
+}
+
+TileSet createBundleTileSet(const boost::filesystem::path &path
+                            , const boost::filesystem::path &sourcePath
+                            , const CloneOptions &createOptions)
+{
+    // bundle is generated from source driver, cannot go via Driver::create
+    auto source(Driver::open(sourcePath));
+    auto driver(std::make_shared<driver::BundleDriver>
+                (path, driver::BundleOptions(), createOptions, *source));
+    return TileSet::Factory::open(driver);
+}
+
 TileSet createLocalTileSet(const boost::filesystem::path &path
                            , const boost::filesystem::path &localPath
                            , const CloneOptions &createOptions)
@@ -699,8 +937,9 @@ TileSet createLocalTileSet(const boost::filesystem::path &path
 
 TileSet::Detail::Detail(const Driver::pointer &driver)
     : driverTsi_(driver->getTileIndex())
-    , readOnly(true), driver(driver)
+    , readOnly(driver->readOnly()), driver(driver)
     , propertiesChanged(false), metadataChanged(false)
+    , bumpRevision(!readOnly)
     , metaTiles(MetaCache::create(driver))
     , tsi(driverTsi_ ? *driverTsi_ : tsi_)
     , tileIndex(tsi.tileIndex)
@@ -722,6 +961,7 @@ TileSet::Detail::Detail(const Driver::pointer &driver
     , driverTsi_()
     , readOnly(false), driver(driver)
     , propertiesChanged(false), metadataChanged(false)
+    , bumpRevision(false)
     , referenceFrame(registry::system.referenceFrames
                      (properties.referenceFrame))
     , metaTiles(MetaCache::create(driver))
@@ -1282,6 +1522,196 @@ void TileSet::Detail::setSurrogateValue(const TileId &tileId, float value)
     node.update(tileId, metanode);
 }
 
+MetaNode TileSet::Detail::virtualNode(const TileId &tileId
+                                      , MetaNode::Flag::value_type childFlags)
+    const
+{
+    MetaNode node;
+    node.childFlags(childFlags);
+    for (const auto &childId : children(node, tileId)) {
+        if (const auto *child = findMetaNode(childId)) {
+            node.mergeExtents(*child);
+        }
+    }
+    return node;
+}
+
+void TileSet::Detail::updateAncestors(TileId tileId, bool unlink)
+{
+    while (tileId.lod) {
+        const auto parentId(parent(tileId));
+        auto parentNode(findNode(parentId));
+        if (!parentNode) { break; }
+
+        auto mn(*parentNode.metanode);
+        if (unlink) { mn.setChildFromId(tileId, false); }
+
+        if (mn.real()) {
+            // extents of real node cannot be separated from its own mesh's
+            // extents; keep them (superset) and stop since nothing changes
+            // above this node
+            parentNode.set(parentId, mn);
+            break;
+        }
+
+        if (mn.childFlags()) {
+            // virtual node with remaining children: shrink extents
+            parentNode.set(parentId, virtualNode(parentId, mn.childFlags()));
+            unlink = false;
+        } else {
+            // virtual node without children: drop
+            parentNode.set(parentId, MetaNode());
+            unlink = true;
+        }
+
+        // next round
+        tileId = parentId;
+    }
+}
+
+void TileSet::Detail::removeTile(const TileId &tileId)
+{
+    driver->wannaWrite("remove tile");
+
+    auto node(findNode(tileId));
+    if (!node || !node.metanode->real()) {
+        LOGTHROW(err2, storage::NoSuchTile)
+            << "Cannot remove non-existent tile " << tileId << ".";
+    }
+
+    LOG(info1) << "Removing tile " << tileId << ".";
+
+    // node with children is kept as a virtual one
+    const auto childFlags(node.metanode->childFlags());
+    node.set(tileId, childFlags ? virtualNode(tileId, childFlags)
+             : MetaNode());
+    updateAncestors(tileId, !childFlags);
+
+    // remove from tile index (must be done after all nodes are updated since
+    // metatile lookup uses tile index); data stay in the storage
+    tileIndex.unset(tileId);
+
+    lodRange = tileIndex.lodRange();
+    metadataChanged = true;
+    propertiesChanged = true;
+}
+
+std::size_t TileSet::Detail::removeSubtree(const TileId &tileId)
+{
+    driver->wannaWrite("remove subtree");
+
+    if (!tileIndex.validSubtree(tileId)) {
+        LOG(info2) << "Nothing to remove under tile " << tileId << ".";
+        return 0;
+    }
+
+    LOG(info2) << "Removing subtree rooted at " << tileId << ".";
+
+    // walk the subtree along child flags and drop all nodes; only metatiles
+    // touching the subtree are visited
+    std::size_t removed(0);
+    std::vector<TileId> todo(1, tileId);
+    while (!todo.empty()) {
+        const auto id(todo.back());
+        todo.pop_back();
+
+        auto node(findNode(id));
+        if (!node) { continue; }
+
+        if (node.metanode->real()) { ++removed; }
+        for (const auto &childId : children(*node.metanode, id)) {
+            todo.push_back(childId);
+        }
+        node.set(id, MetaNode());
+    }
+
+    updateAncestors(tileId, true);
+
+    // remove whole subtree from tile index; data stay in the storage
+    tileIndex.set(LodRange(tileId.lod, tileIndex.maxLod())
+                  , tileRange(tileId), 0);
+
+    lodRange = tileIndex.lodRange();
+    metadataChanged = true;
+    propertiesChanged = true;
+
+    LOG(info2) << "Removed " << removed << " tiles under " << tileId << ".";
+    return removed;
+}
+
+namespace {
+
+void copyTile(const Driver &sd, Driver &dd, const TileId &tileId
+              , TileIndex::Flag::value_type flags)
+{
+    if (flags & TileIndex::Flag::mesh) {
+        copyFile(sd.input(tileId, storage::TileFile::mesh)
+                 , dd.output(tileId, storage::TileFile::mesh));
+    }
+
+    if (flags & TileIndex::Flag::atlas) {
+        copyFile(sd.input(tileId, storage::TileFile::atlas)
+                 , dd.output(tileId, storage::TileFile::atlas));
+    }
+
+    if (flags & TileIndex::Flag::navtile){
+        copyFile(sd.input(tileId, storage::TileFile::navtile)
+                 , dd.output(tileId, storage::TileFile::navtile));
+    }
+}
+
+} // namespace
+
+void TileSet::Detail::replaceSubtree(const TileId &tileId, const Detail &src)
+{
+    driver->wannaWrite("replace subtree");
+
+    if (&src == this) {
+        LOGTHROW(err2, storage::InconsistentInput)
+            << "Cannot replace subtree " << tileId << " of <"
+            << properties.id << "> by itself.";
+    }
+
+    if (src.referenceFrame.id != referenceFrame.id) {
+        LOGTHROW(err2, storage::IncompatibleTileSet)
+            << "Cannot replace subtree " << tileId << " of <"
+            << properties.id << "> by content of <" << src.properties.id
+            << ">: different reference frames.";
+    }
+
+    const auto removed(removeSubtree(tileId));
+
+    // walk the source subtree along child flags and copy all real tiles
+    std::size_t added(0);
+    std::vector<TileId> todo;
+    if (src.tileIndex.validSubtree(tileId)) { todo.push_back(tileId); }
+    while (!todo.empty()) {
+        const auto id(todo.back());
+        todo.pop_back();
+
+        const auto *metanode(src.findMetaNode(id));
+        if (!metanode) { continue; }
+
+        for (const auto &childId : children(*metanode, id)) {
+            todo.push_back(childId);
+        }
+
+        if (!metanode->real()) { continue; }
+
+        const auto flags(src.tileIndex.get(id));
+        copyTile(*src.driver, *driver, id, flags);
+        updateNode(id, *metanode, flags & TileIndex::Flag::nonmeta);
+        ++added;
+    }
+
+    propertiesChanged = true;
+
+    LOG(info3)
+        << "Replaced subtree " << tileId << " of <" << properties.id
+        << ">: removed " << removed << " tiles, added " << added
+        << " tiles from <" << src.properties.id << ">.";
+}
+
 Mesh TileSet::Detail::getMesh(const TileId &tileId, const MetaNode *node)
     const
 {
@@ -1468,6 +1898,13 @@ void TileSet::Detail::flush()
     LOG(info2) << "Flushing <" << properties.id << ">.";
     driver->wannaWrite("flush");
 
+    // in-place update with some changes -> new revision
+    if (bumpRevision && changed()) {
+        ++properties.revision;
+        propertiesChanged = true;
+        bumpRevision = false;
+    }
+
     if (metadataChanged) {
         saveMetadata();
         metadataChanged = false;
@@ -1812,7 +2249,8 @@ TileIndex::Flag::value_type TileSet::Detail::extraFlags(const TileId &tileId)
 }
 
 void TileSet::paste(const TileSet &srcSet
-                    , const boost::optional<LodRange> &lodRange)
+                    , const boost::optional<LodRange> &lodRange
+                    , const boost::optional<SpatialFilter> &spatialFilter)
 {
     const auto &src(srcSet.detail());
     auto &dst(detail());
@@ -1830,6 +2268,11 @@ void TileSet::paste(const TileSet &srcSet
 
     LOG(info3) << "About to paste " << progress.total() << " tiles.";
 
+    boost::optional<SpatialFilterMatcher> matcher;
+    if (spatialFilter) {
+        matcher = boost::in_place(*spatialFilter, src.referenceFrame);
+    }
+
     traverse(src.tileIndex, [&](const TileId &tid, QTree::value_type mask)
     {
         // skip
@@ -1838,6 +2281,15 @@ void TileSet::paste(const TileSet &srcSet
             return;
         }
 
+        auto sclass(SpatialClass::inside);
+        if (matcher) {
+            sclass = (*matcher)(NodeInfo(src.referenceFrame, tid));
+            if (sclass == SpatialClass::outside) {
+                report();
+                return;
+            }
+        }
+
         const auto *metanode(src.findMetaNode(tid));
         if (!metanode) {
             if (mask & TileIndex::Flag::content) {
@@ -1852,24 +2304,35 @@ void TileSet::paste(const TileSet &srcSet
 
         if (!metanode->real()) { return; }
 
-        if (mask & TileIndex::Flag::mesh) {
-            // copy mesh
-            copyFile(sd.input(tid, storage::TileFile::mesh)
-                     , dd.output(tid, storage::TileFile::mesh));
-        }
+        if ((mask & TileIndex::Flag::mesh)
+            && (sclass == SpatialClass::boundary)
+            && (matcher->boundary() == SpatialFilter::Boundary::clip))
+        {
+            // clip mesh and atlas, copy navtile as is
+            auto mn(*metanode);
+            const auto submeshes
+                (Factory::clip(tid, NodeInfo(src.referenceFrame, tid), sd, dd
+                               , (mask & TileIndex::Flag::atlas), mn
+                               , *matcher));
+            if (!submeshes) {
+                LOG(info1) << "Tile " << tid << " clipped out completely.";
+                report();
+                return;
+            }
 
-        if (mask & TileIndex::Flag::atlas) {
-            // copy atlas
-            copyFile(sd.input(tid, storage::TileFile::atlas)
-                     , dd.output(tid, storage::TileFile::atlas));
-        }
+            copyTile(sd, dd, tid, mask & TileIndex::Flag::navtile);
 
-        if (mask & TileIndex::Flag::navtile){
-            // copy navtile if allowed
-            copyFile(sd.input(tid, storage::TileFile::navtile)
-                     , dd.output(tid, storage::TileFile::navtile));
+            // clipping could drop submeshes
+            dst.updateNode(tid, mn, ((submeshes > 1)
+                                     ? TileIndex::Flag::multimesh : 0));
+            LOG(info1) << "Stored tile " << tid << ".";
+            report();
+            return;
         }
 
+        // copy mesh, atlas and navtile
+        copyTile(sd, dd, tid, mask);
+
         dst.updateNode(tid, *metanode
                        , mask & TileIndex::Flag::nonmeta);
         LOG(info1) << "Stored tile " << tid << ".";
@@ -1925,7 +2388,8 @@ TileSet concatTileSets(const boost::filesystem::path &path
     // clone-in all tileset from back (i.e. in the order they have been
     // specified by user
     for (; !tsList.empty(); tsList.pop_back()) {
-        dst.paste(tsList.back(), createOptions.lodRange());
+        dst.paste(tsList.back(), createOptions.lodRange()
+                  , createOptions.spatialFilter());
     }
 
     dst.flush();